@@ -158,15 +158,27 @@ CL_EventIndex
 */
 word CL_EventIndex( const char *name )
 {
-	word	i;
+	word	i, j;
 
 	if( !COM_CheckString( name ))
 		return 0;
 
+	for( i = Precache_FirstHash( &cl.event_hash, name ); i; i = Precache_NextHash( &cl.event_hash, i ))
+	{
+		if( !Q_stricmp( cl.event_precache[i], name ))
+			return i;
+	}
+
 	for( i = 1; i < MAX_EVENTS && cl.event_precache[i][0]; i++ )
 	{
 		if( !Q_stricmp( cl.event_precache[i], name ))
+		{
+			// events list was changed since last lookup
+			Precache_ClearHash( &cl.event_hash );
+			for( j = 1; j < MAX_EVENTS && cl.event_precache[j][0]; j++ )
+				Precache_AddHash( &cl.event_hash, cl.event_precache[j], j );
 			return i;
+		}
 	}
 	return 0;
 }
@@ -2423,6 +2423,26 @@ static void GAME_EXPORT pfnPlaySound( int ent, float *org, int chan, const char
 	S_StartSound( org, ent, chan, S_RegisterSound( samp ), vol, attn, pitch, flags );
 }
 
+/*
+=============
+CL_RebuildModelHash
+
+models list was changed since last lookup
+=============
+*/
+static void CL_RebuildModelHash( void )
+{
+	int i;
+
+	Precache_ClearHash( &cl.model_hash );
+
+	for( i = 1; i <= cl.nummodels && i < PRECACHE_HASH_SLOTS; i++ )
+	{
+		if( cl.models[i] )
+			Precache_AddHash( &cl.model_hash, cl.models[i]->name, i );
+	}
+}
+
 /*
 =============
 CL_FindModelIndex
@@ -2440,13 +2460,22 @@ static int GAME_EXPORT CL_FindModelIndex( const char *m )
 	Q_strncpy( filepath, m, sizeof( filepath ));
 	COM_FixSlashes( filepath );
 
+	for( i = Precache_FirstHash( &cl.model_hash, filepath ); i; i = Precache_NextHash( &cl.model_hash, i ))
+	{
+		if( cl.models[i] && !Q_stricmp( cl.models[i]->name, filepath ))
+			return i;
+	}
+
 	for( i = 0; i < cl.nummodels; i++ )
 	{
 		if( !cl.models[i+1] )
 			continue;
 
 		if( !Q_stricmp( cl.models[i+1]->name, filepath ))
+		{
+			CL_RebuildModelHash();
 			return i+1;
+		}
 	}
 
 	return 0;
@@ -939,9 +939,11 @@ static void CL_RunUsercmd( local_state_t *from, local_state_t *to, usercmd_t *u,
 	{
 		// setup playermove state
 		CL_SetupPMove( clgame.pmove, from, &cmd, runfuncs, *time );
+		PM_SetupBroadphase( clgame.pmove );
 
 		// motor!
 		clgame.dllFuncs.pfnPlayerMove( clgame.pmove, false );
+		PM_ClearBroadphase( clgame.pmove );
 
 		// copy results back to client
 		CL_FinishPMove( clgame.pmove, to );
@@ -29,6 +29,7 @@ GNU General Public License for more details.
 #include "cdll_exp.h"
 #include "screenfade.h"
 #include "protocol.h"
+#include "precache.h"
 #include "netchan.h"
 #include "net_api.h"
 #include "world.h"
@@ -256,6 +257,8 @@ typedef struct
 	char		sound_precache[MAX_SOUNDS][MAX_QPATH];
 	char		event_precache[MAX_EVENTS][MAX_QPATH];
 	char		files_precache[MAX_CUSTOM][MAX_QPATH];
+	precache_hash_t	model_hash;		// rebuilt when lookup misses
+	precache_hash_t	event_hash;
 	lightstyle_t	lightstyles[MAX_LIGHTSTYLES];
 	int		numfiles;
 
@@ -90,28 +90,24 @@ wavdata_t *FS_LoadSound( const char *filename, const byte *buffer, size_t size )
 		{
 			qboolean success = false;
 			fs_offset_t filesize = 0;
-			byte *f;
+			const byte *f;
 			string path;
 
 			Q_snprintf( path, sizeof( path ), DEFAULT_SOUNDPATH "%s.%s", loadname, format->ext );
 
-			f = FS_LoadFile( path, &filesize, false );
+			f = FS_MapFile( path, &filesize, false );
 			if( f && filesize > 0 )
-			{
 				success = format->loadfunc( path, f, filesize );
-				Mem_Free( f ); // release buffer
-			}
+			FS_UnmapFile( f ); // release buffer
 
 			if( success )
 				return SoundPack(); // loaded
 
 			Q_snprintf( path, sizeof( path ), "%s.%s", loadname, format->ext );
-			f = FS_LoadFile( path, &filesize, false );
+			f = FS_MapFile( path, &filesize, false );
 			if( f && filesize > 0 )
-			{
 				success = format->loadfunc( path, f, filesize );
-				Mem_Free( f ); // release buffer
-			}
+			FS_UnmapFile( f ); // release buffer
 
 			if( success )
 				return SoundPack();
@@ -1342,7 +1342,7 @@ Cmd_Init
 */
 void Cmd_Init( void )
 {
-	cmd_pool = Mem_AllocPool( "Console Commands" );
+	cmd_pool = Mem_AllocPoolExt( "Console Commands", MEMPOOL_SLAB );
 	cmd_functions = NULL;
 	cmd_condition = 0;
 	cmd_alias = NULL;
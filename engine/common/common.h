@@ -369,6 +369,9 @@ typedef void (*xcommand_t)( void );
 //
 // zone.c
 //
+#define MEMPOOL_ARENA	BIT( 0 )	// bump allocated, freed all at once with the pool
+#define MEMPOOL_SLAB	BIT( 1 )	// small allocations from size class free lists
+
 void Memory_Init( void );
 void _Mem_Free( void *data, const char *filename, int fileline );
 void *_Mem_Realloc( poolhandle_t poolptr, void *memptr, size_t size, qboolean clear, const char *filename, int fileline )
@@ -377,18 +380,26 @@ void *_Mem_Alloc( poolhandle_t poolptr, size_t size, qboolean clear, const char
 	ALLOC_CHECK( 2 ) MALLOC_LIKE( _Mem_Free, 1 ) WARN_UNUSED_RESULT;
 poolhandle_t _Mem_AllocPool( const char *name, const char *filename, int fileline )
 	WARN_UNUSED_RESULT;
+poolhandle_t _Mem_AllocPoolExt( const char *name, int flags, const char *filename, int fileline )
+	WARN_UNUSED_RESULT;
 void _Mem_FreePool( poolhandle_t *poolptr, const char *filename, int fileline );
 void _Mem_EmptyPool( poolhandle_t poolptr, const char *filename, int fileline );
 void _Mem_Check( const char *filename, int fileline );
 qboolean Mem_IsAllocatedExt( poolhandle_t poolptr, void *data );
 void Mem_PrintList( size_t minallocationsize );
 void Mem_PrintStats( void );
+void Mem_ProfileStart( void );
+void Mem_ProfileStop( void );
+void Mem_ProfileSnapshot( void );
+void Mem_ProfilePrint( int count, qboolean diff );
+void Mem_ProfileDump( file_t *f );
 
 #define Mem_Malloc( pool, size ) _Mem_Alloc( pool, size, false, __FILE__, __LINE__ )
 #define Mem_Calloc( pool, size ) _Mem_Alloc( pool, size, true, __FILE__, __LINE__ )
 #define Mem_Realloc( pool, ptr, size ) _Mem_Realloc( pool, ptr, size, true, __FILE__, __LINE__ )
 #define Mem_Free( mem ) _Mem_Free( mem, __FILE__, __LINE__ )
 #define Mem_AllocPool( name ) _Mem_AllocPool( name, __FILE__, __LINE__ )
+#define Mem_AllocPoolExt( name, flags ) _Mem_AllocPoolExt( name, flags, __FILE__, __LINE__ )
 #define Mem_FreePool( pool ) _Mem_FreePool( pool, __FILE__, __LINE__ )
 #define Mem_EmptyPool( pool ) _Mem_EmptyPool( pool, __FILE__, __LINE__ )
 #define Mem_IsAllocated( mem ) Mem_IsAllocatedExt( NULL, mem )
@@ -409,10 +420,23 @@ byte *FS_LoadFile( const char *path, fs_offset_t *filesizeptr, qboolean gamediro
 	MALLOC_LIKE( _Mem_Free, 1 ) WARN_UNUSED_RESULT;
 byte *FS_LoadDirectFile( const char *path, fs_offset_t *filesizeptr )
 	MALLOC_LIKE( _Mem_Free, 1 ) WARN_UNUSED_RESULT;
+const byte *FS_MapFile( const char *path, fs_offset_t *filesizeptr, qboolean gamedironly ) WARN_UNUSED_RESULT;
+void FS_UnmapFile( const byte *data );
+int FS_LoadFileAsync( const char *path, qboolean gamedironly, int priority, fs_async_callback_t callback, void *userdata );
+qboolean FS_CancelAsync( int handle );
+int FS_PollAsync( qboolean wait );
 void FS_Rescan_f( void );
 void FS_LoadGameInfo( void );
 void FS_SaveVFSConfig( void );
 
+//
+// sys_con.c
+//
+void Sys_StartLogThread( void );
+qboolean Sys_QueueLog( file_t *file, const char *data, size_t len );
+void Sys_FlushLog( double timeout );
+void Sys_CrashFlushLog( void );
+
 //
 // cmd.c
 //
@@ -68,6 +68,31 @@ byte *FS_LoadDirectFile( const char *path, fs_offset_t *filesizeptr )
 	return g_fsapi.LoadDirectFile( path, filesizeptr );
 }
 
+const byte *FS_MapFile( const char *path, fs_offset_t *filesizeptr, qboolean gamedironly )
+{
+	return g_fsapi.MapFile( path, filesizeptr, gamedironly );
+}
+
+void FS_UnmapFile( const byte *data )
+{
+	g_fsapi.UnmapFile( data );
+}
+
+int FS_LoadFileAsync( const char *path, qboolean gamedironly, int priority, fs_async_callback_t callback, void *userdata )
+{
+	return g_fsapi.LoadFileAsync( path, gamedironly, priority, callback, userdata );
+}
+
+qboolean FS_CancelAsync( int handle )
+{
+	return g_fsapi.CancelAsync( handle );
+}
+
+int FS_PollAsync( qboolean wait )
+{
+	return g_fsapi.PollAsync( wait );
+}
+
 static void COM_StripDirectorySlash( char *pname )
 {
 	size_t len;
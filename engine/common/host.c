@@ -75,6 +75,9 @@ CVAR_DEFINE_AUTO( fps_override, "0", FCVAR_FILTERABLE, "unlock higher framerate
 static CVAR_DEFINE_AUTO( host_framerate, "0", FCVAR_FILTERABLE, "locks frame timing to this value in seconds" );
 static CVAR_DEFINE( host_sleeptime, "sleeptime", "1", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "milliseconds to sleep for each frame. higher values reduce fps accuracy" );
 static CVAR_DEFINE_AUTO( host_sleeptime_debug, "0", 0, "print sleeps between frames" );
+static CVAR_DEFINE_AUTO( sys_tickscheduler, "0", FCVAR_ARCHIVE, "dedicated server frame scheduler: 0 - relative sleeps, 1 - absolute tick deadlines" );
+static CVAR_DEFINE_AUTO( sys_tickspin, "0.1", FCVAR_ARCHIVE, "milliseconds to busy wait before tick deadline to hide wakeup latency" );
+static CVAR_DEFINE_AUTO( sys_tickwake, "0", FCVAR_ARCHIVE, "milliseconds before tick deadline when incoming packet starts the tick early" );
 CVAR_DEFINE_AUTO( host_allow_materials, "0", FCVAR_LATCH|FCVAR_ARCHIVE, "allow texture replacements from materials/ folder" );
 CVAR_DEFINE( con_gamemaps, "con_mapfilter", "1", FCVAR_ARCHIVE, "when true show only maps in game folder" );
 
@@ -532,6 +535,59 @@ static void Host_MemStats_f( void )
 	}
 }
 
+/*
+===============
+Host_MemProfile_f
+===============
+*/
+static void Host_MemProfile_f( void )
+{
+	const char *cmd = Cmd_Argv( 1 );
+	int count = Cmd_Argc( ) > 2 ? Q_atoi( Cmd_Argv( 2 )) : 20;
+
+	if( !Q_stricmp( cmd, "start" ))
+	{
+		Mem_ProfileStart();
+		Con_Printf( "memory profiler started\n" );
+	}
+	else if( !Q_stricmp( cmd, "stop" ))
+	{
+		Mem_ProfileStop();
+		Con_Printf( "memory profiler stopped\n" );
+	}
+	else if( !Q_stricmp( cmd, "snapshot" ))
+	{
+		Mem_ProfileSnapshot();
+		Con_Printf( "memory snapshot taken\n" );
+	}
+	else if( !Q_stricmp( cmd, "report" ))
+	{
+		Mem_ProfilePrint( count, false );
+	}
+	else if( !Q_stricmp( cmd, "diff" ))
+	{
+		Mem_ProfilePrint( count, true );
+	}
+	else if( !Q_stricmp( cmd, "dump" ) && Cmd_Argc( ) > 2 )
+	{
+		file_t *f = FS_Open( Cmd_Argv( 2 ), "w", true );
+
+		if( !f )
+		{
+			Con_Printf( S_ERROR "couldn't write %s\n", Cmd_Argv( 2 ));
+			return;
+		}
+
+		Mem_ProfileDump( f );
+		FS_Close( f );
+		Con_Printf( "memory profile written to %s\n", Cmd_Argv( 2 ));
+	}
+	else
+	{
+		Con_Printf( S_USAGE "memprof <start|stop|snapshot|report [count]|diff [count]|dump <file>>\n" );
+	}
+}
+
 /*
 =================
 Host_RegisterDecal
@@ -654,6 +710,142 @@ static double Host_CalcFPS( void )
 	return fps;
 }
 
+static struct
+{
+	double	interval;		// tick length the deadlines were computed for
+	double	nextframe;	// absolute deadline of the next tick
+	double	lastframe;	// when previous tick was started
+	double	lateness;		// sum of deadline misses
+	double	maxlateness;
+	double	minspacing;
+	double	maxspacing;
+	int	ticks;
+	int	overruns;		// ticks that missed the whole interval
+	int	wakeups;		// ticks started early by incoming packet
+} host_tick;
+
+static void Host_ResetTickStats( void )
+{
+	host_tick.lateness = host_tick.maxlateness = 0.0;
+	host_tick.minspacing = host_tick.maxspacing = 0.0;
+	host_tick.ticks = host_tick.overruns = host_tick.wakeups = 0;
+}
+
+/*
+===================
+Host_TickSchedule
+
+sleeps until absolute deadline of the next tick, so oversleeps
+doesn't drift the tick grid. The sleep itself is done in the OS timer
+or in select() on the server sockets within sys_tickwake window,
+and last sys_tickspin milliseconds are spent spinning
+===================
+*/
+static qboolean Host_TickSchedule( double fps )
+{
+	const double interval = 1.0 / fps;
+	const double spin = bound( 0.0, sys_tickspin.value * 0.001, interval * 0.5 );
+	const double wake = bound( 0.0, sys_tickwake.value * 0.001, interval * 0.5 );
+	double now, late, spacing;
+
+	now = Sys_DoubleTime();
+
+	if( host_tick.interval != interval || host_tick.nextframe == 0.0 )
+	{
+		// (re)start tick grid from now
+		host_tick.interval = interval;
+		host_tick.nextframe = now;
+		host_tick.lastframe = 0.0;
+	}
+
+	while( now < host_tick.nextframe )
+	{
+		const double remaining = host_tick.nextframe - now;
+
+		if( remaining > Q_max( spin, wake ))
+		{
+			Platform_SleepUntil( host_tick.nextframe - Q_max( spin, wake ));
+		}
+		else if( remaining > spin )
+		{
+			// within wake window, incoming packet starts the tick right now
+			if( NET_WaitPacket(( remaining - spin ) * 1000000.0 ))
+			{
+				host_tick.wakeups++;
+				now = Sys_DoubleTime();
+				break;
+			}
+		}
+
+		now = Sys_DoubleTime();
+	}
+
+	late = now - host_tick.nextframe;
+
+	if( late > interval )
+	{
+		// missed whole tick, don't try to catch up with burst of frames
+		host_tick.overruns++;
+		host_tick.nextframe = now + interval;
+	}
+	else host_tick.nextframe += interval;
+
+	if( late > 0.0 )
+	{
+		host_tick.lateness += late;
+		host_tick.maxlateness = Q_max( host_tick.maxlateness, late );
+	}
+
+	if( host_tick.lastframe != 0.0 )
+	{
+		spacing = now - host_tick.lastframe;
+
+		if( host_tick.ticks == 0 || spacing < host_tick.minspacing )
+			host_tick.minspacing = spacing;
+		if( spacing > host_tick.maxspacing )
+			host_tick.maxspacing = spacing;
+		host_tick.ticks++;
+	}
+
+	host_tick.lastframe = now;
+
+	return true;
+}
+
+/*
+===================
+Host_TickStats_f
+===================
+*/
+static void Host_TickStats_f( void )
+{
+	if( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ))
+	{
+		Host_ResetTickStats();
+		return;
+	}
+
+	if( !Host_IsDedicated( ) || !sys_tickscheduler.value )
+	{
+		Con_Printf( "tick statistics are only collected with sys_tickscheduler 1 on dedicated server\n" );
+		return;
+	}
+
+	if( !host_tick.ticks )
+	{
+		Con_Printf( "no ticks measured yet\n" );
+		return;
+	}
+
+	Con_Printf( "%i ticks at %.1f Hz, %i overruns, %i early wakeups\n",
+		host_tick.ticks, 1.0 / host_tick.interval, host_tick.overruns, host_tick.wakeups );
+	Con_Printf( "lateness: avg %.3f ms, max %.3f ms\n",
+		host_tick.lateness * 1000.0 / host_tick.ticks, host_tick.maxlateness * 1000.0 );
+	Con_Printf( "spacing: min %.3f ms, max %.3f ms, jitter %.3f ms\n",
+		host_tick.minspacing * 1000.0, host_tick.maxspacing * 1000.0,
+		( host_tick.maxspacing - host_tick.minspacing ) * 1000.0 );
+}
+
 static qboolean Host_Autosleep( double dt, double scale )
 {
 	double targetframetime, fps;
@@ -667,6 +859,11 @@ static qboolean Host_Autosleep( double dt, double scale )
 	// limit fps to withing tolerable range
 	fps = bound( MIN_FPS, fps, MAX_FPS_HARD );
 
+	if( Host_IsDedicated( ) && sys_tickscheduler.value )
+		return Host_TickSchedule( fps );
+
+	host_tick.nextframe = 0.0; // resync when scheduler gets enabled again
+
 	if( Host_IsDedicated( ))
 		targetframetime = ( 1.0 / ( fps + 1.0 ));
 	else targetframetime = ( 1.0 / fps );
@@ -785,6 +982,7 @@ void Host_Frame( double time )
 	Host_InputFrame ();  // input frame
 	Host_ClientBegin (); // begin client
 	Host_GetCommands (); // dedicated in
+	FS_PollAsync( false ); // finished file loads
 	Host_ServerFrame (); // server frame
 	Host_ClientFrame (); // client frame
 	HTTP_Run();			 // both server and client
@@ -1129,6 +1327,7 @@ static void Host_InitCommon( int argc, char **argv, const char *progname, qboole
 
 	Cmd_AddCommand( "exec", Host_Exec_f, "execute a script file" );
 	Cmd_AddCommand( "memlist", Host_MemStats_f, "prints memory pool information" );
+	Cmd_AddRestrictedCommand( "memprof", Host_MemProfile_f, "allocation call site profiler" );
 	Cmd_AddRestrictedCommand( "userconfigd", Host_Userconfigd_f, "execute all scripts from userconfig.d" );
 
 #if !XASH_DEDICATED
@@ -1208,6 +1407,9 @@ int EXPORT Host_Main( int argc, char **argv, const char *progname, int bChangeGa
 	Cvar_RegisterVariable( &host_framerate );
 	Cvar_RegisterVariable( &host_sleeptime );
 	Cvar_RegisterVariable( &host_sleeptime_debug );
+	Cvar_RegisterVariable( &sys_tickscheduler );
+	Cvar_RegisterVariable( &sys_tickspin );
+	Cvar_RegisterVariable( &sys_tickwake );
 	Cvar_RegisterVariable( &host_gameloaded );
 	Cvar_RegisterVariable( &host_clientloaded );
 	Cvar_RegisterVariable( &host_limitlocal );
@@ -1260,6 +1462,7 @@ int EXPORT Host_Main( int argc, char **argv, const char *progname, int bChangeGa
 
 		Cmd_AddRestrictedCommand( "quit", Sys_Quit_f, "quit the game" );
 		Cmd_AddRestrictedCommand( "exit", Sys_Quit_f, "quit the game" );
+		Cmd_AddCommand( "tickstats", Host_TickStats_f, "print tick jitter and overrun statistics, 'tickstats reset' clears them" );
 	}
 	else Cmd_AddRestrictedCommand( "minimize", Platform_Minimize_f, "minimize main window to tray" );
 
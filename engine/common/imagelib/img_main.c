@@ -314,19 +314,17 @@ static qboolean Image_ProbeLoad_( const loadpixformat_t *fmt, const char *name,
 	qboolean success = false;
 	fs_offset_t filesize;
 	string path;
-	byte *f;
+	const byte *f;
 
 	Q_snprintf( path, sizeof( path ), "%s%s.%s", name, suffix, fmt->ext );
-	f = FS_LoadFile( path, &filesize, false );
+	f = FS_MapFile( path, &filesize, false );
 
 	Image_IncrementLookupTime();
 
 	if( f && filesize >= 0 )
-	{
 		success = Image_ProbeLoadBuffer_( fmt, path, f, filesize, override_hint );
 
-		Mem_Free( f );
-	}
+	FS_UnmapFile( f );
 
 	return success;
 }
@@ -350,7 +348,8 @@ static qboolean Image_ProbeLoad2( const char *name, const char *suffix, int over
 	for( fmt = image.loadformats; fmt->ext; fmt++ )
 	{
 		fs_offset_t filesize;
-		byte *data;
+		const byte *data;
+		qboolean success;
 
 		for( i = 0; i < t->numfilenames; i++ )
 		{
@@ -364,16 +363,21 @@ static qboolean Image_ProbeLoad2( const char *name, const char *suffix, int over
 		if( i == t->numfilenames )
 			continue;
 
-		data = FS_LoadFile( t->filenames[i], &filesize, false );
+		data = FS_MapFile( t->filenames[i], &filesize, false );
 		Image_IncrementLookupTime();
 
 		// can't load file, ignore
 		if( unlikely( !data || filesize <= 0 ))
+		{
+			FS_UnmapFile( data );
 			continue;
+		}
+
+		success = Image_ProbeLoadBuffer_( fmt, t->filenames[i], data, filesize, override_hint );
+		FS_UnmapFile( data );
 
-		if( Image_ProbeLoadBuffer_( fmt, t->filenames[i], data, filesize, override_hint ))
+		if( success )
 		{
-			Mem_Free( data );
 			Mem_Free( t );
 			return true;
 		}
@@ -672,6 +676,69 @@ static void Test_CheckImage( const char *name, rgbdata_t *rgb )
 	FS_FreeImage( load );
 }
 
+// Quake conchars is remapped on load, it must work through read-only archive views
+static void Test_LoadConcharsFromPak( void )
+{
+	const char *pakname = "test_conchars.pak";
+	const char *diskpath;
+	struct { char name[56]; int filepos, filelen; } entry = { 0 };
+	int header[3];
+	rgbdata_t *load;
+	byte *pixels;
+	file_t *f;
+	int i;
+
+	pixels = Z_Malloc( 16384 );
+	for( i = 0; i < 16384; i++ )
+		pixels[i] = i & 1 ? i & 0xFF : 0;
+
+	header[0] = ( 'K' << 24 ) + ( 'C' << 16 ) + ( 'A' << 8 ) + 'P';
+	header[1] = sizeof( header ) + 16384;
+	header[2] = sizeof( entry );
+	Q_strncpy( entry.name, "gfx/conchars.lmp", sizeof( entry.name ));
+	entry.filepos = sizeof( header );
+	entry.filelen = 16384;
+
+	f = FS_Open( pakname, "wb", true );
+	TASSERT( f != NULL )
+	if( !f )
+	{
+		Z_Free( pixels );
+		return;
+	}
+
+	FS_Write( f, &header, sizeof( header ));
+	FS_Write( f, pixels, 16384 );
+	FS_Write( f, &entry, sizeof( entry ));
+	FS_Close( f );
+
+	diskpath = FS_GetDiskPath( pakname, false );
+	TASSERT( diskpath != NULL )
+	TASSERT( diskpath && g_fsapi.MountArchive_Fullpath( diskpath, 0 ) != NULL )
+
+	load = FS_LoadImage( "gfx/conchars.lmp", NULL, 0 );
+	TASSERT( load != NULL )
+
+	if( load )
+	{
+		TASSERT( load->width == 128 )
+		TASSERT( load->height == 128 )
+		FS_FreeImage( load );
+	}
+
+	// archive contents are left intact
+	load = (rgbdata_t *)FS_LoadFile( "gfx/conchars.lmp", NULL, false );
+	TASSERT( load && !memcmp( load, pixels, 16384 ))
+	Mem_Free( load );
+
+	// tests run before gameinfo is loaded, so besides static
+	// paths only the test archive is mounted and this unmounts it
+	g_fsapi.ClearSearchPath();
+	TASSERT( !FS_FileExists( "gfx/conchars.lmp", false ))
+	FS_Delete( pakname );
+	Z_Free( pixels );
+}
+
 void Test_RunImagelib( void )
 {
 	rgbdata_t rgb = { 0 };
@@ -716,6 +783,8 @@ void Test_RunImagelib( void )
 	}
 
 	Z_Free( rgb.buffer );
+
+	Test_LoadConcharsFromPak();
 }
 
 #define IMPLEMENT_IMAGELIB_FUZZ_TARGET( export, target ) \
@@ -294,10 +294,14 @@ qboolean Image_LoadLMP( const char *name, const byte *buffer, fs_offset_t filesi
 		image.width = image.height = 128;
 		rendermode = LUMP_QUAKE1;
 		filesize += sizeof( lmp );
-		fin = (byte *)buffer;
 
 		// need to remap transparent color from first to last entry
-		for( i = 0; i < 16384; i++ ) if( !fin[i] ) fin[i] = 0xFF;
+		// buffer may be a read-only view of mapped archive, so remap a copy
+		image.tempbuffer = (byte *)Mem_Realloc( host.imagepool, image.tempbuffer, 16384 );
+		fin = image.tempbuffer;
+
+		for( i = 0; i < 16384; i++ )
+			fin[i] = buffer[i] ? buffer[i] : 0xFF;
 	}
 	else
 	{
@@ -1669,7 +1669,7 @@ Mod_MakeHull0
 Duplicate the drawing hull structure as a clipping hull
 =================
 */
-static void Mod_MakeHull0( model_t *mod, const dbspmodel_t *bmod )
+static void Mod_MakeHull0( model_t *mod, dbspmodel_t *bmod )
 {
 	hull_t *hull = &mod->hulls[0];
 	int i;
@@ -1840,6 +1840,108 @@ static void Mod_SetupHull( dbspmodel_t *bmod, model_t *mod, int headnode, int hu
 	RemapClipNodes_r( bmod, bmod->clipnodes_out, hull, headnode ); // remap clipnodes to 16-bit indexes
 }
 
+/*
+=================
+Mod_FlattenClipnodes
+
+copy clipnodes into a single array with planes stored inline,
+returns NULL if clipnodes reference planes out of range
+=================
+*/
+mclipnode_flat_t *Mod_FlattenClipnodes( poolhandle_t pool, const hull_t *hull, int numnodes, int numplanes )
+{
+	mclipnode_flat_t *out;
+	int i;
+
+	if( !hull->planes || !hull->clipnodes16 || numnodes <= 0 )
+		return NULL;
+
+	// validate first, these nodes might be never touched by traces
+	for( i = 0; i < numnodes; i++ )
+	{
+		int planenum = world.version == QBSP2_VERSION ? hull->clipnodes32[i].planenum : hull->clipnodes16[i].planenum;
+
+		if( planenum < 0 || planenum >= numplanes )
+			return NULL;
+	}
+
+	out = Mem_Malloc( pool, sizeof( *out ) * numnodes );
+
+	for( i = 0; i < numnodes; i++ )
+	{
+		if( world.version == QBSP2_VERSION )
+		{
+			out[i].plane = hull->planes[hull->clipnodes32[i].planenum];
+			out[i].children[0] = hull->clipnodes32[i].children[0];
+			out[i].children[1] = hull->clipnodes32[i].children[1];
+		}
+		else
+		{
+			out[i].plane = hull->planes[hull->clipnodes16[i].planenum];
+			out[i].children[0] = hull->clipnodes16[i].children[0];
+			out[i].children[1] = hull->clipnodes16[i].children[1];
+		}
+		out[i].pad = 0;
+	}
+
+	return out;
+}
+
+/*
+=================
+Mod_SetupFlatClipnodes
+
+flatten every distinct clipnodes array used by world hulls,
+brush entities share them with the world
+=================
+*/
+static void Mod_SetupFlatClipnodes( model_t *mod, const dbspmodel_t *bmod )
+{
+	int i, j;
+
+	world.num_flatclipnodes = 0;
+
+	for( i = 0; i < MAX_MAP_HULLS; i++ )
+	{
+		const hull_t *hull = &mod->hulls[i];
+		mflatclipnodes_t *flat;
+		int numnodes;
+
+		if( !hull->planes || !hull->clipnodes16 )
+			continue;
+
+		// hulls 1-3 use the same array unless they were remapped for bsp30ext
+		for( j = 0; j < world.num_flatclipnodes; j++ )
+		{
+			if( world.flatclipnodes[j].source == (const void *)hull->clipnodes16 )
+				break;
+		}
+
+		if( j != world.num_flatclipnodes )
+			continue;
+
+		if( i == 0 )
+			numnodes = mod->numnodes;
+		else if( bmod->isbsp30ext )
+			numnodes = hull->lastclipnode; // fit to real count by Mod_SetupHull
+		else numnodes = mod->numclipnodes;
+
+		flat = &world.flatclipnodes[world.num_flatclipnodes];
+		flat->nodes = Mod_FlattenClipnodes( mod->mempool, hull, numnodes, mod->numplanes );
+
+		if( !flat->nodes )
+		{
+			Con_Reportf( S_WARN "%s: hull %i references bad planes, not flattened\n", __func__, i );
+			continue;
+		}
+
+		flat->source = hull->clipnodes16;
+		flat->planes = hull->planes;
+		flat->numnodes = numnodes;
+		world.num_flatclipnodes++;
+	}
+}
+
 static qboolean Mod_LoadLitfile( model_t *mod, const char *ext, size_t expected_size, color24 **out, size_t *outsize )
 {
 	char        modelname[64], path[64];
@@ -3019,7 +3121,6 @@ static void Mod_LoadSurfaces( model_t *mod, dbspmodel_t *bmod )
 
 			for( j = 0; j < MAXLIGHTMAPS; j++ )
 				out->styles[j] = in->styles[j];
-			lightofs = in->lightofs;
 		}
 		else
 		{
@@ -3039,7 +3140,6 @@ static void Mod_LoadSurfaces( model_t *mod, dbspmodel_t *bmod )
 
 			for( j = 0; j < MAXLIGHTMAPS; j++ )
 				out->styles[j] = in->styles[j];
-			lightofs = in->lightofs;
 		}
 
 		tex = out->texinfo->texture;
@@ -3066,8 +3166,41 @@ static void Mod_LoadSurfaces( model_t *mod, dbspmodel_t *bmod )
 		if( FBitSet( out->texinfo->flags, TEX_SPECIAL ))
 			SetBits( out->flags, SURF_DRAWTILED );
 
-		Mod_CalcSurfaceBounds( mod, out, bmod );
-		Mod_CalcSurfaceExtents( mod, out, bmod );
+		// worker threads can't throw errors, so check edges here
+		for( j = 0; j < out->numedges; j++ )
+		{
+			int e = mod->surfedges[out->firstedge + j];
+
+			if( e >= mod->numedges || e <= -mod->numedges )
+				Host_Error( "%s: bad edge\n", __func__ );
+		}
+	}
+
+	// bounds and extents are independent for each surface,
+	// this only runs in parallel when built with --enable-openmp
+#pragma omp parallel for schedule( static, 256 )
+	for( i = 0; i < bmod->numsurfaces; i++ )
+	{
+		if( !mod->surfaces[i].texinfo )
+			continue; // corrupted
+
+		Mod_CalcSurfaceBounds( mod, &mod->surfaces[i], bmod );
+		Mod_CalcSurfaceExtents( mod, &mod->surfaces[i], bmod );
+	}
+
+	out = mod->surfaces;
+
+	for( i = 0; i < bmod->numsurfaces; i++, out++ )
+	{
+		if( !out->texinfo )
+			continue; // corrupted
+
+		info = out->info;
+
+		if( bmod->version == QBSP2_VERSION )
+			lightofs = bmod->surfaces32[i].lightofs;
+		else lightofs = bmod->surfaces[i].lightofs;
+
 		Mod_CreateFaceBevels( mod, out, bmod );
 
 		// grab the second sample to detect colored lighting
@@ -3334,6 +3467,189 @@ static void Mod_LoadLeafs( model_t *mod, dbspmodel_t *bmod )
 		SetBits( world.flags, FWORLD_WATERALPHA );
 }
 
+#define IDPHSCACHEHEADER	(('S'<<24)+('H'<<16)+('P'<<8)+'X') // little-endian "XPHS"
+#define PHSCACHE_VERSION	3
+
+// PHS cache file, followed by phsofs and compressed PHS rows
+typedef struct dphscache_s
+{
+	int	ident;
+	int	version;
+	uint32_t	vissize;		// size of visibility lump
+	uint32_t	viscrc;		// CRC of visibility lump
+	uint32_t	numrows;
+	uint32_t	visbytes;
+	uint32_t	datasize;		// compressed rows size
+	uint32_t	datacrc;		// CRC of phsofs and rows
+} dphscache_t;
+
+/*
+===========
+Mod_PHSCacheName
+===========
+*/
+static void Mod_PHSCacheName( const model_t *mod, char *out, size_t size )
+{
+	char	name[MAX_QPATH];
+
+	COM_FileBase( mod->name, name, sizeof( name ));
+	Q_snprintf( out, size, "cache/maps/%s.phs", name );
+}
+
+/*
+===========
+Mod_CheckPHSRow
+
+row must decompress to rowbytes before the end of data
+===========
+*/
+static qboolean Mod_CheckPHSRow( const byte *data, size_t pos, size_t datasize, size_t rowbytes )
+{
+	size_t len = 0;
+
+	while( len < rowbytes )
+	{
+		if( pos >= datasize )
+			return false;
+
+		if( data[pos] )
+		{
+			len++;
+			pos++;
+			continue;
+		}
+
+		// zero repeated next byte times
+		if( pos + 1 >= datasize )
+			return false;
+
+		len += data[pos + 1];
+		pos += 2;
+	}
+
+	return true;
+}
+
+/*
+===========
+Mod_LoadPHSCache
+
+returns false if cache is missing, stale or corrupted
+===========
+*/
+static qboolean Mod_LoadPHSCache( model_t *mod, const dphscache_t *key )
+{
+	char		filename[MAX_QPATH];
+	dphscache_t	hdr;
+	uint32_t		*ofs = NULL;
+	byte		*data = NULL;
+	uint32_t		crc;
+	file_t		*f;
+	size_t		i;
+
+	Mod_PHSCacheName( mod, filename, sizeof( filename ));
+
+	if(( f = FS_Open( filename, "rb", true )) == NULL )
+		return false;
+
+	if( FS_Read( f, &hdr, sizeof( hdr )) != sizeof( hdr ) || memcmp( &hdr, key, offsetof( dphscache_t, datasize )))
+	{
+		Con_Reportf( "%s is out of date\n", filename );
+		FS_Close( f );
+		return false;
+	}
+
+	// same limit as temporary row buffer in Mod_CalcPHS
+	if( hdr.datasize > hdr.numrows * hdr.visbytes * 2 )
+		goto corrupted;
+
+	ofs = Mem_Malloc( mod->mempool, sizeof( *ofs ) * hdr.numrows );
+	data = Mem_Malloc( mod->mempool, hdr.datasize );
+
+	if( FS_Read( f, ofs, sizeof( *ofs ) * hdr.numrows ) != sizeof( *ofs ) * hdr.numrows )
+		goto corrupted;
+
+	if( FS_Read( f, data, hdr.datasize ) != hdr.datasize )
+		goto corrupted;
+
+	CRC32_Init( &crc );
+	CRC32_ProcessBuffer( &crc, ofs, sizeof( *ofs ) * hdr.numrows );
+	CRC32_ProcessBuffer( &crc, data, hdr.datasize );
+
+	if( CRC32_Final( crc ) != hdr.datacrc )
+		goto corrupted;
+
+	world.phsofs = Mem_Malloc( mod->mempool, sizeof( size_t ) * hdr.numrows );
+
+	for( i = 0; i < hdr.numrows; i++ )
+	{
+		if( !Mod_CheckPHSRow( data, ofs[i], hdr.datasize, hdr.visbytes ))
+		{
+			Mem_Free( world.phsofs );
+			world.phsofs = NULL;
+			goto corrupted;
+		}
+
+		world.phsofs[i] = ofs[i];
+	}
+
+	world.compressed_phs = data;
+	Mem_Free( ofs );
+	FS_Close( f );
+
+	Con_Reportf( "Loaded PHS from %s\n", filename );
+	return true;
+
+corrupted:
+	Con_Reportf( S_WARN "%s is corrupted\n", filename );
+	if( ofs ) Mem_Free( ofs );
+	if( data ) Mem_Free( data );
+	FS_Close( f );
+	return false;
+}
+
+/*
+===========
+Mod_SavePHSCache
+===========
+*/
+static void Mod_SavePHSCache( model_t *mod, const dphscache_t *key, size_t datasize )
+{
+	char		filename[MAX_QPATH];
+	dphscache_t	hdr = *key;
+	uint32_t		*ofs;
+	uint32_t		crc;
+	file_t		*f;
+	size_t		i;
+
+	if( datasize > UINT32_MAX )
+		return;
+
+	ofs = Mem_Malloc( mod->mempool, sizeof( *ofs ) * hdr.numrows );
+	for( i = 0; i < hdr.numrows; i++ )
+		ofs[i] = world.phsofs[i];
+
+	CRC32_Init( &crc );
+	CRC32_ProcessBuffer( &crc, ofs, sizeof( *ofs ) * hdr.numrows );
+	CRC32_ProcessBuffer( &crc, world.compressed_phs, datasize );
+
+	hdr.datasize = datasize;
+	hdr.datacrc = CRC32_Final( crc );
+
+	Mod_PHSCacheName( mod, filename, sizeof( filename ));
+
+	if(( f = FS_Open( filename, "wb", true )) != NULL )
+	{
+		FS_Write( f, &hdr, sizeof( hdr ));
+		FS_Write( f, ofs, sizeof( *ofs ) * hdr.numrows );
+		FS_Write( f, world.compressed_phs, datasize );
+		FS_Close( f );
+	}
+	else Con_Reportf( S_WARN "couldn't write %s\n", filename );
+
+	Mem_Free( ofs );
+}
+
 /*
 ===========
 Mod_CalcPHS
@@ -3341,8 +3657,9 @@ Mod_CalcPHS
 To be called while loading world for multiplayer game server
 ===========
 */
-static void Mod_CalcPHS( model_t *mod )
+static void Mod_CalcPHS( model_t *mod, const dbspmodel_t *bmod )
 {
+	dphscache_t key;
 	const qboolean vis_stats = host_developer.value >= DEV_EXTENDED;
 	const size_t rowbytes = ALIGN( world.visbytes, 4 ); // force align rows by 32-bit boundary
 	const size_t count = mod->numleafs + 1; // same as mod->submodels[0].visleafs + 1
@@ -3358,6 +3675,21 @@ static void Mod_CalcPHS( model_t *mod )
 	if( !mod->visdata )
 		return;
 
+	// PHS only depends on visibility, and checksum of visibility lump
+	// is much cheaper than checksum of whole map
+	memset( &key, 0, sizeof( key ));
+	key.ident = IDPHSCACHEHEADER;
+	key.version = PHSCACHE_VERSION;
+	key.vissize = bmod->visdatasize;
+	CRC32_Init( &key.viscrc );
+	CRC32_ProcessBuffer( &key.viscrc, mod->visdata, bmod->visdatasize );
+	key.viscrc = CRC32_Final( key.viscrc );
+	key.numrows = count;
+	key.visbytes = rowbytes;
+
+	if( Mod_LoadPHSCache( mod, &key ))
+		return;
+
 #if defined( HAVE_OPENMP )
 	Con_Reportf( "Building PHS in %d threads...\n", omp_get_max_threads( ));
 #else
@@ -3478,7 +3810,7 @@ static void Mod_CalcPHS( model_t *mod )
 	// release uncompressed data
 	Mem_Free( uncompressed_pvs );
 
-	// TODO: cache the PHS somewhere, it might take a long time on giant maps
+	Mod_SavePHSCache( mod, &key, total_compressed_size );
 }
 
 /*
@@ -3676,6 +4008,32 @@ loading and processing bmodel
 */
 static qboolean Mod_LoadBmodelLumps( model_t *mod, byte *mod_base, size_t bufferlen, qboolean isworld )
 {
+	// order matters, each step uses results of previous ones
+	static const struct
+	{
+		const char *name;
+		void (*func)( model_t *mod, dbspmodel_t *bmod );
+	} loadsteps[] =
+	{
+	{ "entities", Mod_LoadEntities },
+	{ "planes", Mod_LoadPlanes },
+	{ "submodels", Mod_LoadSubmodels },
+	{ "vertexes", Mod_LoadVertexes },
+	{ "edges", Mod_LoadEdges },
+	{ "surfedges", Mod_LoadSurfEdges },
+	{ "textures", Mod_LoadTextures },
+	{ "visibility", Mod_LoadVisibility },
+	{ "texinfo", Mod_LoadTexInfo },
+	{ "surfaces", Mod_LoadSurfaces },
+	{ "lighting", Mod_LoadLighting },
+	{ "marksurfaces", Mod_LoadMarkSurfaces },
+	{ "leafs", Mod_LoadLeafs },
+	{ "nodes", Mod_LoadNodes },
+	{ "clipnodes", Mod_LoadClipnodes },
+	{ "hull0", Mod_MakeHull0 },
+	{ "setup submodels", Mod_SetupSubmodels },
+	};
+	double	steptime[ARRAYSIZE( loadsteps )];
 	dheader_t *header = (dheader_t *)mod_base;
 	dextrahdr_t	*extrahdr = (dextrahdr_t *)(mod_base + sizeof( dheader_t ));
 	dbspmodel_t	*bmod = &srcmodel;
@@ -3748,37 +4106,39 @@ static qboolean Mod_LoadBmodelLumps( model_t *mod, byte *mod_base, size_t buffer
 	else if( !bmod->isworld && loadstat.numwarnings )
 		Con_DPrintf( "Mod_Load%s: %i warning(s)\n", isworld ? "World" : "Brush", loadstat.numwarnings );
 
-	// load into heap
-	Mod_LoadEntities( mod, bmod );
-	Mod_LoadPlanes( mod, bmod );
-	Mod_LoadSubmodels( mod, bmod );
-	Mod_LoadVertexes( mod, bmod );
-	Mod_LoadEdges( mod, bmod );
-	Mod_LoadSurfEdges( mod, bmod );
-	Mod_LoadTextures( mod, bmod );
-	Mod_LoadVisibility( mod, bmod );
-	Mod_LoadTexInfo( mod, bmod );
-	Mod_LoadSurfaces( mod, bmod );
-	Mod_LoadLighting( mod, bmod );
-	Mod_LoadMarkSurfaces( mod, bmod );
-	Mod_LoadLeafs( mod, bmod );
-	Mod_LoadNodes( mod, bmod );
-	Mod_LoadClipnodes( mod, bmod );
-
-	// preform some post-initalization
-	Mod_MakeHull0( mod, bmod );
-	Mod_SetupSubmodels( mod, bmod );
+	// load into heap and preform some post-initalization
+	for( i = 0; i < ARRAYSIZE( loadsteps ); i++ )
+	{
+		double t1 = Platform_DoubleTime();
+
+		loadsteps[i].func( mod, bmod );
+		steptime[i] = Platform_DoubleTime() - t1;
+	}
+
+	if( isworld && host_developer.value )
+	{
+		double total = 0.0;
+
+		for( i = 0; i < ARRAYSIZE( loadsteps ); i++ )
+		{
+			Con_DPrintf( "%-16s %8.2f ms\n", loadsteps[i].name, steptime[i] * 1000.0 );
+			total += steptime[i];
+		}
+
+		Con_DPrintf( "%-16s %8.2f ms\n", "total", total * 1000.0 );
+	}
 
 	if( isworld )
 	{
 		world.version = bmod->version;
+		Mod_SetupFlatClipnodes( mod, bmod );
 #if !XASH_DEDICATED
 		world.deluxedata = bmod->deluxedata_out;	// deluxemap data pointer
 		world.shadowdata = bmod->shadowdata_out;	// occlusion data pointer
 #endif // XASH_DEDICATED
 
 		if( SV_Active() && svs.maxclients > 1 )
-			Mod_CalcPHS( mod );
+			Mod_CalcPHS( mod, bmod );
 	}
 
 	for( i = 0; i < world.wadlist.count; i++ )
@@ -3939,7 +4299,7 @@ void Mod_LoadBrushModel( model_t *mod, void *buffer, size_t buffersize, qboolean
 
 	if( loaded ) *loaded = false;
 
-	mod->mempool = Mem_AllocPool( poolname );
+	mod->mempool = Mem_AllocPoolExt( poolname, MEMPOOL_ARENA );
 	mod->type = mod_brush;
 
 	// loading all the lumps into heap
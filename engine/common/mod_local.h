@@ -82,6 +82,23 @@ typedef struct
 	uint		num_polys;
 } hull_model_t;
 
+// clipnode with its splitting plane stored inline, so hull traversal
+// touches a single cache line per node instead of two separate arrays
+typedef struct mclipnode_flat_s
+{
+	mplane_t	plane;
+	int	children[2];
+	int	pad;
+} mclipnode_flat_t;
+
+typedef struct
+{
+	const void	*source;		// hull->clipnodes16 or hull->clipnodes32 it was built from
+	mplane_t		*planes;		// source planes, for the reference hull checks
+	mclipnode_flat_t	*nodes;
+	int		numnodes;
+} mflatclipnodes_t;
+
 typedef struct wadlist_s
 {
 	char wadnames[MAX_MAP_WADS][36]; // including .wad extension
@@ -126,6 +143,10 @@ typedef struct world_static_s
 	size_t *phsofs;
 
 	wadlist_t wadlist;
+
+	// flattened world clipnodes, looked up by PM_RecursiveHullCheck
+	mflatclipnodes_t flatclipnodes[MAX_MAP_HULLS];
+	int              num_flatclipnodes;
 } world_static_t;
 
 #ifndef REF_DLL
@@ -138,6 +159,27 @@ extern convar_t       r_allow_wad3_luma;
 extern const mclipnode16_t box_clipnodes16[6];
 extern const mclipnode32_t box_clipnodes32[6];
 
+/*
+===============
+Mod_FlatClipnodesForHull
+
+returns flattened clipnodes for world hulls, NULL for
+box, studio and any other hulls that weren't flattened
+===============
+*/
+static inline const mclipnode_flat_t *Mod_FlatClipnodesForHull( const hull_t *hull )
+{
+	int i;
+
+	for( i = 0; i < world.num_flatclipnodes; i++ )
+	{
+		if( world.flatclipnodes[i].source == (const void *)hull->clipnodes16 )
+			return world.flatclipnodes[i].nodes;
+	}
+
+	return NULL;
+}
+
 //
 // model.c
 //
@@ -179,6 +221,7 @@ int Mod_SampleSizeForFace( const msurface_t *surf );
 byte *Mod_GetPVSForPoint( const vec3_t p );
 void Mod_UnloadBrushModel( model_t *mod );
 void Mod_PrintWorldStats_f( void );
+mclipnode_flat_t *Mod_FlattenClipnodes( poolhandle_t pool, const hull_t *hull, int numnodes, int numplanes );
 
 //
 // mod_dbghulls.c
@@ -204,6 +247,7 @@ void *R_StudioGetAnim( studiohdr_t *m_pStudioHeader, model_t *m_pSubModel, mstud
 void Mod_StudioComputeBounds( void *buffer, vec3_t mins, vec3_t maxs, qboolean ignore_sequences );
 int Mod_HitgroupForStudioHull( int index );
 void Mod_ClearStudioCache( void );
+void Mod_StudioCacheInfo_f( void );
 
 //
 // mod_sprite.c
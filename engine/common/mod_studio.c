@@ -22,41 +22,50 @@ GNU General Public License for more details.
 
 typedef int (*STUDIOAPI)( int, sv_blending_interface_t**, server_studio_api_t*,  float (*transform)[3][4], float (*bones)[MAXSTUDIOBONES][3][4] );
 
+// hitbox planes of one entity without trace size applied
 typedef struct mstudiocache_s
 {
+	int     stamp;		// valid if matches cache_stamp
 	model_t *model;
 	float   frame;
 	int     sequence;
 	vec3_t  angles;
 	vec3_t  origin;
-	vec3_t  size;
 	byte    controller[4];
 	byte    blending[2];
-	uint    current_hull;
-	uint    current_plane;
+	qboolean skipshield;
+	uint    firstplane;
 	uint    numhitboxes;
 } mstudiocache_t;
 
-#define STUDIO_CACHESIZE		16
-#define STUDIO_CACHEMASK		(STUDIO_CACHESIZE - 1)
+#define STUDIO_CACHE_PLANES	( MAXSTUDIOBONES * 6 * 8 )	// ~50 player models per frame
+#define STUDIO_CACHE_ANON	16	// physents without edict
 
 // trace global variables
 static sv_blending_interface_t	*pBlendAPI = NULL;
 static studiohdr_t			*mod_studiohdr;
 static matrix3x4			studio_transform;
-static hull_t			cache_hull[MAXSTUDIOBONES];
 static hull_t			studio_hull[MAXSTUDIOBONES];
 static matrix3x4			studio_bones[MAXSTUDIOBONES];
 static uint			studio_hull_hitgroup[MAXSTUDIOBONES];
-static uint			cache_hull_hitgroup[MAXSTUDIOBONES];
-static mstudiocache_t		cache_studio[STUDIO_CACHESIZE];
 static mplane_t			studio_planes[MAXSTUDIOBONES * 6];
-static mplane_t			cache_planes[MAXSTUDIOBONES * 6];
 
 // current cache state
-static int			cache_current;
-static int			cache_current_hull;
+static mstudiocache_t		*cache_entities;	// indexed by edict number
+static int			cache_numentities;
+static mstudiocache_t		cache_anon[STUDIO_CACHE_ANON];
+static int			cache_anon_current;
+static mplane_t			cache_planes[STUDIO_CACHE_PLANES];
 static int			cache_current_plane;
+static int			cache_stamp = 1;
+static int			cache_framecount;
+
+static struct
+{
+	uint	hits;
+	uint	misses;
+	uint	resets;	// planes pool was full
+} cache_stats;
 
 /*
 ====================
@@ -89,51 +98,68 @@ void Mod_InitStudioHull( void )
 /*
 ====================
 ClearStudioCache
+
+cache_entities memory is owned by com_studiocache
 ====================
 */
 void Mod_ClearStudioCache( void )
 {
-	memset( cache_studio, 0, sizeof( cache_studio ));
-	cache_current_hull = cache_current_plane = 0;
-
-	cache_current = 0;
+	cache_entities = NULL;
+	cache_numentities = 0;
+	memset( cache_anon, 0, sizeof( cache_anon ));
+	cache_current_plane = 0;
+	cache_stamp++;
 }
 
 /*
 ====================
-AddToStudioCache
+StudioCacheForEdict
+
+returns cache slot for this entity, it's contents may be outdated
 ====================
 */
-static void Mod_AddToStudioCache( float frame, int sequence, vec3_t angles, vec3_t origin, vec3_t size, byte *pcontroller, byte *pblending, model_t *model, hull_t *hull, int numhitboxes )
+static mstudiocache_t *Mod_StudioCacheForEdict( edict_t *pEdict, model_t *model, float frame, int sequence, const vec3_t angles, const vec3_t origin, const byte *controller, const byte *blending )
 {
-	mstudiocache_t *pCache;
+	mstudiocache_t	*pCached;
+	int		i;
 
-	if( numhitboxes + cache_current_hull >= MAXSTUDIOBONES )
-		Mod_ClearStudioCache();
+	// hitboxes can't be reused between frames because game may blend them in any way
+	if( cache_framecount != sv.framecount )
+	{
+		cache_framecount = sv.framecount;
+		cache_current_plane = 0;
+		cache_stamp++;
+	}
 
-	cache_current++;
-	pCache = &cache_studio[cache_current & STUDIO_CACHEMASK];
+	if( SV_IsValidEdict( pEdict ))
+	{
+		int num = NUM_FOR_EDICT( pEdict );
 
-	pCache->frame = frame;
-	pCache->sequence = sequence;
-	VectorCopy( angles, pCache->angles );
-	VectorCopy( origin, pCache->origin );
-	VectorCopy( size, pCache->size );
+		if( num >= cache_numentities )
+		{
+			cache_entities = Mem_Realloc( com_studiocache, cache_entities, sizeof( *cache_entities ) * GI->max_edicts );
+			cache_numentities = GI->max_edicts;
+		}
 
-	memcpy( pCache->controller, pcontroller, 4 );
-	memcpy( pCache->blending, pblending, 2 );
+		return &cache_entities[num];
+	}
 
-	pCache->model = model;
-	pCache->current_hull = cache_current_hull;
-	pCache->current_plane = cache_current_plane;
+	// physents don't have edicts, search by key
+	for( i = 0; i < STUDIO_CACHE_ANON; i++ )
+	{
+		pCached = &cache_anon[(cache_anon_current - i) & ( STUDIO_CACHE_ANON - 1 )];
+
+		if( pCached->stamp != cache_stamp || pCached->model != model )
+			continue;
 
-	memcpy( &cache_hull[cache_current_hull], hull, numhitboxes * sizeof( hull_t ));
-	memcpy( &cache_planes[cache_current_plane], studio_planes, numhitboxes * sizeof( mplane_t ) * 6 );
-	memcpy( &cache_hull_hitgroup[cache_current_hull], studio_hull_hitgroup, numhitboxes * sizeof( uint ));
+		if( pCached->frame == frame && pCached->sequence == sequence && VectorCompare( pCached->angles, angles )
+			&& VectorCompare( pCached->origin, origin ) && !memcmp( pCached->controller, controller, 4 )
+			&& !memcmp( pCached->blending, blending, 2 ))
+			return pCached;
+	}
 
-	cache_current_hull += numhitboxes;
-	cache_current_plane += numhitboxes * 6;
-	pCache->numhitboxes = numhitboxes;
+	cache_anon_current++;
+	return &cache_anon[cache_anon_current & ( STUDIO_CACHE_ANON - 1 )];
 }
 
 /*
@@ -141,43 +167,89 @@ static void Mod_AddToStudioCache( float frame, int sequence, vec3_t angles, vec3
 CheckStudioCache
 ====================
 */
-static mstudiocache_t *Mod_CheckStudioCache( model_t *model, float frame, int sequence, vec3_t angles, vec3_t origin, vec3_t size, byte *controller, byte *blending )
+static qboolean Mod_CheckStudioCache( const mstudiocache_t *pCached, model_t *model, float frame, int sequence, const vec3_t angles, const vec3_t origin, const byte *controller, const byte *blending, qboolean skipshield )
 {
-	mstudiocache_t	*pCached;
-	int		i;
+	if( pCached->stamp != cache_stamp )
+		return false;
 
-	for( i = 0; i < STUDIO_CACHESIZE; i++ )
-	{
-		pCached = &cache_studio[(cache_current - i) & STUDIO_CACHEMASK];
+	if( pCached->model != model )
+		return false;
 
-		if( pCached->model != model )
-			continue;
+	if( pCached->frame != frame )
+		return false;
 
-		if( pCached->frame != frame )
-			continue;
+	if( pCached->sequence != sequence )
+		return false;
 
-		if( pCached->sequence != sequence )
-			continue;
+	if( !VectorCompare( pCached->angles, angles ))
+		return false;
 
-		if( !VectorCompare( pCached->angles, angles ))
-			continue;
+	if( !VectorCompare( pCached->origin, origin ))
+		return false;
 
-		if( !VectorCompare( pCached->origin, origin ))
-			continue;
+	if( memcmp( pCached->controller, controller, 4 ) != 0 )
+		return false;
 
-		if( !VectorCompare( pCached->size, size ))
-			continue;
+	if( memcmp( pCached->blending, blending, 2 ) != 0 )
+		return false;
 
-		if( memcmp( pCached->controller, controller, 4 ) != 0 )
-			continue;
+	if( pCached->skipshield != skipshield )
+		return false;
 
-		if( memcmp( pCached->blending, blending, 2 ) != 0 )
-			continue;
+	return true;
+}
+
+/*
+====================
+AddToStudioCache
 
-		return pCached;
+reserve planes for entity hitboxes, returns NULL if cache can't be used
+====================
+*/
+static mplane_t *Mod_AddToStudioCache( mstudiocache_t *pCache, model_t *model, float frame, int sequence, const vec3_t angles, const vec3_t origin, const byte *controller, const byte *blending, qboolean skipshield, int numhitboxes )
+{
+	if( numhitboxes * 6 > STUDIO_CACHE_PLANES )
+		return NULL;
+
+	if( cache_current_plane + numhitboxes * 6 > STUDIO_CACHE_PLANES )
+	{
+		// invalidate everything cached in this frame
+		cache_current_plane = 0;
+		cache_stamp++;
+		cache_stats.resets++;
 	}
 
-	return NULL;
+	pCache->stamp = cache_stamp;
+	pCache->model = model;
+	pCache->frame = frame;
+	pCache->sequence = sequence;
+	VectorCopy( angles, pCache->angles );
+	VectorCopy( origin, pCache->origin );
+	memcpy( pCache->controller, controller, 4 );
+	memcpy( pCache->blending, blending, 2 );
+	pCache->skipshield = skipshield;
+	pCache->firstplane = cache_current_plane;
+	pCache->numhitboxes = numhitboxes;
+
+	cache_current_plane += numhitboxes * 6;
+
+	return &cache_planes[pCache->firstplane];
+}
+
+/*
+====================
+StudioCacheInfo_f
+====================
+*/
+void Mod_StudioCacheInfo_f( void )
+{
+	uint total = cache_stats.hits + cache_stats.misses;
+
+	Con_Printf( "studio cache: %u hits, %u misses (%.1f%% hit rate)\n", cache_stats.hits, cache_stats.misses, total ? cache_stats.hits * 100.0 / total : 0.0 );
+	Con_Printf( "%u pool resets, %i/%i planes used\n", cache_stats.resets, cache_current_plane, STUDIO_CACHE_PLANES );
+
+	if( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ))
+		memset( &cache_stats, 0, sizeof( cache_stats ));
 }
 
 /*
@@ -192,10 +264,8 @@ static mstudiocache_t *Mod_CheckStudioCache( model_t *model, float frame, int se
 SetStudioHullPlane
 ====================
 */
-static void Mod_SetStudioHullPlane( int planenum, int bone, int axis, float offset, const vec3_t size )
+static void Mod_SetStudioHullPlane( mplane_t *pl, int bone, int axis, float offset )
 {
-	mplane_t	*pl = &studio_planes[planenum];
-
 	pl->type = 5;
 
 	pl->normal[0] = studio_bones[bone][0][axis];
@@ -203,10 +273,23 @@ static void Mod_SetStudioHullPlane( int planenum, int bone, int axis, float offs
 	pl->normal[2] = studio_bones[bone][2][axis];
 
 	pl->dist = (pl->normal[0] * studio_bones[bone][0][3]) + (pl->normal[1] * studio_bones[bone][1][3]) + (pl->normal[2] * studio_bones[bone][2][3]) + offset;
+}
+
+/*
+====================
+ExpandStudioHullPlane
+
+apply trace size to plane from bones
+====================
+*/
+static void Mod_ExpandStudioHullPlane( int planenum, const mplane_t *base, const vec3_t size )
+{
+	mplane_t	*pl = &studio_planes[planenum];
+
+	*pl = *base;
 
 	if( planenum & 1 ) pl->dist -= DotProductFabs( pl->normal, size );
 	else pl->dist += DotProductFabs( pl->normal, size );
-
 }
 
 /*
@@ -218,43 +301,64 @@ NOTE: pEdict may be NULL
 */
 hull_t *Mod_HullForStudio( model_t *model, float frame, int sequence, vec3_t angles, vec3_t origin, vec3_t size, byte *pcontroller, byte *pblending, int *numhitboxes, edict_t *pEdict )
 {
-	vec3_t		angles2;
-	mstudiocache_t	*bonecache;
+	mstudiocache_t	*bonecache = NULL;
+	mplane_t		*planes = NULL;
 	mstudiobbox_t	*phitbox;
 	qboolean		bSkipShield;
+	vec3_t		angles2;
 	int		i, j;
 
-	bSkipShield = false;
 	*numhitboxes = 0; // assume error
 
+	mod_studiohdr = Mod_StudioExtradata( model );
+	if( !mod_studiohdr ) return NULL; // probably not a studiomodel
+
+	bSkipShield = SV_IsValidEdict( pEdict ) && pEdict->v.gamestate == 1;
+	phitbox = (mstudiobbox_t *)((byte *)mod_studiohdr + mod_studiohdr->hitboxindex);
+
 	if( mod_studiocache.value )
 	{
-		bonecache = Mod_CheckStudioCache( model, frame, sequence, angles, origin, size, pcontroller, pblending );
+		bonecache = Mod_StudioCacheForEdict( pEdict, model, frame, sequence, angles, origin, pcontroller, pblending );
 
-		if( bonecache != NULL )
+		if( Mod_CheckStudioCache( bonecache, model, frame, sequence, angles, origin, pcontroller, pblending, bSkipShield ))
 		{
-			memcpy( studio_planes, &cache_planes[bonecache->current_plane], bonecache->numhitboxes * sizeof( mplane_t ) * 6 );
-			memcpy( studio_hull_hitgroup, &cache_hull_hitgroup[bonecache->current_hull], bonecache->numhitboxes * sizeof( uint ));
-			memcpy( studio_hull, &cache_hull[bonecache->current_hull], bonecache->numhitboxes * sizeof( hull_t ));
-
-			*numhitboxes = bonecache->numhitboxes;
-			return studio_hull;
+			planes = &cache_planes[bonecache->firstplane];
+			cache_stats.hits++;
+		}
+		else
+		{
+			planes = Mod_AddToStudioCache( bonecache, model, frame, sequence, angles, origin, pcontroller, pblending, bSkipShield, mod_studiohdr->numhitboxes );
+			bonecache = NULL; // bones must be set up
+			cache_stats.misses++;
 		}
 	}
 
-	mod_studiohdr = Mod_StudioExtradata( model );
-	if( !mod_studiohdr ) return NULL; // probably not a studiomodel
+	// cache is disabled or full, expand in place
+	if( !planes )
+		planes = studio_planes;
 
-	VectorCopy( angles, angles2 );
+	if( !bonecache )
+	{
+		VectorCopy( angles, angles2 );
 
-	if( !FBitSet( host.features, ENGINE_COMPENSATE_QUAKE_BUG ))
-		angles2[PITCH] = -angles2[PITCH]; // stupid quake bug
+		if( !FBitSet( host.features, ENGINE_COMPENSATE_QUAKE_BUG ))
+			angles2[PITCH] = -angles2[PITCH]; // stupid quake bug
 
-	pBlendAPI->SV_StudioSetupBones( model, frame, sequence, angles2, origin, pcontroller, pblending, -1, pEdict );
-	phitbox = (mstudiobbox_t *)((byte *)mod_studiohdr + mod_studiohdr->hitboxindex);
+		pBlendAPI->SV_StudioSetupBones( model, frame, sequence, angles2, origin, pcontroller, pblending, -1, pEdict );
 
-	if( SV_IsValidEdict( pEdict ) && pEdict->v.gamestate == 1 )
-		bSkipShield = 1;
+		for( i = j = 0; i < mod_studiohdr->numhitboxes; i++, j += 6 )
+		{
+			if( bSkipShield && i == 21 )
+				continue;	// CS stuff
+
+			Mod_SetStudioHullPlane( &planes[j + 0], phitbox[i].bone, 0, phitbox[i].bbmax[0] );
+			Mod_SetStudioHullPlane( &planes[j + 1], phitbox[i].bone, 0, phitbox[i].bbmin[0] );
+			Mod_SetStudioHullPlane( &planes[j + 2], phitbox[i].bone, 1, phitbox[i].bbmax[1] );
+			Mod_SetStudioHullPlane( &planes[j + 3], phitbox[i].bone, 1, phitbox[i].bbmin[1] );
+			Mod_SetStudioHullPlane( &planes[j + 4], phitbox[i].bone, 2, phitbox[i].bbmax[2] );
+			Mod_SetStudioHullPlane( &planes[j + 5], phitbox[i].bone, 2, phitbox[i].bbmin[2] );
+		}
+	}
 
 	for( i = j = 0; i < mod_studiohdr->numhitboxes; i++, j += 6 )
 	{
@@ -268,20 +372,17 @@ hull_t *Mod_HullForStudio( model_t *model, float frame, int sequence, vec3_t ang
 
 		studio_hull_hitgroup[i] = phitbox[i].group;
 
-		Mod_SetStudioHullPlane( j + 0, phitbox[i].bone, 0, phitbox[i].bbmax[0], size );
-		Mod_SetStudioHullPlane( j + 1, phitbox[i].bone, 0, phitbox[i].bbmin[0], size );
-		Mod_SetStudioHullPlane( j + 2, phitbox[i].bone, 1, phitbox[i].bbmax[1], size );
-		Mod_SetStudioHullPlane( j + 3, phitbox[i].bone, 1, phitbox[i].bbmin[1], size );
-		Mod_SetStudioHullPlane( j + 4, phitbox[i].bone, 2, phitbox[i].bbmax[2], size );
-		Mod_SetStudioHullPlane( j + 5, phitbox[i].bone, 2, phitbox[i].bbmin[2], size );
+		Mod_ExpandStudioHullPlane( j + 0, &planes[j + 0], size );
+		Mod_ExpandStudioHullPlane( j + 1, &planes[j + 1], size );
+		Mod_ExpandStudioHullPlane( j + 2, &planes[j + 2], size );
+		Mod_ExpandStudioHullPlane( j + 3, &planes[j + 3], size );
+		Mod_ExpandStudioHullPlane( j + 4, &planes[j + 4], size );
+		Mod_ExpandStudioHullPlane( j + 5, &planes[j + 5], size );
 	}
 
 	// tell trace code about hitbox count
 	*numhitboxes = (bSkipShield) ? (mod_studiohdr->numhitboxes - 1) : (mod_studiohdr->numhitboxes);
 
-	if( mod_studiocache.value )
-		Mod_AddToStudioCache( frame, sequence, angles, origin, size, pcontroller, pblending, model, studio_hull, *numhitboxes );
-
 	return studio_hull;
 }
 
@@ -461,7 +562,7 @@ static void SV_StudioSetupBones( model_t *pModel,	float frame, int sequence, con
 
 	static float	pos[MAXSTUDIOBONES][3];
 	static vec4_t	q[MAXSTUDIOBONES];
-	matrix3x4		bonematrix;
+	static matrix3x4	bonematrix[MAXSTUDIOBONES];
 
 	static float	pos2[MAXSTUDIOBONES][3];
 	static vec4_t	q2[MAXSTUDIOBONES];
@@ -532,14 +633,21 @@ static void SV_StudioSetupBones( model_t *pModel,	float frame, int sequence, con
 
 	Matrix3x4_CreateFromEntity( studio_transform, angles, origin, 1.0f );
 
+	// attachments only need a short chain of parent bones,
+	// it's cheaper to convert just these one by one
+	if( iBone == -1 )
+		R_StudioBoneMatrices( mod_studiohdr->numbones, q, pos, bonematrix );
+
 	for( j = numbones - 1; j >= 0; j-- )
 	{
 		i = boneused[j];
 
-		Matrix3x4_FromOriginQuat( bonematrix, q[i], pos[i] );
+		if( iBone != -1 )
+			Matrix3x4_FromOriginQuat( bonematrix[i], q[i], pos[i] );
+
 		if( pbones[i].parent == -1 )
-			Matrix3x4_ConcatTransforms( studio_bones[i], studio_transform, bonematrix );
-		else Matrix3x4_ConcatTransforms( studio_bones[i], studio_bones[pbones[i].parent], bonematrix );
+			Matrix3x4_ConcatTransforms( studio_bones[i], studio_transform, bonematrix[i] );
+		else Matrix3x4_ConcatTransforms( studio_bones[i], studio_bones[pbones[i].parent], bonematrix[i] );
 	}
 }
 
@@ -863,7 +971,7 @@ void Mod_LoadStudioModel( model_t *mod, const void *buffer, qboolean *loaded )
 	Q_snprintf( poolname, sizeof( poolname ), "^2%s^7", mod->name );
 
 	if( loaded ) *loaded = false;
-	mod->mempool = Mem_AllocPool( poolname );
+	mod->mempool = Mem_AllocPoolExt( poolname, MEMPOOL_ARENA );
 	mod->type = mod_studio;
 
 	phdr = R_StudioLoadHeader( mod, buffer );
@@ -21,6 +21,7 @@ GNU General Public License for more details.
 #include "wadfile.h"
 #include "world.h"
 #include "enginefeatures.h"
+#include "pm_local.h"
 #include "client.h"
 #include "server.h"
 
@@ -120,6 +121,7 @@ void Mod_FreeModel( model_t *mod )
 		world.hull_models = NULL;
 		world.compressed_phs = NULL;
 		world.phsofs = NULL;
+		world.num_flatclipnodes = 0;
 	}
 
 	memset( mod, 0, sizeof( *mod ));
@@ -147,6 +149,9 @@ void Mod_Init( void )
 
 	Cmd_AddCommand( "mapstats", Mod_PrintWorldStats_f, "show stats for currently loaded map" );
 	Cmd_AddCommand( "modellist", Mod_Modellist_f, "display loaded models list" );
+	Cmd_AddCommand( "studiocacheinfo", Mod_StudioCacheInfo_f, "show studio hitbox cache stats, \"reset\" to clear them" );
+	Cmd_AddCommand( "pm_tracerecord", PM_TraceRecord_f, "record world hull traces on current map into a file" );
+	Cmd_AddCommand( "pm_tracebench", PM_TraceBench_f, "replay recorded hull traces and compare recursive and iterative hull checks" );
 
 	Mod_ResetStudioAPI ();
 	Mod_InitStudioHull ();
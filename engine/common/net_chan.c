@@ -175,7 +175,9 @@ void Netchan_Init( void )
 	Cvar_RegisterVariable( &net_recv_debug );
 	Cvar_FullSet( net_qport.name, buf, net_qport.flags );
 
-	net_mempool = Mem_AllocPool( "Network Pool" );
+	// waiting lists and outgoing fragments at default MTU fit into size classes,
+	// incoming and local fragment buffers are bigger and get regular blocks
+	net_mempool = Mem_AllocPoolExt( "Network Pool", MEMPOOL_SLAB );
 }
 
 void Netchan_Shutdown( void )
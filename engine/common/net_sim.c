@@ -0,0 +1,591 @@
+/*
+net_sim.c - network condition simulator
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "net_sim.h"
+#include "xash3d_mathlib.h"
+#include "eiface.h" // ARRAYSIZE
+
+struct netsim_packet_s
+{
+	double		time;	// when packet will be delivered
+	uint		order;	// keeps equal times in queue order
+	uint		sequence;	// arrival number, duplicates share it
+	netadr_t		from;
+	size_t		size;
+};
+
+static const struct
+{
+	const char	*name;
+	size_t		offset;
+	const char	*desc;
+} netsim_fields[] =
+{
+{ "latency", offsetof( netsim_params_t, latency ), "base latency, ms" },
+{ "jitter", offsetof( netsim_params_t, jitter ), "latency variation, ms" },
+{ "dist", offsetof( netsim_params_t, dist ), "jitter distribution: 0 - uniform, 1 - normal, 2 - pareto" },
+{ "reorder", offsetof( netsim_params_t, reorder ), "% of packets sent without latency" },
+{ "duplicate", offsetof( netsim_params_t, duplicate ), "% of duplicated packets" },
+{ "loss", offsetof( netsim_params_t, loss ), "% of randomly lost packets" },
+{ "burst_enter", offsetof( netsim_params_t, burst_enter ), "% chance to enter burst loss state" },
+{ "burst_leave", offsetof( netsim_params_t, burst_leave ), "% chance to leave burst loss state" },
+{ "burst_loss", offsetof( netsim_params_t, burst_loss ), "% of lost packets in burst loss state" },
+{ "rate", offsetof( netsim_params_t, rate ), "bandwidth cap, kbit/s" },
+{ "burst", offsetof( netsim_params_t, burst ), "bandwidth bucket depth, bytes" },
+{ "queue", offsetof( netsim_params_t, queue ), "bandwidth backlog limit, bytes" },
+};
+
+/*
+==================
+NetSim_Defaults
+
+simulator without any effect
+==================
+*/
+void NetSim_Defaults( netsim_params_t *params )
+{
+	memset( params, 0, sizeof( *params ));
+	params->burst_loss = 100.0f;
+	params->burst = 1500.0f;
+	params->queue = 65536.0f;
+}
+
+/*
+==================
+NetSim_Seed
+
+restart random sequence and drop queued packets
+==================
+*/
+void NetSim_Seed( netsim_t *sim, uint seed )
+{
+	uint x = seed + 0x9e3779b9;
+
+	NetSim_Clear( sim );
+
+	// scramble the seed, so close seeds give unrelated sequences
+	x = ( x ^ ( x >> 16 )) * 0x85ebca6b;
+	x = ( x ^ ( x >> 13 )) * 0xc2b2ae35;
+	x ^= x >> 16;
+
+	sim->seed = seed;
+	sim->rng = x ? x : 1;
+	sim->badstate = false;
+	sim->tokens = 0.0;
+	sim->tokentime = -1.0;
+	sim->sequence = 0;
+	sim->lastdelivered = 0;
+	memset( &sim->stats, 0, sizeof( sim->stats ));
+}
+
+/*
+==================
+NetSim_Clear
+
+free queued packets
+==================
+*/
+void NetSim_Clear( netsim_t *sim )
+{
+	int i;
+
+	for( i = 0; i < sim->count; i++ )
+		Mem_Free( sim->heap[i] );
+
+	if( sim->heap )
+		Mem_Free( sim->heap );
+
+	sim->heap = NULL;
+	sim->count = sim->maxcount = 0;
+}
+
+/*
+==================
+NetSim_Active
+
+returns true if simulator affects traffic
+==================
+*/
+qboolean NetSim_Active( const netsim_t *sim )
+{
+	const netsim_params_t *p = &sim->params;
+
+	if( sim->fakelag > 0.0f || sim->count > 0 )
+		return true;
+
+	return p->latency > 0.0f || p->jitter > 0.0f || p->duplicate > 0.0f || p->loss > 0.0f
+		|| p->burst_enter > 0.0f || p->rate > 0.0f;
+}
+
+static uint NetSim_Random( netsim_t *sim )
+{
+	uint x = sim->rng;
+
+	// xorshift32
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return sim->rng = x;
+}
+
+static double NetSim_RandomFloat( netsim_t *sim )
+{
+	return ( NetSim_Random( sim ) >> 8 ) * ( 1.0 / 16777216.0 ); // [0..1)
+}
+
+static qboolean NetSim_Chance( netsim_t *sim, float percent )
+{
+	if( percent <= 0.0f )
+		return false;
+
+	return NetSim_RandomFloat( sim ) * 100.0 < percent;
+}
+
+/*
+==================
+NetSim_Lost
+
+random loss and Gilbert-Elliott burst loss
+==================
+*/
+static qboolean NetSim_Lost( netsim_t *sim )
+{
+	const netsim_params_t *p = &sim->params;
+
+	if( p->burst_enter > 0.0f )
+	{
+		if( sim->badstate )
+		{
+			if( NetSim_Chance( sim, p->burst_leave ))
+				sim->badstate = false;
+		}
+		else if( NetSim_Chance( sim, p->burst_enter ))
+			sim->badstate = true;
+
+		if( sim->badstate )
+		{
+			if( !NetSim_Chance( sim, p->burst_loss ))
+				return false;
+
+			sim->stats.burstlost++;
+			return true;
+		}
+	}
+
+	if( !NetSim_Chance( sim, p->loss ))
+		return false;
+
+	sim->stats.lost++;
+	return true;
+}
+
+/*
+==================
+NetSim_Shape
+
+token bucket, returns time when packet leaves the link or -1 if backlog is full
+==================
+*/
+static double NetSim_Shape( netsim_t *sim, double time, size_t length )
+{
+	const netsim_params_t *p = &sim->params;
+	double bps, depth;
+
+	if( p->rate <= 0.0f )
+		return time;
+
+	bps = p->rate * 125.0; // kbit/s to bytes/s
+	depth = Q_max( p->burst, (double)length );
+
+	if( sim->tokentime < 0.0 )
+		sim->tokens = depth;
+	else sim->tokens = Q_min( depth, sim->tokens + ( time - sim->tokentime ) * bps );
+	sim->tokentime = time;
+
+	if( sim->tokens - length < -p->queue )
+	{
+		sim->stats.overflow++;
+		return -1.0;
+	}
+
+	sim->tokens -= length;
+
+	if( sim->tokens >= 0.0 )
+		return time;
+
+	// wait until the bucket pays the debt back
+	return time + -sim->tokens / bps;
+}
+
+/*
+==================
+NetSim_Latency
+
+latency sample in seconds
+==================
+*/
+static double NetSim_Latency( netsim_t *sim )
+{
+	const netsim_params_t *p = &sim->params;
+	double latency = p->latency + sim->fakelag;
+	double u;
+
+	if( p->jitter > 0.0f )
+	{
+		switch( (int)p->dist )
+		{
+		case NETSIM_DIST_NORMAL:
+			// Box-Muller
+			u = 1.0 - NetSim_RandomFloat( sim );
+			latency += p->jitter * sqrt( -2.0 * log( u )) * cos( 2.0 * M_PI * NetSim_RandomFloat( sim ));
+			break;
+		case NETSIM_DIST_PARETO:
+			// shape 3 with scale 2/3 gives the tail mean of jitter
+			u = 1.0 - NetSim_RandomFloat( sim );
+			latency += p->jitter * ( 2.0 / 3.0 ) * pow( u, -1.0 / 3.0 );
+			break;
+		default:
+			latency += p->jitter * ( NetSim_RandomFloat( sim ) * 2.0 - 1.0 );
+			break;
+		}
+	}
+
+	return Q_max( latency, 0.0 ) * 0.001;
+}
+
+static qboolean NetSim_Before( const netsim_packet_t *a, const netsim_packet_t *b )
+{
+	if( a->time != b->time )
+		return a->time < b->time;
+
+	return a->order < b->order;
+}
+
+static void NetSim_Push( netsim_t *sim, double time, int copy, const netadr_t *from, const void *data, size_t length )
+{
+	netsim_packet_t *packet;
+	int i;
+
+	if( sim->count >= NETSIM_MAX_PACKETS )
+	{
+		sim->stats.overflow++;
+		return;
+	}
+
+	if( sim->count == sim->maxcount )
+	{
+		sim->maxcount = sim->maxcount ? sim->maxcount * 2 : 64;
+		sim->heap = Z_Realloc( sim->heap, sim->maxcount * sizeof( *sim->heap ));
+	}
+
+	// packet data follows the header
+	packet = Z_Malloc( sizeof( *packet ) + length );
+	packet->time = time;
+	packet->order = sim->sequence * 2 + copy;
+	packet->sequence = sim->sequence;
+	packet->from = *from;
+	packet->size = length;
+	memcpy( packet + 1, data, length );
+
+	// sift up
+	for( i = sim->count++; i > 0; )
+	{
+		int parent = ( i - 1 ) / 2;
+
+		if( !NetSim_Before( packet, sim->heap[parent] ))
+			break;
+
+		sim->heap[i] = sim->heap[parent];
+		i = parent;
+	}
+
+	sim->heap[i] = packet;
+}
+
+static netsim_packet_t *NetSim_Pop( netsim_t *sim )
+{
+	netsim_packet_t *top = sim->heap[0];
+	netsim_packet_t *last = sim->heap[--sim->count];
+	int i = 0;
+
+	// sift down
+	while( true )
+	{
+		int child = i * 2 + 1;
+
+		if( child >= sim->count )
+			break;
+
+		if( child + 1 < sim->count && NetSim_Before( sim->heap[child + 1], sim->heap[child] ))
+			child++;
+
+		if( !NetSim_Before( sim->heap[child], last ))
+			break;
+
+		sim->heap[i] = sim->heap[child];
+		i = child;
+	}
+
+	if( sim->count > 0 )
+		sim->heap[i] = last;
+
+	return top;
+}
+
+/*
+==================
+NetSim_Queue
+
+pass received packet through the simulated link
+==================
+*/
+void NetSim_Queue( netsim_t *sim, double time, const netadr_t *from, const void *data, size_t length )
+{
+	const netsim_params_t *p = &sim->params;
+	double sendtime;
+	int i, copies = 1;
+
+	sim->stats.received++;
+	sim->sequence++;
+
+	if( NetSim_Lost( sim ))
+		return;
+
+	sendtime = NetSim_Shape( sim, time, length );
+	if( sendtime < 0.0 )
+		return;
+
+	if( NetSim_Chance( sim, p->duplicate ))
+	{
+		sim->stats.duplicated++;
+		copies++;
+	}
+
+	for( i = 0; i < copies; i++ )
+	{
+		double latency;
+
+		if( NetSim_Chance( sim, p->reorder ))
+			latency = 0.0;
+		else latency = NetSim_Latency( sim );
+
+		NetSim_Push( sim, sendtime + latency, i, from, data, length );
+	}
+}
+
+/*
+==================
+NetSim_Deliver
+
+fetch next packet which arrival time has come
+==================
+*/
+qboolean NetSim_Deliver( netsim_t *sim, double time, netadr_t *from, void *data, size_t *length )
+{
+	netsim_packet_t *packet;
+
+	if( !sim->count || sim->heap[0]->time > time )
+		return false;
+
+	packet = NetSim_Pop( sim );
+
+	if( packet->sequence < sim->lastdelivered )
+		sim->stats.reordered++;
+	else sim->lastdelivered = packet->sequence;
+
+	sim->stats.delivered++;
+	sim->stats.bytes += packet->size;
+
+	memcpy( data, packet + 1, packet->size );
+	*from = packet->from;
+	*length = packet->size;
+
+	Mem_Free( packet );
+
+	return true;
+}
+
+/*
+==================
+NetSim_SetParam
+==================
+*/
+qboolean NetSim_SetParam( netsim_params_t *params, const char *name, float value )
+{
+	int i;
+
+	for( i = 0; i < ARRAYSIZE( netsim_fields ); i++ )
+	{
+		if( Q_stricmp( netsim_fields[i].name, name ))
+			continue;
+
+		*(float *)((byte *)params + netsim_fields[i].offset ) = Q_max( value, 0.0f );
+		return true;
+	}
+
+	Con_Printf( "unknown parameter %s, valid are:\n", name );
+	for( i = 0; i < ARRAYSIZE( netsim_fields ); i++ )
+		Con_Printf( "  %-12s %s\n", netsim_fields[i].name, netsim_fields[i].desc );
+
+	return false;
+}
+
+/*
+==================
+NetSim_Print
+==================
+*/
+void NetSim_Print( const netsim_t *sim, const char *name )
+{
+	const netsim_stats_t *s = &sim->stats;
+	int i;
+
+	Con_Printf( "%s (seed %u, %i queued%s):\n", name, sim->seed, sim->count, sim->badstate ? ", in burst loss" : "" );
+
+	for( i = 0; i < ARRAYSIZE( netsim_fields ); i++ )
+		Con_Printf( "  %-12s %g\n", netsim_fields[i].name, *(const float *)((const byte *)&sim->params + netsim_fields[i].offset ));
+
+	Con_Printf( "  %u received, %u delivered (%s), %u lost, %u burst lost, %u overflow, %u duplicated, %u reordered\n",
+		s->received, s->delivered, Q_memprint( s->bytes ), s->lost, s->burstlost, s->overflow, s->duplicated, s->reordered );
+}
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+static void Test_NetSimRun( netsim_t *sim, int count, size_t length, double *times, int *deliveries )
+{
+	netadr_t from = { 0 };
+	byte data[1500], out[1500];
+	size_t outlength;
+	int i, delivered = 0;
+
+	memset( data, 0x55, sizeof( data ));
+
+	// one packet per millisecond, then drain the queue
+	for( i = 0; i < count * 2 + 2000; i++ )
+	{
+		const double time = i * 0.001;
+
+		if( i < count )
+			NetSim_Queue( sim, time, &from, data, length );
+
+		while( NetSim_Deliver( sim, time, &from, out, &outlength ))
+		{
+			if( times && delivered < count * 2 )
+				times[delivered] = time;
+			delivered++;
+		}
+	}
+
+	*deliveries = delivered;
+}
+
+static void Test_NetSimDeterminism( void )
+{
+	netsim_t a = { 0 }, b = { 0 };
+	double times_a[512], times_b[512];
+	int delivered_a, delivered_b;
+
+	NetSim_Defaults( &a.params );
+	a.params.latency = 50.0f;
+	a.params.jitter = 20.0f;
+	a.params.dist = NETSIM_DIST_NORMAL;
+	a.params.reorder = 5.0f;
+	a.params.duplicate = 3.0f;
+	a.params.loss = 2.0f;
+	a.params.burst_enter = 1.0f;
+	a.params.burst_leave = 30.0f;
+	b.params = a.params;
+
+	NetSim_Seed( &a, 1234 );
+	NetSim_Seed( &b, 1234 );
+	Test_NetSimRun( &a, 256, 100, times_a, &delivered_a );
+	Test_NetSimRun( &b, 256, 100, times_b, &delivered_b );
+
+	TASSERT_EQi( delivered_a, delivered_b );
+	TASSERT( !memcmp( times_a, times_b, Q_min( delivered_a, 512 ) * sizeof( double )));
+	TASSERT( !memcmp( &a.stats, &b.stats, sizeof( a.stats )));
+	TASSERT( a.stats.lost + a.stats.burstlost > 0 );
+	TASSERT( a.stats.reordered > 0 );
+	TASSERT_EQi( a.stats.delivered, a.stats.received - a.stats.lost - a.stats.burstlost + a.stats.duplicated );
+	TASSERT_EQi( a.count, 0 );
+
+	NetSim_Clear( &a );
+	NetSim_Clear( &b );
+}
+
+static void Test_NetSimLatency( void )
+{
+	netsim_t sim = { 0 };
+	netadr_t from = { 0 };
+	byte data[4] = { 1, 2, 3, 4 }, out[4];
+	size_t length;
+
+	NetSim_Defaults( &sim.params );
+	sim.params.latency = 50.0f;
+	NetSim_Seed( &sim, 0 );
+
+	NetSim_Queue( &sim, 1.0, &from, data, sizeof( data ));
+	TASSERT( !NetSim_Deliver( &sim, 1.049, &from, out, &length ));
+	TASSERT( NetSim_Deliver( &sim, 1.05, &from, out, &length ));
+	TASSERT_EQi( length, sizeof( data ));
+	TASSERT( !memcmp( data, out, sizeof( data )));
+
+	// everything is lost in the bad state that never ends
+	sim.params.burst_enter = 100.0f;
+	NetSim_Queue( &sim, 2.0, &from, data, sizeof( data ));
+	NetSim_Queue( &sim, 2.0, &from, data, sizeof( data ));
+	TASSERT( !NetSim_Deliver( &sim, 3.0, &from, out, &length ));
+	TASSERT_EQi( sim.stats.burstlost, 2 );
+
+	NetSim_Clear( &sim );
+}
+
+static void Test_NetSimRate( void )
+{
+	netsim_t sim = { 0 };
+	netadr_t from = { 0 };
+	byte data[100] = { 0 }, out[100];
+	size_t length;
+
+	// 1000 bytes per second, room for a single packet
+	NetSim_Defaults( &sim.params );
+	sim.params.rate = 8.0f;
+	sim.params.burst = 100.0f;
+	sim.params.queue = 150.0f;
+	NetSim_Seed( &sim, 0 );
+
+	NetSim_Queue( &sim, 0.0, &from, data, sizeof( data ));
+	NetSim_Queue( &sim, 0.0, &from, data, sizeof( data ));
+	NetSim_Queue( &sim, 0.0, &from, data, sizeof( data )); // tail drop
+	TASSERT_EQi( sim.stats.overflow, 1 );
+
+	TASSERT( NetSim_Deliver( &sim, 0.0, &from, out, &length ));
+	TASSERT( !NetSim_Deliver( &sim, 0.099, &from, out, &length ));
+	TASSERT( NetSim_Deliver( &sim, 0.1, &from, out, &length ));
+	TASSERT_EQi( sim.count, 0 );
+
+	NetSim_Clear( &sim );
+}
+
+void Test_RunNetSim( void )
+{
+	TRUN( Test_NetSimDeterminism() );
+	TRUN( Test_NetSimLatency() );
+	TRUN( Test_NetSimRate() );
+}
+#endif // XASH_ENGINE_TESTS
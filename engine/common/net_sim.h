@@ -0,0 +1,88 @@
+/*
+net_sim.h - network condition simulator
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#ifndef NET_SIM_H
+#define NET_SIM_H
+
+#include "netadr.h"
+
+#define NETSIM_MAX_PACKETS	4096	// hard limit of queued packets per direction
+
+typedef enum
+{
+	NETSIM_DIST_UNIFORM = 0,	// latency +- jitter
+	NETSIM_DIST_NORMAL,		// jitter is standard deviation
+	NETSIM_DIST_PARETO,		// heavy tail, jitter is mean of the tail
+} netsim_dist_t;
+
+// all percents are 0..100, times are milliseconds
+typedef struct netsim_params_s
+{
+	float	latency;
+	float	jitter;
+	float	dist;		// netsim_dist_t
+	float	reorder;		// packets sent without latency, overtaking queued ones
+	float	duplicate;
+	float	loss;		// random loss, in good state for burst loss model
+	float	burst_enter;	// Gilbert-Elliott good to bad state transition chance
+	float	burst_leave;	// Gilbert-Elliott bad to good state transition chance
+	float	burst_loss;	// loss in bad state
+	float	rate;		// token bucket rate, kbit/s, 0 is unlimited
+	float	burst;		// token bucket depth, bytes
+	float	queue;		// rate limited backlog in bytes before tail drop
+} netsim_params_t;
+
+typedef struct netsim_stats_s
+{
+	uint	received;
+	uint	delivered;
+	uint	lost;
+	uint	burstlost;
+	uint	overflow;
+	uint	duplicated;
+	uint	reordered;
+	size_t	bytes;
+} netsim_stats_t;
+
+typedef struct netsim_packet_s netsim_packet_t;
+
+typedef struct netsim_s
+{
+	netsim_params_t	params;
+	netsim_stats_t	stats;
+	float		fakelag;		// legacy fakelag cvar, added to latency
+
+	uint		seed;
+	uint		rng;
+	qboolean		badstate;
+	double		tokens;
+	double		tokentime;
+	uint		sequence;
+	uint		lastdelivered;
+
+	netsim_packet_t	**heap;		// ordered by delivery time
+	int		count;
+	int		maxcount;
+} netsim_t;
+
+void NetSim_Defaults( netsim_params_t *params );
+void NetSim_Seed( netsim_t *sim, uint seed );
+void NetSim_Clear( netsim_t *sim );
+qboolean NetSim_Active( const netsim_t *sim );
+void NetSim_Queue( netsim_t *sim, double time, const netadr_t *from, const void *data, size_t length );
+qboolean NetSim_Deliver( netsim_t *sim, double time, netadr_t *from, void *data, size_t *length );
+qboolean NetSim_SetParam( netsim_params_t *params, const char *name, float value );
+void NetSim_Print( const netsim_t *sim, const char *name );
+
+#endif // NET_SIM_H
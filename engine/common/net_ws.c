@@ -19,7 +19,9 @@ GNU General Public License for more details.
 #include "xash3d_mathlib.h"
 #include "ipv6text.h"
 #include "net_ws_private.h"
+#include "net_sim.h"
 #include "server.h" // sv_cheats
+#include "platform/platform.h"
 
 #if XASH_SDL == 2
 #include <SDL_thread.h>
@@ -52,16 +54,6 @@ typedef struct
 	int		get, send;
 } net_loopback_t;
 
-typedef struct packetlag_s
-{
-	byte		*data;	// Raw stream data is stored.
-	int		size;
-	netadr_t		from;
-	float		receivedtime;
-	struct packetlag_s	*next;
-	struct packetlag_s	*prev;
-} packetlag_t;
-
 // split long packets. Anything over 1460 is failing on some routers.
 typedef struct
 {
@@ -91,7 +83,7 @@ typedef struct
 typedef struct
 {
 	net_loopback_t	loopbacks[NS_COUNT];
-	packetlag_t	lagdata[NS_COUNT];
+	netsim_t		sim[NS_COUNT];
 	int		losscount[NS_COUNT];
 	float		fakelag;			// cached fakelag value
 	LONGPACKET	split;
@@ -1019,80 +1011,6 @@ LAG & LOSS SIMULATION SYSTEM (network debugging)
 
 =============================================================================
 */
-/*
-==================
-NET_RemoveFromPacketList
-
-double linked list remove entry
-==================
-*/
-static void NET_RemoveFromPacketList( packetlag_t *p )
-{
-	p->prev->next = p->next;
-	p->next->prev = p->prev;
-	p->prev = NULL;
-	p->next = NULL;
-}
-
-/*
-==================
-NET_ClearLaggedList
-
-double linked list remove queue
-==================
-*/
-static void NET_ClearLaggedList( packetlag_t *list )
-{
-	packetlag_t	*p, *n;
-
-	p = list->next;
-	while( p && p != list )
-	{
-		n = p->next;
-
-		NET_RemoveFromPacketList( p );
-
-		if( p->data )
-		{
-			Mem_Free( p->data );
-			p->data = NULL;
-		}
-
-		Mem_Free( p );
-		p = n;
-	}
-
-	list->prev = list;
-	list->next = list;
-}
-
-/*
-==================
-NET_AddToLagged
-
-add lagged packet to stream
-==================
-*/
-static void NET_AddToLagged( netsrc_t sock, packetlag_t *list, packetlag_t *packet, netadr_t *from, size_t length, const void *data, float timestamp )
-{
-	byte	*pStart;
-
-	if( packet->prev || packet->next )
-		return;
-
-	packet->prev = list->prev;
-	list->prev->next = packet;
-	list->prev = packet;
-	packet->next = list;
-
-	pStart = (byte *)Z_Malloc( length );
-	memcpy( pStart, data, length );
-	packet->data = pStart;
-	packet->size = length;
-	packet->receivedtime = timestamp;
-	packet->from = *from;
-}
-
 /*
 ==================
 NET_AdjustLag
@@ -1135,82 +1053,111 @@ static void NET_AdjustLag( void )
 ==================
 NET_LagPacket
 
-add fake lagged packet into rececived message
+pass received packet through the network simulator
 ==================
 */
 static qboolean NET_LagPacket( qboolean newdata, netsrc_t sock, netadr_t *from, size_t *length, void *data )
 {
-	packetlag_t	*pNewPacketLag;
-	packetlag_t	*pPacket;
-	int		ninterval;
-	float		curtime;
+	netsim_t	*sim = &net.sim[sock];
+	int	ninterval;
+
+	sim->fakelag = net.fakelag;
 
-	if( net.fakelag <= 0.0f )
+	if( !NetSim_Active( sim ))
+		return newdata;
+
+	if( !host_developer.value )
 	{
+		// same as fakelag, simulator is development only
 		NET_ClearLagData( true, true );
 		return newdata;
 	}
 
-	curtime = host.realtime;
-
 	if( newdata )
 	{
 		if( net_fakeloss.value != 0.0f )
 		{
-			if( host_developer.value )
+			net.losscount[sock]++;
+			if( net_fakeloss.value <= 0.0f )
 			{
-				net.losscount[sock]++;
-				if( net_fakeloss.value <= 0.0f )
-				{
-					ninterval = fabs( net_fakeloss.value );
-					if( ninterval < 2 ) ninterval = 2;
+				ninterval = fabs( net_fakeloss.value );
+				if( ninterval < 2 ) ninterval = 2;
 
-					if(( net.losscount[sock] % ninterval ) == 0 )
-						return false;
-				}
-				else
-				{
-					if( COM_RandomLong( 0, 100 ) <= net_fakeloss.value )
-						return false;
-				}
+				if(( net.losscount[sock] % ninterval ) == 0 )
+					newdata = false;
 			}
 			else
 			{
-				Cvar_SetValue( "fakeloss", 0.0 );
+				if( COM_RandomLong( 0, 100 ) <= net_fakeloss.value )
+					newdata = false;
 			}
 		}
 
-		pNewPacketLag = (packetlag_t *)Z_Malloc( sizeof( packetlag_t ));
-		// queue packet to simulate fake lag
-		NET_AddToLagged( sock, &net.lagdata[sock], pNewPacketLag, from, *length, data, curtime );
+		if( newdata )
+			NetSim_Queue( sim, host.realtime, from, data, *length );
 	}
 
-	pPacket = net.lagdata[sock].next;
+	return NetSim_Deliver( sim, host.realtime, from, data, length );
+}
 
-	while( pPacket != &net.lagdata[sock] )
-	{
-		if( pPacket->receivedtime <= curtime - ( net.fakelag / 1000.0f ))
-			break;
+/*
+==================
+NET_NetSim_f
 
-		pPacket = pPacket->next;
+configure network simulator
+==================
+*/
+static void NET_NetSim_f( void )
+{
+	static const char *names[NS_COUNT] = { "client incoming", "server incoming" };
+	const char *dir;
+	int i;
+
+	if( Cmd_Argc() < 2 )
+	{
+		for( i = 0; i < NS_COUNT; i++ )
+			NetSim_Print( &net.sim[i], names[i] );
+		return;
 	}
 
-	if( pPacket == &net.lagdata[sock] )
-		return false;
+	if( !Q_stricmp( Cmd_Argv( 1 ), "reset" ) || !Q_stricmp( Cmd_Argv( 1 ), "seed" ))
+	{
+		uint seed = Cmd_Argc() > 2 ? Q_atoi( Cmd_Argv( 2 )) : net.sim[NS_CLIENT].seed;
+
+		for( i = 0; i < NS_COUNT; i++ )
+		{
+			if( !Q_stricmp( Cmd_Argv( 1 ), "reset" ))
+				NetSim_Defaults( &net.sim[i].params );
 
-	NET_RemoveFromPacketList( pPacket );
+			// each direction has own sequence, so changing one doesn't affect another
+			NetSim_Seed( &net.sim[i], seed + i );
+		}
+		return;
+	}
 
-	// delivery packet from fake lag queue
-	memcpy( data, pPacket->data, pPacket->size );
-	net_from = pPacket->from;
-	*length = pPacket->size;
+	if( Cmd_Argc() != 4 )
+	{
+		Con_Printf( S_USAGE "netsim [reset|seed] [<seed>]\n" );
+		Con_Printf( S_USAGE "netsim <cl|sv|all> <parameter> <value>\n" );
+		return;
+	}
 
-	if( pPacket->data )
-		Mem_Free( pPacket->data );
+	if( !host_developer.value )
+	{
+		Con_Printf( "network simulator requires developer mode\n" );
+		return;
+	}
 
-	Mem_Free( pPacket );
+	dir = Cmd_Argv( 1 );
 
-	return true;
+	for( i = 0; i < NS_COUNT; i++ )
+	{
+		if( !Q_stricmp( dir, "all" ) || !Q_stricmp( dir, i == NS_CLIENT ? "cl" : "sv" ))
+		{
+			if( !NetSim_SetParam( &net.sim[i].params, Cmd_Argv( 2 ), Q_atof( Cmd_Argv( 3 ))))
+				return;
+		}
+	}
 }
 
 /*
@@ -1959,17 +1906,61 @@ void NET_Sleep( int msec )
 #endif
 }
 
+/*
+====================
+NET_WaitPacket
+
+sleeps up to usec or until server socket is readable,
+returns true if packet is waiting
+====================
+*/
+qboolean NET_WaitPacket( int usec )
+{
+#ifndef XASH_NO_NETWORK
+	struct timeval	timeout;
+	fd_set		fdset;
+	int		i = -1;
+
+	if( usec < 0 )
+		usec = 0;
+
+	FD_ZERO( &fdset );
+
+	if( net.initialized && NET_IsSocketValid( net.ip_sockets[NS_SERVER] ))
+	{
+		FD_SET( net.ip_sockets[NS_SERVER], &fdset );
+		i = Q_max( i, (int)net.ip_sockets[NS_SERVER] );
+	}
+
+	if( net.initialized && NET_IsSocketValid( net.ip6_sockets[NS_SERVER] ))
+	{
+		FD_SET( net.ip6_sockets[NS_SERVER], &fdset );
+		i = Q_max( i, (int)net.ip6_sockets[NS_SERVER] );
+	}
+
+	if( i >= 0 )
+	{
+		timeout.tv_sec = usec / 1000000;
+		timeout.tv_usec = usec % 1000000;
+		return select( i + 1, &fdset, NULL, NULL, &timeout ) > 0;
+	}
+#endif
+	// no sockets to wait on, just sleep
+	Platform_NanoSleep( usec * 1000 );
+	return false;
+}
+
 /*
 ====================
 NET_ClearLagData
 
-clear fakelag list
+drop packets queued in network simulator
 ====================
 */
 static void NET_ClearLagData( qboolean bClient, qboolean bServer )
 {
-	if( bClient ) NET_ClearLaggedList( &net.lagdata[NS_CLIENT] );
-	if( bServer ) NET_ClearLaggedList( &net.lagdata[NS_SERVER] );
+	if( bClient ) NetSim_Clear( &net.sim[NS_CLIENT] );
+	if( bServer ) NetSim_Clear( &net.sim[NS_SERVER] );
 }
 
 /*
@@ -2020,6 +2011,7 @@ void NET_Init( void )
 	Cvar_RegisterVariable( &net_fakeloss );
 	Cvar_RegisterVariable( &net_resolve_debug );
 	Cvar_RegisterVariable( &net_clockwindow );
+	Cmd_AddRestrictedCommand( "netsim", NET_NetSim_f, "network condition simulator, prints settings and statistics without arguments" );
 
 	Q_snprintf( cmd, sizeof( cmd ), "%i", PORT_SERVER );
 	Cvar_FullSet( "hostport", cmd, FCVAR_READ_ONLY );
@@ -2033,8 +2025,8 @@ void NET_Init( void )
 	// prepare some network data
 	for( i = 0; i < NS_COUNT; i++ )
 	{
-		net.lagdata[i].prev = &net.lagdata[i];
-		net.lagdata[i].next = &net.lagdata[i];
+		NetSim_Defaults( &net.sim[i].params );
+		NetSim_Seed( &net.sim[i], i );
 		net.ip_sockets[i]  = INVALID_SOCKET;
 		net.ip6_sockets[i] = INVALID_SOCKET;
 	}
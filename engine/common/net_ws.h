@@ -58,6 +58,7 @@ extern convar_t net_recv_debug;
 void NET_Init( void );
 void NET_Shutdown( void );
 void NET_Sleep( int msec );
+qboolean NET_WaitPacket( int usec );
 qboolean NET_IsActive( void );
 qboolean NET_IsConfigured( void );
 void NET_Config( qboolean net_enable, qboolean changeport );
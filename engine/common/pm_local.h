@@ -26,6 +26,8 @@ typedef int (*pfnIgnore)( physent_t *pe );	// custom trace filter
 void Pmove_Init( void );
 void PM_InitBoxHull( void );
 hull_t *PM_HullForBsp( physent_t *pe, playermove_t *pmove, float *offset );
+void PM_SetupBroadphase( playermove_t *pmove );
+void PM_ClearBroadphase( playermove_t *pmove );
 qboolean PM_RecursiveHullCheck( hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, pmtrace_t *trace );
 pmtrace_t PM_PlayerTraceExt( playermove_t *pm, vec3_t p1, vec3_t p2, int flags, int numents, physent_t *ents, int ignore_pe, pfnIgnore pmFilter );
 int PM_TestPlayerPosition( playermove_t *pmove, vec3_t pos, pmtrace_t *ptrace, pfnIgnore pmFilter );
@@ -39,6 +41,8 @@ struct msurface_s *PM_TraceSurfacePmove( playermove_t *pmove, int ground, float
 const char *PM_TraceTexture( playermove_t *pmove, int ground, float *vstart, float *vend );
 int PM_PointContentsPmove( playermove_t *pmove, const float *p, int *truecontents );
 void PM_StuckTouch( playermove_t *pmove, int hitent, pmtrace_t *tr );
+void PM_TraceRecord_f( void );
+void PM_TraceBench_f( void );
 
 static inline void PM_ConvertTrace( trace_t *out, pmtrace_t *in, edict_t *ent )
 {
@@ -24,8 +24,60 @@ GNU General Public License for more details.
 
 #define PM_AllowHitBoxTrace( model, hull ) ( model && model->type == mod_studio && ( FBitSet( model->flags, STUDIO_TRACE_HITBOX ) || hull == 2 ))
 
+#define PM_HULLCHECK_STACK	128	// deeper trees fall back to recursion
+#define PM_TRACEFILE_IDENT	(('R'<<24)+('T'<<16)+('M'<<8)+'P') // little-endian "PMTR"
+#define PM_TRACEFILE_VERSION	1
+
+// split node which near side is being traced
+typedef struct pm_hullframe_s
+{
+	const mplane_t	*plane;
+	int		side;
+	int		num;	// far side child
+	float		frac;
+	float		p1f, p2f, midf;
+	vec3_t		p1, p2, mid;
+} pm_hullframe_t;
+
+// recorded world hull trace for pm_tracebench
+typedef struct pm_tracerecord_s
+{
+	int		table;	// index in world.flatclipnodes
+	int		firstclipnode;
+	int		lastclipnode;
+	vec3_t		start;
+	vec3_t		end;
+} pm_tracerecord_t;
+
+typedef struct pm_traceheader_s
+{
+	int		ident;
+	int		version;
+	int		numtables;
+	int		numnodes[MAX_MAP_HULLS];
+} pm_traceheader_t;
+
+#define PM_BROADPHASE_EPSILON	1.0f	// same as absbox expansion in SetAbsBox
+
+// physent broadphase flags
+#define PM_CULL_ALWAYS	BIT( 0 )	// bounds are valid for any hull
+#define PM_CULL_BOXHULL	BIT( 1 )	// bounds are valid unless hitboxes are traced with point hull
+
+// physent bounds in SoA layout, built once per player move
+typedef struct pm_broadphase_s
+{
+	const physent_t	*ents;	// NULL if broadphase is inactive
+	int		numents;
+	float		mins[3][MAX_PHYSENTS];
+	float		maxs[3][MAX_PHYSENTS];
+	byte		cull[MAX_PHYSENTS];
+	byte		touch[MAX_PHYSENTS];	// physent overlaps the current trace
+} pm_broadphase_t;
+
 static mplane_t	pm_boxplanes[6];
 static hull_t pm_boxhull;
+static file_t *pm_tracefile;
+static pm_broadphase_t pm_broadphase[2]; // client and server
 
 // default hullmins
 static const vec3_t pm_hullmins[MAX_MAP_HULLS] =
@@ -105,6 +157,20 @@ static hull_t *PM_HullForBox( const vec3_t mins, const vec3_t maxs )
 	return &pm_boxhull;
 }
 
+/*
+==================
+PM_FlatPointContents
+
+==================
+*/
+static int PM_FlatPointContents( const mclipnode_flat_t *flat, int num, const vec3_t p )
+{
+	while( num >= 0 )
+		num = flat[num].children[PlaneDiff( p, &flat[num].plane ) < 0];
+
+	return num;
+}
+
 /*
 ==================
 PM_HullPointContents
@@ -113,11 +179,15 @@ PM_HullPointContents
 */
 int GAME_EXPORT PM_HullPointContents( hull_t *hull, int num, const vec3_t p )
 {
+	const mclipnode_flat_t	*flat;
 	mplane_t		*plane;
 
 	if( !hull || !hull->planes )	// fantom bmodels?
 		return CONTENTS_NONE;
 
+	if(( flat = Mod_FlatClipnodesForHull( hull )) != NULL )
+		return PM_FlatPointContents( flat, num, p );
+
 	if( world.version == QBSP2_VERSION )
 	{
 		while( num >= 0 )
@@ -195,10 +265,189 @@ static hull_t *PM_HullForStudio( physent_t *pe, playermove_t *pmove, int *numhit
 
 /*
 ==================
-PM_RecursiveHullCheck
+PM_SetupBroadphase
+
+calculate bounds of every physent which hull can be replaced by
+a bounding box test, must be called after physents are collected
 ==================
 */
-qboolean PM_RecursiveHullCheck( hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, pmtrace_t *trace )
+void PM_SetupBroadphase( playermove_t *pmove )
+{
+	pm_broadphase_t *bp = &pm_broadphase[pmove->server ? 1 : 0];
+	float hullradius = 0.0f;
+	int i, j;
+
+	for( i = 0; i < MAX_MAP_HULLS; i++ )
+	{
+		vec3_t extents;
+
+		for( j = 0; j < 3; j++ )
+			extents[j] = Q_max( fabs( host.player_mins[i][j] ), fabs( host.player_maxs[i][j] ));
+
+		hullradius = Q_max( hullradius, VectorLength( extents ));
+	}
+
+	bp->ents = pmove->physents;
+	bp->numents = pmove->numphysent;
+
+	for( i = 0; i < bp->numents; i++ )
+	{
+		const physent_t *pe = &pmove->physents[i];
+		vec3_t mins, maxs;
+
+		bp->cull[i] = 0;
+
+		// world and custom hulls are always traced
+		if( i == 0 || pe->solid == SOLID_CUSTOM )
+			continue;
+
+		if( pe->model )
+		{
+			const model_t *mod = pe->model;
+
+			if( mod->type != mod_brush )
+				continue;
+
+			if( pe->solid == SOLID_BSP && !VectorIsNull( pe->angles ))
+			{
+				float radius;
+
+				// bbox transform in PM_PlayerTraceExt moves the hull in unpredictable way
+				if( FBitSet( host.features, ENGINE_PHYSICS_PUSHER_EXT ))
+					continue;
+
+				// hull rotates together with the model
+				radius = RadiusFromBounds( mod->mins, mod->maxs ) + hullradius;
+				VectorSet( mins, -radius, -radius, -radius );
+				VectorSet( maxs, radius, radius, radius );
+			}
+			else
+			{
+				VectorCopy( mod->mins, mins );
+				VectorCopy( mod->maxs, maxs );
+			}
+
+			// take hull offsets from PM_HullForBsp into account
+			for( j = 0; j < MAX_MAP_HULLS; j++ )
+			{
+				static const int hullnum[MAX_MAP_HULLS] = { 1, 3, 0, 2 };
+				const hull_t *hull = &mod->hulls[hullnum[j]];
+				int k;
+
+				for( k = 0; k < 3; k++ )
+				{
+					float ofs = hull->clip_mins[k] - host.player_mins[j][k];
+
+					mins[k] += Q_min( ofs, 0.0f );
+					maxs[k] += Q_max( ofs, 0.0f );
+				}
+			}
+
+			bp->cull[i] = PM_CULL_ALWAYS;
+		}
+		else
+		{
+			// hitboxes may stick out of the bounding box
+			if( pe->studiomodel && FBitSet( pe->studiomodel->flags, STUDIO_TRACE_HITBOX ))
+				continue;
+
+			VectorCopy( pe->mins, mins );
+			VectorCopy( pe->maxs, maxs );
+
+			bp->cull[i] = pe->studiomodel ? PM_CULL_BOXHULL : PM_CULL_ALWAYS;
+		}
+
+		for( j = 0; j < 3; j++ )
+		{
+			bp->mins[j][i] = pe->origin[j] + mins[j] - PM_BROADPHASE_EPSILON;
+			bp->maxs[j][i] = pe->origin[j] + maxs[j] + PM_BROADPHASE_EPSILON;
+		}
+	}
+}
+
+/*
+==================
+PM_ClearBroadphase
+
+physents may be changed outside of player move
+==================
+*/
+void PM_ClearBroadphase( playermove_t *pmove )
+{
+	pm_broadphase[pmove->server ? 1 : 0].ents = NULL;
+}
+
+/*
+==================
+PM_BroadphaseTouch
+
+mark physents which bounds overlap the swept player hull,
+returns NULL if broadphase can't be used for these physents
+==================
+*/
+static const byte *PM_BroadphaseTouch( playermove_t *pmove, const physent_t *ents, int numents, const vec3_t start, const vec3_t end )
+{
+	pm_broadphase_t *bp = &pm_broadphase[pmove->server ? 1 : 0];
+	const byte cullmask = pmove->usehull == 2 ? PM_CULL_ALWAYS : ( PM_CULL_ALWAYS|PM_CULL_BOXHULL );
+	float x0, y0, z0, x1, y1, z1;
+	int i;
+
+	if( bp->ents != ents || numents > bp->numents )
+		return NULL;
+
+	x0 = Q_min( start[0], end[0] ) + host.player_mins[pmove->usehull][0];
+	y0 = Q_min( start[1], end[1] ) + host.player_mins[pmove->usehull][1];
+	z0 = Q_min( start[2], end[2] ) + host.player_mins[pmove->usehull][2];
+	x1 = Q_max( start[0], end[0] ) + host.player_maxs[pmove->usehull][0];
+	y1 = Q_max( start[1], end[1] ) + host.player_maxs[pmove->usehull][1];
+	z1 = Q_max( start[2], end[2] ) + host.player_maxs[pmove->usehull][2];
+
+	// branchless so compiler can vectorize it
+	for( i = 0; i < numents; i++ )
+	{
+		int overlap = ( bp->maxs[0][i] >= x0 ) & ( bp->mins[0][i] <= x1 )
+			& ( bp->maxs[1][i] >= y0 ) & ( bp->mins[1][i] <= y1 )
+			& ( bp->maxs[2][i] >= z0 ) & ( bp->mins[2][i] <= z1 );
+
+		bp->touch[i] = overlap | (( bp->cull[i] & cullmask ) == 0 );
+	}
+
+	return bp->touch;
+}
+
+/*
+==================
+PM_RecordTrace
+
+==================
+*/
+static void PM_RecordTrace( const hull_t *hull, const vec3_t start, const vec3_t end )
+{
+	pm_tracerecord_t rec;
+
+	for( rec.table = 0; rec.table < world.num_flatclipnodes; rec.table++ )
+	{
+		if( world.flatclipnodes[rec.table].source == (const void *)hull->clipnodes16 )
+			break;
+	}
+
+	rec.firstclipnode = hull->firstclipnode;
+	rec.lastclipnode = hull->lastclipnode;
+	VectorCopy( start, rec.start );
+	VectorCopy( end, rec.end );
+
+	FS_Write( pm_tracefile, &rec, sizeof( rec ));
+}
+
+/*
+==================
+PM_RecursiveHullCheck_r
+
+reference implementation, used when the tree is deeper than
+the traversal stack and by pm_tracebench to validate results
+==================
+*/
+static qboolean PM_RecursiveHullCheck_r( hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, pmtrace_t *trace )
 {
 	int children[2];
 	mplane_t		*plane;
@@ -274,14 +523,14 @@ qboolean PM_RecursiveHullCheck( hull_t *hull, int num, float p1f, float p2f, vec
 	VectorLerp( p1, frac, p2, mid );
 
 	// move up to the node
-	if( !PM_RecursiveHullCheck( hull, children[side], p1f, midf, p1, mid, trace ))
+	if( !PM_RecursiveHullCheck_r( hull, children[side], p1f, midf, p1, mid, trace ))
 		return false;
 
 	// this recursion can not be optimized because mid would need to be duplicated on a stack
 	if( PM_HullPointContents( hull, children[side^1], mid ) != CONTENTS_SOLID )
 	{
 		// go past the node
-		return PM_RecursiveHullCheck( hull, children[side^1], midf, p2f, mid, p2, trace );
+		return PM_RecursiveHullCheck_r( hull, children[side^1], midf, p2f, mid, p2, trace );
 	}
 
 	// never got out of the solid area
@@ -323,6 +572,210 @@ qboolean PM_RecursiveHullCheck( hull_t *hull, int num, float p1f, float p2f, vec
 	return false;
 }
 
+/*
+==================
+PM_ClipnodeForNum
+
+==================
+*/
+static inline const mplane_t *PM_ClipnodeForNum( const hull_t *hull, const mclipnode_flat_t *flat, int num, int children[2] )
+{
+	if( flat )
+	{
+		children[0] = flat[num].children[0];
+		children[1] = flat[num].children[1];
+		return &flat[num].plane;
+	}
+
+	if( world.version == QBSP2_VERSION )
+	{
+		children[0] = hull->clipnodes32[num].children[0];
+		children[1] = hull->clipnodes32[num].children[1];
+		return hull->planes + hull->clipnodes32[num].planenum;
+	}
+
+	children[0] = hull->clipnodes16[num].children[0];
+	children[1] = hull->clipnodes16[num].children[1];
+	return hull->planes + hull->clipnodes16[num].planenum;
+}
+
+/*
+==================
+PM_RecursiveHullCheck
+
+stackless version of PM_RecursiveHullCheck_r, gives exactly the same
+results. Only the near side of a split node has to be remembered,
+the far side is a tail call
+==================
+*/
+qboolean PM_RecursiveHullCheck( hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, pmtrace_t *trace )
+{
+	pm_hullframe_t		stack[PM_HULLCHECK_STACK];
+	const mclipnode_flat_t	*flat;
+	const pm_hullframe_t	*frame;
+	const mplane_t		*plane;
+	int		children[2];
+	int		depth = 0;
+	float		t1, t2;
+	float		frac, midf;
+	int		side;
+	qboolean		ret;
+	vec3_t		start, end;
+
+	flat = Mod_FlatClipnodesForHull( hull );
+
+	if( pm_tracefile != NULL && flat != NULL && num == hull->firstclipnode && p1f == 0.0f && p2f == 1.0f )
+		PM_RecordTrace( hull, p1, p2 );
+
+	VectorCopy( p1, start );
+	VectorCopy( p2, end );
+
+	while( 1 )
+	{
+		// check for empty
+		if( num < 0 )
+		{
+			if( num != CONTENTS_SOLID )
+			{
+				trace->allsolid = false;
+				if( num == CONTENTS_EMPTY )
+					trace->inopen = true;
+				else trace->inwater = true;
+			}
+			else trace->startsolid = true;
+			ret = true; // empty
+		}
+		else if( hull->firstclipnode >= hull->lastclipnode )
+		{
+			// empty hull?
+			trace->allsolid = false;
+			trace->inopen = true;
+			ret = true;
+		}
+		else
+		{
+			if( num < hull->firstclipnode || num > hull->lastclipnode )
+				Host_Error( "%s: bad node number %i\n", __func__, num );
+
+			// find the point distances
+			plane = PM_ClipnodeForNum( hull, flat, num, children );
+
+			t1 = PlaneDiff( start, plane );
+			t2 = PlaneDiff( end, plane );
+
+			if( t1 >= 0.0f && t2 >= 0.0f )
+			{
+				num = children[0];
+				continue;
+			}
+
+			if( t1 < 0.0f && t2 < 0.0f )
+			{
+				num = children[1];
+				continue;
+			}
+
+			// put the crosspoint DIST_EPSILON pixels on the near side
+			side = (t1 < 0.0f);
+
+			if( side ) frac = ( t1 + DIST_EPSILON ) / ( t1 - t2 );
+			else frac = ( t1 - DIST_EPSILON ) / ( t1 - t2 );
+
+			if( frac < 0.0f ) frac = 0.0f;
+			if( frac > 1.0f ) frac = 1.0f;
+
+			midf = p1f + ( p2f - p1f ) * frac;
+
+			if( depth < PM_HULLCHECK_STACK )
+			{
+				pm_hullframe_t *push = &stack[depth++];
+
+				push->plane = plane;
+				push->side = side;
+				push->num = children[side^1];
+				push->frac = frac;
+				push->p1f = p1f;
+				push->p2f = p2f;
+				push->midf = midf;
+				VectorCopy( start, push->p1 );
+				VectorCopy( end, push->p2 );
+				VectorLerp( start, frac, end, push->mid );
+
+				// move up to the node
+				num = children[side];
+				p2f = midf;
+				VectorCopy( push->mid, end );
+				continue;
+			}
+
+			// pathological tree, finish this subtree recursively
+			ret = PM_RecursiveHullCheck_r( hull, num, p1f, p2f, start, end, trace );
+		}
+
+		// the subtree was done, return into the parent node
+		if( !ret )
+			return false;
+
+		if( depth == 0 )
+			return true;
+
+		frame = &stack[--depth];
+
+		if(( flat ? PM_FlatPointContents( flat, frame->num, frame->mid ) : PM_HullPointContents( hull, frame->num, frame->mid )) != CONTENTS_SOLID )
+		{
+			// go past the node
+			num = frame->num;
+			p1f = frame->midf;
+			p2f = frame->p2f;
+			VectorCopy( frame->mid, start );
+			VectorCopy( frame->p2, end );
+			continue;
+		}
+
+		// never got out of the solid area
+		if( trace->allsolid )
+			return false;
+
+		// the other side of the node is solid, this is the impact point
+		if( !frame->side )
+		{
+			VectorCopy( frame->plane->normal, trace->plane.normal );
+			trace->plane.dist = frame->plane->dist;
+		}
+		else
+		{
+			VectorNegate( frame->plane->normal, trace->plane.normal );
+			trace->plane.dist = -frame->plane->dist;
+		}
+
+		frac = frame->frac;
+		midf = frame->midf;
+		VectorCopy( frame->mid, start );
+
+		while( PM_HullPointContents( hull, hull->firstclipnode, start ) == CONTENTS_SOLID )
+		{
+			// shouldn't really happen, but does occasionally
+			frac -= 0.1f;
+
+			if( frac < 0.0f )
+			{
+				trace->fraction = midf;
+				VectorCopy( start, trace->endpos );
+				Con_Reportf( S_WARN "trace backed up past 0.0\n" );
+				return false;
+			}
+
+			midf = frame->p1f + ( frame->p2f - frame->p1f ) * frac;
+			VectorLerp( frame->p1, frac, frame->p2, start );
+		}
+
+		trace->fraction = midf;
+		VectorCopy( start, trace->endpos );
+
+		return false;
+	}
+}
+
 pmtrace_t PM_PlayerTraceExt( playermove_t *pmove, vec3_t start, vec3_t end, int flags, int numents, physent_t *ents, int ignore_pe, pfnIgnore pmFilter )
 {
 	physent_t	*pe;
@@ -335,12 +788,15 @@ pmtrace_t PM_PlayerTraceExt( playermove_t *pmove, vec3_t start, vec3_t end, int
 	int	i, j, hullcount;
 	qboolean	rotated, transform_bbox;
 	hull_t	*hull = NULL;
+	const byte	*touch;
 
 	memset( &trace_total, 0, sizeof( trace_total ));
 	VectorCopy( end, trace_total.endpos );
 	trace_total.fraction = 1.0f;
 	trace_total.ent = -1;
 
+	touch = PM_BroadphaseTouch( pmove, ents, numents, start, end );
+
 	for( i = 0; i < numents; i++ )
 	{
 		pe = &ents[i];
@@ -369,6 +825,10 @@ pmtrace_t PM_PlayerTraceExt( playermove_t *pmove, vec3_t start, vec3_t end, int
 		if(( flags & PM_CUSTOM_IGNORE ) && pe->solid == SOLID_CUSTOM )
 			continue;
 
+		// can't hit anything outside of bounds
+		if( touch && !touch[i] )
+			continue;
+
 		hullcount = 1;
 
 		if( pe->solid == SOLID_CUSTOM )
@@ -541,10 +1001,13 @@ int PM_TestPlayerPosition( playermove_t *pmove, vec3_t pos, pmtrace_t *ptrace, p
 	vec3_t	mins, maxs;
 	pmtrace_t trace;
 	physent_t *pe;
+	const byte *touch;
 
 	trace = PM_PlayerTraceExt( pmove, pmove->origin, pmove->origin, 0, pmove->numphysent, pmove->physents, -1, pmFilter );
 	if( ptrace ) *ptrace = trace;
 
+	touch = PM_BroadphaseTouch( pmove, pmove->physents, pmove->numphysent, pos, pos );
+
 	for( i = 0; i < pmove->numphysent; i++ )
 	{
 		pe = &pmove->physents[i];
@@ -559,6 +1022,9 @@ int PM_TestPlayerPosition( playermove_t *pmove, vec3_t pos, pmtrace_t *ptrace, p
 		if( pe->model != NULL && pe->solid == SOLID_NOT && pe->skin != CONTENTS_NONE )
 			continue;
 
+		if( touch && !touch[i] )
+			continue;
+
 		hullcount = 1;
 
 		if( pe->solid == SOLID_CUSTOM )
@@ -888,3 +1354,415 @@ void PM_StuckTouch( playermove_t *pmove, int hitent, pmtrace_t *tr )
 
 	pmove->touchindex[pmove->numtouch++] = *tr;
 }
+
+/*
+==================
+PM_TraceRecord_f
+
+record every world hull trace on current map
+==================
+*/
+void PM_TraceRecord_f( void )
+{
+	pm_traceheader_t hdr;
+	int i;
+
+	if( pm_tracefile )
+	{
+		Con_Printf( "Stopped recording traces\n" );
+		FS_Close( pm_tracefile );
+		pm_tracefile = NULL;
+		return;
+	}
+
+	if( Cmd_Argc() != 2 )
+	{
+		Con_Printf( S_USAGE "pm_tracerecord <filename>\n" );
+		return;
+	}
+
+	if( !world.num_flatclipnodes )
+	{
+		Con_Printf( "Map is not loaded\n" );
+		return;
+	}
+
+	if(( pm_tracefile = FS_Open( Cmd_Argv( 1 ), "wb", true )) == NULL )
+	{
+		Con_Printf( S_ERROR "couldn't open %s\n", Cmd_Argv( 1 ));
+		return;
+	}
+
+	memset( &hdr, 0, sizeof( hdr ));
+	hdr.ident = PM_TRACEFILE_IDENT;
+	hdr.version = PM_TRACEFILE_VERSION;
+	hdr.numtables = world.num_flatclipnodes;
+
+	for( i = 0; i < world.num_flatclipnodes; i++ )
+		hdr.numnodes[i] = world.flatclipnodes[i].numnodes;
+
+	FS_Write( pm_tracefile, &hdr, sizeof( hdr ));
+	Con_Printf( "Recording traces to %s, run pm_tracerecord again to stop\n", Cmd_Argv( 1 ));
+}
+
+/*
+==================
+PM_HullForRecord
+
+==================
+*/
+static qboolean PM_HullForRecord( const pm_tracerecord_t *rec, hull_t *hull )
+{
+	const mflatclipnodes_t *flat;
+
+	if( rec->table < 0 || rec->table >= world.num_flatclipnodes )
+		return false;
+
+	flat = &world.flatclipnodes[rec->table];
+
+	if( rec->firstclipnode < 0 || rec->lastclipnode > flat->numnodes )
+		return false;
+
+	memset( hull, 0, sizeof( *hull ));
+	hull->clipnodes16 = (mclipnode16_t *)flat->source;
+	hull->planes = flat->planes;
+	hull->firstclipnode = rec->firstclipnode;
+	hull->lastclipnode = rec->lastclipnode;
+
+	return true;
+}
+
+/*
+==================
+PM_TraceBench_f
+
+replay recorded traces with recursive and iterative
+hull checks, compare results and timings
+==================
+*/
+void PM_TraceBench_f( void )
+{
+	const pm_traceheader_t *hdr;
+	const pm_tracerecord_t *recs;
+	pmtrace_t *expected, trace;
+	double start, time_r, time_i;
+	int i, j, count, passes, mismatches = 0;
+	fs_offset_t len;
+	hull_t hull;
+	byte *buf;
+
+	if( Cmd_Argc() < 2 )
+	{
+		Con_Printf( S_USAGE "pm_tracebench <filename> [passes]\n" );
+		return;
+	}
+
+	if( pm_tracefile )
+	{
+		Con_Printf( "Can't run benchmark while recording traces\n" );
+		return;
+	}
+
+	passes = Cmd_Argc() > 2 ? Q_max( 1, Q_atoi( Cmd_Argv( 2 ))) : 10;
+
+	if(( buf = FS_LoadFile( Cmd_Argv( 1 ), &len, false )) == NULL )
+	{
+		Con_Printf( S_ERROR "couldn't load %s\n", Cmd_Argv( 1 ));
+		return;
+	}
+
+	hdr = (const pm_traceheader_t *)buf;
+
+	if( len < sizeof( *hdr ) || hdr->ident != PM_TRACEFILE_IDENT || hdr->version != PM_TRACEFILE_VERSION )
+	{
+		Con_Printf( S_ERROR "%s is not a trace file\n", Cmd_Argv( 1 ));
+		Mem_Free( buf );
+		return;
+	}
+
+	for( i = 0; i < MAX_MAP_HULLS; i++ )
+	{
+		if( hdr->numtables != world.num_flatclipnodes || ( i < hdr->numtables && hdr->numnodes[i] != world.flatclipnodes[i].numnodes ))
+			break;
+	}
+
+	if( i != MAX_MAP_HULLS )
+	{
+		Con_Printf( S_ERROR "%s was recorded on another map\n", Cmd_Argv( 1 ));
+		Mem_Free( buf );
+		return;
+	}
+
+	recs = (const pm_tracerecord_t *)( buf + sizeof( *hdr ));
+	count = ( len - sizeof( *hdr )) / sizeof( *recs );
+
+	for( i = 0; i < count; i++ )
+	{
+		if( !PM_HullForRecord( &recs[i], &hull ))
+			break;
+	}
+
+	if( !count || i != count )
+	{
+		Con_Printf( S_ERROR "%s has no valid traces\n", Cmd_Argv( 1 ));
+		Mem_Free( buf );
+		return;
+	}
+
+	expected = Mem_Malloc( host.mempool, sizeof( *expected ) * count );
+
+	start = Sys_DoubleTime();
+	for( j = 0; j < passes; j++ )
+	{
+		for( i = 0; i < count; i++ )
+		{
+			PM_HullForRecord( &recs[i], &hull );
+			PM_InitPMTrace( &expected[i], recs[i].end );
+			PM_RecursiveHullCheck_r( &hull, hull.firstclipnode, 0, 1, (float *)recs[i].start, (float *)recs[i].end, &expected[i] );
+		}
+	}
+	time_r = Sys_DoubleTime() - start;
+
+	start = Sys_DoubleTime();
+	for( j = 0; j < passes; j++ )
+	{
+		for( i = 0; i < count; i++ )
+		{
+			PM_HullForRecord( &recs[i], &hull );
+			PM_InitPMTrace( &trace, recs[i].end );
+			PM_RecursiveHullCheck( &hull, hull.firstclipnode, 0, 1, (float *)recs[i].start, (float *)recs[i].end, &trace );
+		}
+	}
+	time_i = Sys_DoubleTime() - start;
+
+	for( i = 0; i < count; i++ )
+	{
+		PM_HullForRecord( &recs[i], &hull );
+		PM_InitPMTrace( &trace, recs[i].end );
+		PM_RecursiveHullCheck( &hull, hull.firstclipnode, 0, 1, (float *)recs[i].start, (float *)recs[i].end, &trace );
+
+		if( memcmp( &trace, &expected[i], sizeof( trace )))
+			mismatches++;
+	}
+
+	Con_Printf( "%i traces, %i passes\n", count, passes );
+	Con_Printf( "recursive: %.3f ms, %.1f ns per trace\n", time_r * 1000.0, time_r * 1e9 / ( count * passes ));
+	Con_Printf( "iterative: %.3f ms, %.1f ns per trace\n", time_i * 1000.0, time_i * 1e9 / ( count * passes ));
+
+	if( mismatches )
+		Con_Printf( S_ERROR "%i traces have mismatched results\n", mismatches );
+
+	Mem_Free( expected );
+	Mem_Free( buf );
+}
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+static int Test_RandomInt( uint *seed, int max )
+{
+	*seed = *seed * 1103515245 + 12345;
+	return ( *seed >> 16 ) % max;
+}
+
+static int Test_BuildHullNode( mclipnode16_t *nodes, mplane_t *planes, int *numnodes, int depth, uint *seed )
+{
+	static const int contents[] = { CONTENTS_EMPTY, CONTENTS_SOLID, CONTENTS_SOLID, CONTENTS_WATER };
+	mplane_t *plane;
+	int num;
+
+	if( depth == 0 || ( *numnodes > 0 && Test_RandomInt( seed, 8 ) == 0 ))
+		return contents[Test_RandomInt( seed, ARRAYSIZE( contents ))];
+
+	num = (*numnodes)++;
+	plane = &planes[num];
+	memset( plane, 0, sizeof( *plane ));
+	plane->type = Test_RandomInt( seed, 4 );
+	plane->dist = Test_RandomInt( seed, 128 ) - 64.0f;
+
+	if( plane->type < 3 )
+	{
+		plane->normal[plane->type] = 1.0f;
+	}
+	else
+	{
+		plane->normal[0] = Test_RandomInt( seed, 3 ) - 1.0f;
+		plane->normal[1] = Test_RandomInt( seed, 3 ) - 1.0f;
+		plane->normal[2] = 1.0f;
+		VectorNormalize( plane->normal );
+	}
+
+	nodes[num].planenum = num;
+	nodes[num].children[0] = Test_BuildHullNode( nodes, planes, numnodes, depth - 1, seed );
+	nodes[num].children[1] = Test_BuildHullNode( nodes, planes, numnodes, depth - 1, seed );
+
+	return num;
+}
+
+static void Test_CompareHullChecks( hull_t *hull, mclipnode_flat_t *flat, int numnodes, const vec3_t p1, const vec3_t p2 )
+{
+	pmtrace_t expected, trace;
+	vec3_t start, end;
+
+	VectorCopy( p1, start );
+	VectorCopy( p2, end );
+
+	PM_InitPMTrace( &expected, end );
+	PM_RecursiveHullCheck_r( hull, hull->firstclipnode, 0, 1, start, end, &expected );
+
+	// generic clipnodes
+	world.num_flatclipnodes = 0;
+	PM_InitPMTrace( &trace, end );
+	PM_RecursiveHullCheck( hull, hull->firstclipnode, 0, 1, start, end, &trace );
+	TASSERT( !memcmp( &trace, &expected, sizeof( trace )));
+
+	// flattened clipnodes
+	world.flatclipnodes[0].source = hull->clipnodes16;
+	world.flatclipnodes[0].planes = hull->planes;
+	world.flatclipnodes[0].nodes = flat;
+	world.flatclipnodes[0].numnodes = numnodes;
+	world.num_flatclipnodes = 1;
+	PM_InitPMTrace( &trace, end );
+	PM_RecursiveHullCheck( hull, hull->firstclipnode, 0, 1, start, end, &trace );
+	TASSERT( !memcmp( &trace, &expected, sizeof( trace )));
+	TASSERT_EQi( PM_HullPointContents( hull, hull->firstclipnode, end ), PM_FlatPointContents( flat, hull->firstclipnode, end ));
+	world.num_flatclipnodes = 0;
+}
+
+static void Test_RunPMBroadphase( uint *seed )
+{
+	playermove_t *pmove = Mem_Calloc( host.mempool, sizeof( *pmove ));
+	vec3_t saved_mins, saved_maxs;
+	int i, j;
+
+	VectorCopy( host.player_mins[0], saved_mins );
+	VectorCopy( host.player_maxs[0], saved_maxs );
+	VectorSet( host.player_mins[0], -16.0f, -16.0f, -36.0f );
+	VectorSet( host.player_maxs[0], 16.0f, 16.0f, 36.0f );
+
+	PM_InitBoxHull();
+	pmove->server = true;
+	pmove->usehull = 0;
+	pmove->numphysent = 64;
+
+	for( i = 0; i < pmove->numphysent; i++ )
+	{
+		physent_t *pe = &pmove->physents[i];
+
+		pe->info = i;
+		pe->solid = SOLID_BBOX;
+		VectorSet( pe->origin, Test_RandomInt( seed, 512 ) - 256.0f, Test_RandomInt( seed, 512 ) - 256.0f, Test_RandomInt( seed, 128 ) - 64.0f );
+		VectorSet( pe->mins, -Test_RandomInt( seed, 32 ) - 1.0f, -Test_RandomInt( seed, 32 ) - 1.0f, -Test_RandomInt( seed, 32 ) - 1.0f );
+		VectorSet( pe->maxs, Test_RandomInt( seed, 32 ) + 1.0f, Test_RandomInt( seed, 32 ) + 1.0f, Test_RandomInt( seed, 32 ) + 1.0f );
+	}
+
+	// traces must be the same with and without broadphase
+	for( j = 0; j < 1024; j++ )
+	{
+		pmtrace_t expected, trace;
+		vec3_t start, end;
+
+		VectorSet( start, Test_RandomInt( seed, 640 ) - 320.0f, Test_RandomInt( seed, 640 ) - 320.0f, Test_RandomInt( seed, 256 ) - 128.0f );
+		VectorSet( end, Test_RandomInt( seed, 640 ) - 320.0f, Test_RandomInt( seed, 640 ) - 320.0f, Test_RandomInt( seed, 256 ) - 128.0f );
+
+		if( j & 1 )
+			VectorCopy( start, end );
+
+		expected = PM_PlayerTraceExt( pmove, start, end, 0, pmove->numphysent, pmove->physents, -1, NULL );
+		VectorCopy( start, pmove->origin );
+
+		PM_SetupBroadphase( pmove );
+		trace = PM_PlayerTraceExt( pmove, start, end, 0, pmove->numphysent, pmove->physents, -1, NULL );
+		TASSERT( !memcmp( &trace, &expected, sizeof( trace )));
+		i = PM_TestPlayerPosition( pmove, end, NULL, NULL );
+		PM_ClearBroadphase( pmove );
+		TASSERT_EQi( i, PM_TestPlayerPosition( pmove, end, NULL, NULL ));
+	}
+
+	VectorCopy( saved_mins, host.player_mins[0] );
+	VectorCopy( saved_maxs, host.player_maxs[0] );
+	Mem_Free( pmove );
+}
+
+void Test_RunPMTrace( void )
+{
+	poolhandle_t pool = Mem_AllocPool( "pm trace test" );
+	mclipnode16_t *nodes = Mem_Calloc( pool, sizeof( *nodes ) * 1024 );
+	mplane_t *planes = Mem_Calloc( pool, sizeof( *planes ) * 1024 );
+	mclipnode_flat_t *flat;
+	uint32_t saved_version = world.version;
+	uint seed = 0x1337;
+	int i, j, numnodes;
+	hull_t hull;
+
+	world.version = HLBSP_VERSION;
+
+	// random trees, traced with random segments
+	for( i = 0; i < 16; i++ )
+	{
+		numnodes = 0;
+		Test_BuildHullNode( nodes, planes, &numnodes, 9, &seed );
+
+		memset( &hull, 0, sizeof( hull ));
+		hull.clipnodes16 = nodes;
+		hull.planes = planes;
+		hull.firstclipnode = 0;
+		hull.lastclipnode = numnodes - 1;
+
+		flat = Mod_FlattenClipnodes( pool, &hull, numnodes, numnodes );
+		TASSERT( flat != NULL );
+
+		for( j = 0; flat && j < 256; j++ )
+		{
+			vec3_t p1, p2;
+
+			VectorSet( p1, Test_RandomInt( &seed, 160 ) - 80.0f, Test_RandomInt( &seed, 160 ) - 80.0f, Test_RandomInt( &seed, 160 ) - 80.0f );
+			VectorSet( p2, Test_RandomInt( &seed, 160 ) - 80.0f, Test_RandomInt( &seed, 160 ) - 80.0f, Test_RandomInt( &seed, 160 ) - 80.0f );
+			Test_CompareHullChecks( &hull, flat, numnodes, p1, p2 );
+		}
+	}
+
+	// chain of nodes deeper than traversal stack
+	numnodes = PM_HULLCHECK_STACK * 2 + 1;
+	for( i = 0; i < numnodes; i++ )
+	{
+		memset( &planes[i], 0, sizeof( planes[i] ));
+		planes[i].type = PLANE_X;
+		planes[i].normal[0] = 1.0f;
+		planes[i].dist = i;
+		nodes[i].planenum = i;
+		nodes[i].children[0] = i == numnodes - 1 ? CONTENTS_SOLID : i + 1;
+		nodes[i].children[1] = i & 1 ? CONTENTS_WATER : CONTENTS_EMPTY;
+	}
+
+	memset( &hull, 0, sizeof( hull ));
+	hull.clipnodes16 = nodes;
+	hull.planes = planes;
+	hull.firstclipnode = 0;
+	hull.lastclipnode = numnodes - 1;
+
+	flat = Mod_FlattenClipnodes( pool, &hull, numnodes, numnodes );
+	TASSERT( flat != NULL );
+
+	if( flat )
+	{
+		const vec3_t far = { numnodes + 10.0f, 0.0f, 0.0f };
+		const vec3_t near = { -10.0f, 0.0f, 0.0f };
+		const vec3_t middle = { numnodes * 0.5f + 0.25f, 0.0f, 0.0f };
+
+		Test_CompareHullChecks( &hull, flat, numnodes, far, near );
+		Test_CompareHullChecks( &hull, flat, numnodes, near, far );
+		Test_CompareHullChecks( &hull, flat, numnodes, middle, near );
+		Test_CompareHullChecks( &hull, flat, numnodes, near, middle );
+	}
+
+	// bad plane references must not be flattened
+	nodes[0].planenum = numnodes;
+	TASSERT( Mod_FlattenClipnodes( pool, &hull, numnodes, numnodes ) == NULL );
+
+	Test_RunPMBroadphase( &seed );
+
+	world.version = saved_version;
+	Mem_FreePool( &pool );
+}
+#endif // XASH_ENGINE_TESTS
@@ -0,0 +1,85 @@
+/*
+precache.h - precache names lookup
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#ifndef PRECACHE_H
+#define PRECACHE_H
+
+#include "protocol.h"
+#include "crclib.h"
+
+#define PRECACHE_HASH_SIZE	256	// must be power of 2
+
+// largest precache list
+#define PRECACHE_HASH_SLOTS	(( MAX_MODELS > MAX_SOUNDS ) ? \
+	(( MAX_MODELS > MAX_EVENTS ) ? (( MAX_MODELS > MAX_CUSTOM ) ? MAX_MODELS : MAX_CUSTOM ) : (( MAX_EVENTS > MAX_CUSTOM ) ? MAX_EVENTS : MAX_CUSTOM )) : \
+	(( MAX_SOUNDS > MAX_EVENTS ) ? (( MAX_SOUNDS > MAX_CUSTOM ) ? MAX_SOUNDS : MAX_CUSTOM ) : (( MAX_EVENTS > MAX_CUSTOM ) ? MAX_EVENTS : MAX_CUSTOM )))
+
+// case insensitive index of precache list, slot 0 is never used
+typedef struct precache_hash_s
+{
+	word	first[PRECACHE_HASH_SIZE];	// first slot in bucket
+	word	next[PRECACHE_HASH_SLOTS];	// next slot in same bucket
+	int	count;			// slots [1, count] are hashed
+} precache_hash_t;
+
+static inline void Precache_ClearHash( precache_hash_t *hash )
+{
+	memset( hash->first, 0, sizeof( hash->first ));
+	hash->count = 0;
+}
+
+static inline void Precache_AddHash( precache_hash_t *hash, const char *name, int slot )
+{
+	uint bucket = COM_HashKey( name, PRECACHE_HASH_SIZE );
+
+	hash->next[slot] = hash->first[bucket];
+	hash->first[bucket] = slot;
+	hash->count = slot > hash->count ? slot : hash->count;
+}
+
+static inline int Precache_FirstHash( const precache_hash_t *hash, const char *name )
+{
+	return hash->first[COM_HashKey( name, PRECACHE_HASH_SIZE )];
+}
+
+static inline int Precache_NextHash( const precache_hash_t *hash, int slot )
+{
+	return hash->next[slot];
+}
+
+/*
+==================
+Precache_FindName
+
+find name in precache list which is filled sequentially,
+slots that were filled bypassing the hash are added here
+==================
+*/
+static inline int Precache_FindName( precache_hash_t *hash, char (*list)[MAX_QPATH], int maxslots, const char *name )
+{
+	int i;
+
+	while( hash->count + 1 < maxslots && list[hash->count + 1][0] )
+		Precache_AddHash( hash, list[hash->count + 1], hash->count + 1 );
+
+	for( i = Precache_FirstHash( hash, name ); i; i = Precache_NextHash( hash, i ))
+	{
+		if( !Q_stricmp( list[i], name ))
+			return i;
+	}
+
+	return 0;
+}
+
+#endif // PRECACHE_H
@@ -23,9 +23,13 @@ GNU General Public License for more details.
 #include <sys/time.h>
 #endif
 #include "xash3d_mathlib.h"
+#include "platform/platform.h"
 #if XASH_WIN32
 #include <io.h>
 #endif
+#if XASH_SDL == 2
+#include <SDL_thread.h>
+#endif
 
 // do not waste precious CPU cycles on mobiles or low memory devices
 #if !XASH_WIN32 && !XASH_MOBILE_PLATFORM && !XASH_LOW_MEMORY && !XASH_EMSCRIPTEN
@@ -43,6 +47,9 @@ static struct logdata_s {
 	int      logfileno;
 } s_ld;
 
+static CVAR_DEFINE_AUTO( log_flush_interval, "0.5", FCVAR_ARCHIVE, "max delay in seconds before queued log lines are written" );
+static CVAR_DEFINE_AUTO( log_flush_size, "16384", FCVAR_ARCHIVE, "amount of queued log data in bytes to be written without waiting" );
+
 void Sys_DestroyConsole( void )
 {
 	// last text message into console or log
@@ -78,10 +85,436 @@ static void Sys_FlushLogfile( void )
 		fflush( s_ld.logfile );
 }
 
+/*
+===============================================================================
+
+LOG QUEUE
+
+lines are preformatted by the caller and written by the log thread in batches
+
+===============================================================================
+*/
+#define LOG_QUEUE_SIZE	0x40000	// must be power of 2
+#define LOG_BATCH_SIZE	0x4000
+
+typedef struct logrecord_s
+{
+	file_t	*file;	// NULL for engine log
+	int	len;
+} logrecord_t;
+
+static void Sys_LogThread( void );
+
+#if XASH_SDL == 2
+#define mutex_create( x )    (( x ) = SDL_CreateMutex() )
+#define mutex_lock( x )      SDL_LockMutex(( x ))
+#define mutex_unlock( x )    SDL_UnlockMutex(( x ))
+#define mutex_trylock( x )   ( SDL_TryLockMutex(( x )) == 0 )
+#define cond_create( x )     (( x ) = SDL_CreateCond() )
+#define cond_signal( x )     SDL_CondSignal(( x ))
+#define cond_wait( x, m )    SDL_CondWait(( x ), ( m ))
+#define cond_timedwait( x, m, msec ) SDL_CondWaitTimeout(( x ), ( m ), ( msec ))
+#define create_thread( thread, pfn ) (( thread ) = SDL_CreateThread(( pfn ), "Log writer", NULL ))
+#define join_thread( x )     SDL_WaitThread(( x ), NULL )
+typedef SDL_mutex *mutex_t;
+typedef SDL_cond *cond_t;
+typedef SDL_Thread *thread_t;
+static int Sys_LogThreadStart( void *unused )
+{
+	Sys_LogThread();
+	return 0;
+}
+#elif !XASH_WIN32
+#include <pthread.h>
+#define mutex_create( x )     pthread_mutex_init( &( x ), NULL )
+#define mutex_lock( x )       pthread_mutex_lock( &( x ))
+#define mutex_unlock( x )     pthread_mutex_unlock( &( x ))
+#define mutex_trylock( x )    ( pthread_mutex_trylock( &( x )) == 0 )
+#define cond_create( x )      pthread_cond_init( &( x ), NULL )
+#define cond_signal( x )      pthread_cond_signal( &( x ))
+#define cond_wait( x, m )     pthread_cond_wait( &( x ), &( m ))
+#define cond_timedwait( x, m, msec ) Sys_CondTimedWait( &( x ), &( m ), ( msec ))
+#define create_thread( thread, pfn ) !pthread_create( &( thread ), NULL, ( pfn ), NULL )
+#define join_thread( x )      pthread_join(( x ), NULL )
+typedef pthread_mutex_t mutex_t;
+typedef pthread_cond_t cond_t;
+typedef pthread_t thread_t;
+static void *Sys_LogThreadStart( void *unused )
+{
+	Sys_LogThread();
+	return NULL;
+}
+
+static void Sys_CondTimedWait( pthread_cond_t *cond, pthread_mutex_t *mutex, int msec )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_REALTIME, &ts );
+	ts.tv_sec += msec / 1000;
+	ts.tv_nsec += ( msec % 1000 ) * 1000000L;
+
+	if( ts.tv_nsec >= 1000000000L )
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	pthread_cond_timedwait( cond, mutex, &ts );
+}
+#else // WIN32
+#define mutex_create( x )   InitializeCriticalSection( &( x ))
+#define mutex_lock( x )     EnterCriticalSection( &( x ))
+#define mutex_unlock( x )   LeaveCriticalSection( &( x ))
+#define mutex_trylock( x )  TryEnterCriticalSection( &( x ))
+// auto reset event, fine for a single waiter that rechecks the state
+#define cond_create( x )    (( x ) = CreateEvent( NULL, FALSE, FALSE, NULL ))
+#define cond_signal( x )    SetEvent(( x ))
+#define cond_timedwait( x, m, msec ) ( LeaveCriticalSection( &( m )), WaitForSingleObject(( x ), ( msec )), EnterCriticalSection( &( m )))
+#define cond_wait( x, m )   cond_timedwait( x, m, INFINITE )
+#define create_thread( thread, pfn ) (( thread ) = CreateThread( NULL, 0, ( pfn ), NULL, 0, NULL ))
+#define join_thread( x )    ( WaitForSingleObject(( x ), INFINITE ), CloseHandle(( x )))
+typedef CRITICAL_SECTION mutex_t;
+typedef HANDLE cond_t;
+typedef HANDLE thread_t;
+static DWORD WINAPI Sys_LogThreadStart( LPVOID unused )
+{
+	Sys_LogThread();
+	return 0;
+}
+#endif // !_WIN32
+
+static struct logqueue_s
+{
+	char     data[LOG_QUEUE_SIZE];
+	size_t   head;            // total bytes queued
+	size_t   claimed;         // total bytes taken by log thread
+	size_t   tail;            // total bytes written
+	int      dropped;         // records didn't fit into the queue
+	mutex_t  lock;            // created once and never destroyed, other threads may print at any time
+	cond_t   wake;            // signaled when log thread has work to do
+	cond_t   done;            // signaled when queued data is written
+	thread_t thread;
+	qboolean initialized;
+	qboolean running;         // read under lock
+	qboolean flush;           // write everything right now
+	qboolean quit;
+} s_lq;
+
+static void Sys_LogQueueCopy( size_t pos, const void *data, size_t len )
+{
+	size_t ofs = pos & ( LOG_QUEUE_SIZE - 1 );
+	size_t part = Q_min( len, LOG_QUEUE_SIZE - ofs );
+
+	memcpy( s_lq.data + ofs, data, part );
+	memcpy( s_lq.data, (const byte *)data + part, len - part );
+}
+
+static void Sys_LogQueueFetch( size_t pos, void *data, size_t len )
+{
+	size_t ofs = pos & ( LOG_QUEUE_SIZE - 1 );
+	size_t part = Q_min( len, LOG_QUEUE_SIZE - ofs );
+
+	memcpy( data, s_lq.data + ofs, part );
+	memcpy( (byte *)data + part, s_lq.data, len - part );
+}
+
+static void Sys_LogWrite( file_t *file, const char *data, size_t len )
+{
+	if( !len )
+		return;
+
+	if( file )
+	{
+		FS_Write( file, data, len );
+	}
+	else if( s_ld.logfile )
+	{
+		if( write( s_ld.logfileno, data, len ) < 0 )
+			fprintf( stderr, "%s: write failed: %s\n", __func__, strerror( errno ));
+	}
+}
+
+/*
+=================
+Sys_LogQueueDrain
+
+write out everything that was queued so far, called from log thread only
+=================
+*/
+static void Sys_LogQueueDrain( void )
+{
+	static char batch[LOG_BATCH_SIZE];
+	size_t      pos, head, batchlen = 0;
+	file_t      *batchfile = NULL;
+	int         dropped;
+
+	mutex_lock( s_lq.lock );
+	pos = s_lq.claimed;
+	head = s_lq.claimed = s_lq.head;
+	dropped = s_lq.dropped;
+	s_lq.dropped = 0;
+	mutex_unlock( s_lq.lock );
+
+	// records between tail and head are never touched by producers
+	while( pos != head )
+	{
+		logrecord_t rec;
+		size_t      len;
+
+		Sys_LogQueueFetch( pos, &rec, sizeof( rec ));
+		pos += sizeof( rec );
+
+		if( rec.file != batchfile || batchlen + rec.len > sizeof( batch ))
+		{
+			Sys_LogWrite( batchfile, batch, batchlen );
+			batchfile = rec.file;
+			batchlen = 0;
+		}
+
+		len = rec.len;
+
+		if( len > sizeof( batch ))
+		{
+			// too long for the batch, write in place
+			size_t ofs = pos & ( LOG_QUEUE_SIZE - 1 );
+			size_t part = Q_min( len, LOG_QUEUE_SIZE - ofs );
+
+			Sys_LogWrite( rec.file, s_lq.data + ofs, part );
+			Sys_LogWrite( rec.file, s_lq.data, len - part );
+		}
+		else
+		{
+			Sys_LogQueueFetch( pos, batch + batchlen, len );
+			batchlen += len;
+		}
+
+		pos += len;
+	}
+
+	Sys_LogWrite( batchfile, batch, batchlen );
+
+	if( dropped )
+	{
+		batchlen = Q_snprintf( batch, sizeof( batch ), "[%d log messages dropped, queue is full]\n", dropped );
+		Sys_LogWrite( NULL, batch, batchlen );
+	}
+
+	mutex_lock( s_lq.lock );
+	s_lq.tail = pos;
+	cond_signal( s_lq.done );
+	mutex_unlock( s_lq.lock );
+}
+
+static void Sys_LogThread( void )
+{
+	double lastflush = Platform_DoubleTime();
+
+	mutex_lock( s_lq.lock );
+
+	while( !s_lq.quit )
+	{
+		size_t pending = s_lq.head - s_lq.tail;
+		double wait = log_flush_interval.value - ( Platform_DoubleTime() - lastflush );
+
+		if( !pending )
+		{
+			// sleep until something is queued
+			cond_wait( s_lq.wake, s_lq.lock );
+		}
+		else if( s_lq.flush || pending >= log_flush_size.value || wait <= 0.0 )
+		{
+			s_lq.flush = false;
+			mutex_unlock( s_lq.lock );
+			Sys_LogQueueDrain();
+			lastflush = Platform_DoubleTime();
+			mutex_lock( s_lq.lock );
+		}
+		else cond_timedwait( s_lq.wake, s_lq.lock, (int)( wait * 1000.0 ) + 1 );
+	}
+
+	mutex_unlock( s_lq.lock );
+
+	// write the rest before exit
+	Sys_LogQueueDrain();
+}
+
+/*
+=================
+Sys_QueueLog
+
+queue preformatted log data for file, or engine log if NULL
+returns false if it must be written by caller
+=================
+*/
+qboolean Sys_QueueLog( file_t *file, const char *data, size_t len )
+{
+	logrecord_t rec;
+
+	if( !s_lq.initialized )
+		return false;
+
+	rec.file = file;
+	rec.len = len;
+
+	mutex_lock( s_lq.lock );
+
+	if( !s_lq.running )
+	{
+		mutex_unlock( s_lq.lock );
+		return false;
+	}
+
+	// never wait for the disk, just lose the message
+	if( LOG_QUEUE_SIZE - ( s_lq.head - s_lq.tail ) < sizeof( rec ) + len )
+	{
+		s_lq.dropped++;
+	}
+	else
+	{
+		const qboolean wasempty = s_lq.head == s_lq.tail;
+
+		Sys_LogQueueCopy( s_lq.head, &rec, sizeof( rec ));
+		Sys_LogQueueCopy( s_lq.head + sizeof( rec ), data, len );
+		s_lq.head += sizeof( rec ) + len;
+
+		// otherwise log thread is already waiting for flush interval
+		if( wasempty || s_lq.head - s_lq.tail >= log_flush_size.value )
+			cond_signal( s_lq.wake );
+	}
+
+	mutex_unlock( s_lq.lock );
+
+	return true;
+}
+
+/*
+=================
+Sys_FlushLog
+
+wait until queued data is written, or timeout in seconds is expired
+=================
+*/
+void Sys_FlushLog( double timeout )
+{
+	double end = Platform_DoubleTime() + timeout;
+
+	if( !s_lq.initialized )
+		return;
+
+	mutex_lock( s_lq.lock );
+	s_lq.flush = true;
+	cond_signal( s_lq.wake );
+
+	while( s_lq.running && s_lq.head != s_lq.tail )
+	{
+		double left = end - Platform_DoubleTime();
+
+		if( timeout <= 0.0 )
+			cond_wait( s_lq.done, s_lq.lock );
+		else if( left > 0.0 )
+			cond_timedwait( s_lq.done, s_lq.lock, (int)( left * 1000.0 ) + 1 );
+		else break;
+	}
+
+	mutex_unlock( s_lq.lock );
+}
+
+/*
+=================
+Sys_CrashFlushLog
+
+write queued engine log lines from a crash handler, which can run on any
+thread, even on the log thread or on one holding the lock, so it never
+waits, lines the log thread has already taken may be lost
+=================
+*/
+void Sys_CrashFlushLog( void )
+{
+	size_t pos;
+
+	if( !s_lq.initialized || !mutex_trylock( s_lq.lock ))
+		return;
+
+	for( pos = s_lq.claimed; pos != s_lq.head; )
+	{
+		logrecord_t rec;
+
+		Sys_LogQueueFetch( pos, &rec, sizeof( rec ));
+		pos += sizeof( rec );
+
+		// server logs are written through filesystem buffers, which can't be trusted now
+		if( !rec.file )
+		{
+			size_t ofs = pos & ( LOG_QUEUE_SIZE - 1 );
+			size_t part = Q_min( (size_t)rec.len, LOG_QUEUE_SIZE - ofs );
+
+			Sys_LogWrite( NULL, s_lq.data + ofs, part );
+			Sys_LogWrite( NULL, s_lq.data, rec.len - part );
+		}
+
+		pos += rec.len;
+	}
+
+	if( s_lq.tail == s_lq.claimed )
+		s_lq.tail = pos; // log thread isn't writing anything
+	s_lq.claimed = pos;
+
+	mutex_unlock( s_lq.lock );
+}
+
+/*
+=================
+Sys_StartLogThread
+
+called when a log file is opened, so there is no thread without logs
+=================
+*/
+void Sys_StartLogThread( void )
+{
+	if( !s_lq.initialized || s_lq.running || Sys_CheckParm( "-logsync" ))
+		return;
+
+	mutex_lock( s_lq.lock );
+	s_lq.head = s_lq.claimed = s_lq.tail = 0;
+	s_lq.dropped = 0;
+	s_lq.flush = s_lq.quit = false;
+
+	if( create_thread( s_lq.thread, Sys_LogThreadStart ))
+		s_lq.running = true;
+	mutex_unlock( s_lq.lock );
+
+	if( !s_lq.running )
+		Con_Reportf( S_WARN "%s: can't start log thread, logging synchronously\n", __func__ );
+}
+
+static void Sys_StopLogThread( void )
+{
+	if( !s_lq.running )
+		return;
+
+	// from now on other threads write synchronously
+	mutex_lock( s_lq.lock );
+	s_lq.quit = true;
+	s_lq.running = false;
+	cond_signal( s_lq.wake );
+	mutex_unlock( s_lq.lock );
+
+	join_thread( s_lq.thread );
+}
+
 void Sys_InitLog( void )
 {
 	const char *mode;
 
+	// before any other thread is started, so they never see half created lock
+	if( !s_lq.initialized )
+	{
+		mutex_create( s_lq.lock );
+		cond_create( s_lq.wake );
+		cond_create( s_lq.done );
+		s_lq.initialized = true;
+	}
+
 	if( Sys_CheckParm( "-log" ))
 	{
 		if( !Sys_GetParmFromCmdLine( "-log", s_ld.log_path ) || !isalnum( s_ld.log_path[0] ))
@@ -93,6 +526,9 @@ void Sys_InitLog( void )
 
 	s_ld.log_time = Sys_CheckParm( "-logtime" );
 
+	Cvar_RegisterVariable( &log_flush_interval );
+	Cvar_RegisterVariable( &log_flush_size );
+
 	if( host.change_game && host.type != HOST_DEDICATED )
 		mode = "a";
 	else mode = "w";
@@ -120,12 +556,15 @@ void Sys_InitLog( void )
 		fprintf( s_ld.logfile, "Game started at %s\n", Q_timestamp( TIME_FULL ));
 		fputs( "================================================================================\n", s_ld.logfile );
 		fflush( s_ld.logfile );
+
+		Sys_StartLogThread();
 	}
 }
 
 void Sys_CloseLog( const char *finalmsg )
 {
 	Sys_FlushStdout(); // flush to stdout to ensure all data was written
+	Sys_StopLogThread(); // write all queued lines
 
 	if( !s_ld.logfile )
 		return;
@@ -303,6 +742,8 @@ void Sys_PrintLog( const char *pMsg )
 	// spew to engine.log
 	if( s_ld.logfile )
 	{
+		char buf[MAX_PRINT_MSG + 32];
+
 		if( s_ld.log_time && print_time )
 		{
 			logtime_len = strftime( logtime, sizeof( logtime ), "[%Y:%m:%d|%H:%M:%S] ", crt_tm ); //full time
@@ -314,6 +755,17 @@ void Sys_PrintLog( const char *pMsg )
 			logtime_len = 0;
 		}
 
+		// colors are stripped here, log thread only does the writing
+		if( logtime_len + len < sizeof( buf ))
+		{
+			memcpy( buf, logtime, logtime_len );
+			COM_StripColors( pMsg, buf + logtime_len );
+
+			if( Sys_QueueLog( NULL, buf, Q_strlen( buf )))
+				return;
+		}
+		else Sys_FlushLog( 0.0 ); // keep the order
+
 		Sys_PrintLogfile( s_ld.logfileno, logtime, logtime_len, pMsg, false );
 		Sys_FlushLogfile();
 	}
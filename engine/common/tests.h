@@ -44,23 +44,33 @@ void Test_RunGamma( void );
 void Test_RunDelta( void );
 void Test_RunBuffer( void );
 void Test_RunMunge( void );
+void Test_RunPMTrace( void );
+void Test_RunUnlag( void );
+void Test_RunSaveFile( void );
+void Test_RunNetSim( void );
+void Test_RunZone( void );
 
 #define TEST_LIST_0 \
 	Test_RunLibCommon(); \
+	Test_RunZone(); \
 	Test_RunCommon(); \
 	Test_RunCmd(); \
 	Test_RunCvar(); \
 	Test_RunIPFilter(); \
 	Test_RunBuffer(); \
 	Test_RunDelta(); \
-	Test_RunMunge();
+	Test_RunMunge(); \
+	Test_RunPMTrace(); \
+	Test_RunUnlag(); \
+	Test_RunNetSim();
 
 #define TEST_LIST_0_CLIENT \
 	Test_RunCon(); \
 	Test_RunGamma();
 
 #define TEST_LIST_1 \
-	Test_RunImagelib();
+	Test_RunImagelib(); \
+	Test_RunSaveFile();
 
 #define TEST_LIST_1_CLIENT \
 	Test_RunVOX();
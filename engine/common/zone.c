@@ -17,9 +17,24 @@ GNU General Public License for more details.
 */
 
 #include "common.h"
+#include "xash3d_mathlib.h"
+#if XASH_WIN32
+#include <windows.h>
+#endif
+#if XASH_SDL == 2
+#include <SDL_thread.h>
+#endif
 
 #define MEMHEADER_SENTINEL1	0xA1BAU
 #define MEMHEADER_SENTINEL2	0xDFU
+#define MEMHEADER_ARENA		0xA2BAU	// sentinel 1 of allocation that lives in arena chunk
+#define MEMHEADER_SLAB		0xA3BAU	// sentinel 1 of slab allocation, which has short header
+
+#define MEMARENA_MIN_CHUNK	( 16 * 1024 )	// first chunk of arena pool
+#define MEMARENA_MAX_CHUNK	( 1024 * 1024 )	// chunks double in size until this
+#define MEMARENA_ALIGN	16
+
+#define MEMSLAB_PAGE	( 64 * 1024 )	// each page is carved into objects of single size class
 
 #ifdef XASH_CUSTOM_SWAP
 #include "platform/swap/swap.h"
@@ -51,6 +66,27 @@ static void *Q_realloc( void *mem, size_t size )
 #define Q_realloc realloc
 #endif
 
+#if XASH_SDL == 2
+#define mutex_create( x )    (( x ) = SDL_CreateMutex() )
+#define mutex_destroy( x )   SDL_DestroyMutex(( x ))
+#define mutex_lock( x )      SDL_LockMutex(( x ))
+#define mutex_unlock( x )    SDL_UnlockMutex(( x ))
+typedef SDL_mutex *mutex_t;
+#elif !XASH_WIN32
+#include <pthread.h>
+#define mutex_create( x )     pthread_mutex_init( &( x ), NULL )
+#define mutex_destroy( x )    pthread_mutex_destroy( &( x ))
+#define mutex_lock( x )       pthread_mutex_lock( &( x ))
+#define mutex_unlock( x )     pthread_mutex_unlock( &( x ))
+typedef pthread_mutex_t mutex_t;
+#else // WIN32
+#define mutex_create( x )   InitializeCriticalSection( &( x ))
+#define mutex_destroy( x )  DeleteCriticalSection( &( x ))
+#define mutex_lock( x )     EnterCriticalSection( &( x ))
+#define mutex_unlock( x )   LeaveCriticalSection( &( x ))
+typedef CRITICAL_SECTION mutex_t;
+#endif // !_WIN32
+
 // keep this structure as compact as possible while keeping it aligned
 // on ILP32 it's 24 bytes, which is aligned to 8 byte boundary
 // on LP64 it's 40 bytes, which is also aligned to 8 byte boundary
@@ -61,15 +97,63 @@ typedef struct memheader_s
 	size_t             size;         // size of the memory after the header (excluding header and sentinel2)
 	poolhandle_t       poolptr;      // pool this memheader belongs to
 	uint16_t           fileline;
-	uint16_t           sentinel1;    // must be equal to MEMHEADER_SENTINEL1
+	uint16_t           sentinel1;    // must be equal to MEMHEADER_SENTINEL1 or MEMHEADER_ARENA
 	// immediately followed by data, which is followed by a MEMHEADER_SENTINEL2 byte
 } memheader_t;
 
 STATIC_CHECK_SIZEOF( memheader_t, 24, 40 );
 
+// arena pools bump allocate from these and never free allocations individually
+typedef struct memchunk_s
+{
+	struct memchunk_s  *next;
+	size_t             size;          // usable size after the header
+	size_t             used;
+} memchunk_t;
+
+#define MEMCHUNK_HEADER ALIGN( sizeof( memchunk_t ), MEMARENA_ALIGN )
+
+// short header of slab allocation, sentinel is at the same
+// place before the data as in memheader_t, so it tells them apart
+typedef struct slabheader_s
+{
+	poolhandle_t       poolptr;       // zero while object is in the free list
+	uint16_t           sizeclass;
+	uint16_t           sentinel1;     // must be equal to MEMHEADER_SLAB
+} slabheader_t;
+
+STATIC_CHECK_SIZEOF( slabheader_t, 8, 8 );
+
+typedef struct slabpage_s
+{
+	struct slabpage_s  *next;
+} slabpage_t;
+
+#define SLABPAGE_HEADER ALIGN( sizeof( slabpage_t ), MEMARENA_ALIGN )
+
+// object sizes including the header
+static const uint16_t mem_slabsizes[] =
+{
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048
+};
+
+#define MEMSLAB_CLASSES ( sizeof( mem_slabsizes ) / sizeof( mem_slabsizes[0] ))
+
+typedef struct memslabs_s
+{
+	slabpage_t         *pages;
+	size_t             numpages;
+	slabheader_t       *freelist[MEMSLAB_CLASSES];
+	size_t             used[MEMSLAB_CLASSES];
+} memslabs_t;
+
 typedef struct mempool_s
 {
 	struct memheader_s *chain;        // chain of individual memory allocations
+	struct memchunk_s  *chunks;       // arena chunks, current one is first
+	size_t             chunksize;     // size of next arena chunk, zero if not an arena
+	size_t             numchunks;
+	struct memslabs_s  *slabs;        // size class free lists, NULL if not a slab pool
 	size_t             totalsize;     // total memory allocated in this pool (inside memheaders)
 	size_t             realsize;      // total memory allocated in this pool (actual malloc total)
 	size_t             lastchecksize; // updated each time the pool is displayed by memlist
@@ -81,6 +165,45 @@ typedef struct mempool_s
 static mempool_t *poolchain = NULL; // critical stuff
 static size_t poolcount = 0;
 
+#define MEMPROF_SITES	8192	// must be power of 2
+
+// allocation call site, same line allocating in different pools is different site
+typedef struct memsite_s
+{
+	const char         *filename;     // NULL if slot is empty
+	int                fileline;
+	poolhandle_t       poolptr;
+	size_t             allocs;        // counted while profiler is running
+	size_t             frees;
+	size_t             allocbytes;
+	size_t             live;          // filled by Mem_ProfileWalk
+	size_t             livecount;
+} memsite_t;
+
+typedef struct memsnap_s
+{
+	size_t             allocs;
+	size_t             frees;
+	size_t             live;
+	size_t             livecount;
+} memsnap_t;
+
+static struct
+{
+	memsite_t          *sites;
+	int                numsites;
+	size_t             overflow;      // allocations that didn't fit the table
+	qboolean           active;
+	double             starttime;
+	memsnap_t          *snapshot;     // indexed same as sites, which never move
+	double             snaptime;
+	mutex_t            lock;
+	qboolean           initialized;
+} mem_profile;
+
+// live memory that can't be attributed to the call site
+static const char mem_slabsite[] = "(slab)";
+
 // a1ba: due to mempool being passed with the model through reused 32-bit field
 // which makes engine incompatible with 64-bit pointers I changed mempool type
 // from pointer to 32-bit handle, thankfully mempool structure is private
@@ -98,16 +221,26 @@ static poolhandle_t Mem_PoolIndex( mempool_t *mempool )
 	return (poolhandle_t)(mempool - poolchain) + 1;
 }
 
-static inline void Mem_PoolAdd( mempool_t *pool, size_t size )
+static inline qboolean Mem_IsArenaAlloc( const memheader_t *mem )
+{
+	return mem->sentinel1 == MEMHEADER_ARENA;
+}
+
+static inline void Mem_PoolAdd( mempool_t *pool, size_t size, qboolean arena )
 {
 	pool->totalsize += size;
-	pool->realsize += sizeof( memheader_t ) + size + sizeof( byte );
+
+	// arena chunks are counted as a whole
+	if( !arena )
+		pool->realsize += sizeof( memheader_t ) + size + sizeof( byte );
 }
 
-static inline void Mem_PoolSubtract( mempool_t *pool, size_t size )
+static inline void Mem_PoolSubtract( mempool_t *pool, size_t size, qboolean arena )
 {
 	pool->totalsize -= size;
-	pool->realsize -= sizeof( memheader_t ) + size + sizeof( byte );
+
+	if( !arena )
+		pool->realsize -= sizeof( memheader_t ) + size + sizeof( byte );
 }
 
 static inline void Mem_PoolLinkAlloc( mempool_t *pool, memheader_t *mem )
@@ -127,12 +260,12 @@ static inline void Mem_PoolUnlinkAlloc( mempool_t *pool, memheader_t *mem )
 	mem->poolptr = 0;
 }
 
-static inline void Mem_InitAlloc( memheader_t *mem, size_t size, const char *filename, int fileline )
+static inline void Mem_InitAlloc( memheader_t *mem, size_t size, qboolean arena, const char *filename, int fileline )
 {
 	mem->size = size;
 	mem->filename = filename;
 	mem->fileline = fileline;
-	mem->sentinel1 = MEMHEADER_SENTINEL1;
+	mem->sentinel1 = arena ? MEMHEADER_ARENA : MEMHEADER_SENTINEL1;
 	*((byte *)mem + sizeof( memheader_t ) + mem->size ) = MEMHEADER_SENTINEL2;
 }
 
@@ -153,7 +286,7 @@ static qboolean Mem_CheckAllocHeader( const char *func, const memheader_t *mem,
 {
 	const char *memfilename;
 
-	if( mem->sentinel1 != MEMHEADER_SENTINEL1 )
+	if( mem->sentinel1 != MEMHEADER_SENTINEL1 && mem->sentinel1 != MEMHEADER_ARENA )
 	{
 		memfilename = Mem_CheckFilename( mem->filename );
 		Sys_Error( "%s: trashed header sentinel 1 (alloc at %s:%i, check at %s:%i)\n", func, memfilename, mem->fileline, filename, fileline );
@@ -170,6 +303,305 @@ static qboolean Mem_CheckAllocHeader( const char *func, const memheader_t *mem,
 	return true;
 }
 
+/*
+========================
+Mem_ArenaAlloc
+
+bump allocate from current chunk, oversized allocations
+get their own chunk, so current chunk isn't wasted
+========================
+*/
+static memheader_t *Mem_ArenaAlloc( mempool_t *pool, size_t size, const char *filename, int fileline )
+{
+	const size_t need = ALIGN( sizeof( memheader_t ) + size + sizeof( byte ), MEMARENA_ALIGN );
+	memchunk_t *chunk = pool->chunks;
+
+	if( !chunk || chunk->used + need > chunk->size )
+	{
+		const qboolean oversized = need > pool->chunksize;
+		const size_t chunksize = oversized ? need : pool->chunksize;
+
+		chunk = (memchunk_t *)Q_malloc( MEMCHUNK_HEADER + chunksize );
+		if( chunk == NULL )
+		{
+			Sys_Error( "%s: out of memory (alloc size %s at %s:%i)\n", __func__, Q_memprint( size ), filename, fileline );
+			return NULL;
+		}
+
+		chunk->size = chunksize;
+		chunk->used = 0;
+
+		if( oversized && pool->chunks )
+		{
+			// keep bump allocating from current chunk
+			chunk->next = pool->chunks->next;
+			pool->chunks->next = chunk;
+		}
+		else
+		{
+			chunk->next = pool->chunks;
+			pool->chunks = chunk;
+		}
+
+		if( !oversized )
+			pool->chunksize = Q_min( pool->chunksize * 2, MEMARENA_MAX_CHUNK );
+
+		pool->realsize += MEMCHUNK_HEADER + chunksize;
+		pool->numchunks++;
+	}
+
+	chunk->used += need;
+
+	return (memheader_t *)((byte *)chunk + MEMCHUNK_HEADER + chunk->used - need );
+}
+
+/*
+========================
+Mem_ArenaFreeChunks
+
+release whole arena at once
+========================
+*/
+static void Mem_ArenaFreeChunks( mempool_t *pool )
+{
+	memchunk_t *chunk, *next;
+
+	for( chunk = pool->chunks; chunk; chunk = next )
+	{
+		next = chunk->next;
+		pool->realsize -= MEMCHUNK_HEADER + chunk->size;
+		Q_free( chunk );
+	}
+
+	pool->chunks = NULL;
+	pool->numchunks = 0;
+	pool->chunksize = MEMARENA_MIN_CHUNK;
+}
+
+/*
+========================
+Mem_ArenaResize
+
+resize arena allocation without moving, if possible,
+returns new size of allocation or zero if it must be moved
+========================
+*/
+static size_t Mem_ArenaResize( mempool_t *pool, memheader_t *mem, size_t size )
+{
+	const size_t oldneed = ALIGN( sizeof( memheader_t ) + mem->size + sizeof( byte ), MEMARENA_ALIGN );
+	const size_t need = ALIGN( sizeof( memheader_t ) + size + sizeof( byte ), MEMARENA_ALIGN );
+	const size_t minneed = ALIGN( sizeof( memheader_t ) + sizeof( byte ), MEMARENA_ALIGN );
+	memchunk_t *chunk = pool->chunks;
+	const qboolean last = chunk && (byte *)mem + oldneed == (byte *)chunk + MEMCHUNK_HEADER + chunk->used;
+
+	if( size < mem->size && !last )
+	{
+		memheader_t *tail;
+
+		// chunks are walked header by header, so the tail
+		// must stay behind as dead allocation until pool is freed
+		if( oldneed == need )
+			return size;
+
+		if( oldneed - need < minneed )
+			return mem->size; // too small to hold a header, keep it
+
+		tail = (memheader_t *)((byte *)mem + need );
+		Mem_InitAlloc( tail, oldneed - need - sizeof( memheader_t ) - sizeof( byte ), true, mem->filename, mem->fileline );
+		tail->next = tail->prev = NULL;
+		tail->poolptr = 0;
+		return size;
+	}
+
+	// only the last allocation in current chunk can grow
+	if( !last || chunk->used - oldneed + need > chunk->size )
+		return 0;
+
+	chunk->used = chunk->used - oldneed + need;
+	return size;
+}
+
+static inline qboolean Mem_IsSlabAlloc( const void *data )
+{
+	return ((const slabheader_t *)data - 1 )->sentinel1 == MEMHEADER_SLAB;
+}
+
+static int Mem_SlabClass( size_t size )
+{
+	int i;
+
+	for( i = 0; i < MEMSLAB_CLASSES; i++ )
+	{
+		if( sizeof( slabheader_t ) + size <= mem_slabsizes[i] )
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+========================
+Mem_SlabAlloc
+
+pop object from size class free list, carving new page if it's empty
+========================
+*/
+static void *Mem_SlabAlloc( mempool_t *pool, int sizeclass, const char *filename, int fileline )
+{
+	memslabs_t *slabs = pool->slabs;
+	slabheader_t *hdr;
+
+	if( !slabs->freelist[sizeclass] )
+	{
+		const size_t objsize = mem_slabsizes[sizeclass];
+		slabpage_t *page = (slabpage_t *)Q_malloc( MEMSLAB_PAGE );
+		byte *obj;
+
+		if( page == NULL )
+		{
+			Sys_Error( "%s: out of memory (alloc size %s at %s:%i)\n", __func__, Q_memprint( objsize ), filename, fileline );
+			return NULL;
+		}
+
+		page->next = slabs->pages;
+		slabs->pages = page;
+		slabs->numpages++;
+		pool->realsize += MEMSLAB_PAGE;
+
+		// push in reverse, so objects are handed out in address order
+		for( obj = (byte *)page + SLABPAGE_HEADER + (( MEMSLAB_PAGE - SLABPAGE_HEADER ) / objsize - 1 ) * objsize;
+			obj >= (byte *)page + SLABPAGE_HEADER; obj -= objsize )
+		{
+			hdr = (slabheader_t *)obj;
+			hdr->poolptr = 0;
+			hdr->sizeclass = sizeclass;
+			hdr->sentinel1 = MEMHEADER_SLAB;
+			*(slabheader_t **)( hdr + 1 ) = slabs->freelist[sizeclass];
+			slabs->freelist[sizeclass] = hdr;
+		}
+	}
+
+	hdr = slabs->freelist[sizeclass];
+	slabs->freelist[sizeclass] = *(slabheader_t **)( hdr + 1 );
+	slabs->used[sizeclass]++;
+
+	hdr->poolptr = Mem_PoolIndex( pool );
+	pool->totalsize += mem_slabsizes[sizeclass] - sizeof( slabheader_t );
+
+	return hdr + 1;
+}
+
+static void Mem_SlabFree( slabheader_t *hdr, const char *filename, int fileline )
+{
+	mempool_t *pool = Mem_FindPool( hdr->poolptr ); // errors on double free
+	memslabs_t *slabs;
+
+	if( !pool || !pool->slabs || hdr->sizeclass >= MEMSLAB_CLASSES )
+	{
+		Sys_Error( "%s: trashed slab header (free at %s:%i)\n", __func__, filename, fileline );
+		return;
+	}
+
+	slabs = pool->slabs;
+
+	hdr->poolptr = 0;
+	*(slabheader_t **)( hdr + 1 ) = slabs->freelist[hdr->sizeclass];
+	slabs->freelist[hdr->sizeclass] = hdr;
+	slabs->used[hdr->sizeclass]--;
+	pool->totalsize -= mem_slabsizes[hdr->sizeclass] - sizeof( slabheader_t );
+}
+
+static void Mem_SlabFreePages( mempool_t *pool )
+{
+	memslabs_t *slabs = pool->slabs;
+	slabpage_t *page, *next;
+	int i;
+
+	for( page = slabs->pages; page; page = next )
+	{
+		next = page->next;
+		Q_free( page );
+	}
+
+	for( i = 0; i < MEMSLAB_CLASSES; i++ )
+	{
+		pool->totalsize -= slabs->used[i] * ( mem_slabsizes[i] - sizeof( slabheader_t ));
+		slabs->freelist[i] = NULL;
+		slabs->used[i] = 0;
+	}
+
+	pool->realsize -= slabs->numpages * MEMSLAB_PAGE;
+	slabs->pages = NULL;
+	slabs->numpages = 0;
+}
+
+static qboolean Mem_ProfileInitSites( void )
+{
+	if( mem_profile.sites )
+		return true;
+
+	mem_profile.sites = (memsite_t *)Q_malloc( sizeof( *mem_profile.sites ) * MEMPROF_SITES );
+	if( !mem_profile.sites )
+		return false;
+
+	memset( mem_profile.sites, 0, sizeof( *mem_profile.sites ) * MEMPROF_SITES );
+	mem_profile.numsites = 0;
+	return true;
+}
+
+static memsite_t *Mem_ProfileSite( poolhandle_t poolptr, const char *filename, int fileline )
+{
+	uint hash = (uint)((uintptr_t)filename >> 2 ) * 2654435761U ^ (uint)fileline * 40503U ^ poolptr;
+	int i;
+
+	if( !Mem_ProfileInitSites( ))
+		return NULL;
+
+	// file names are compared by pointer, they come from __FILE__
+	for( i = 0; i < MEMPROF_SITES; i++ )
+	{
+		memsite_t *site = &mem_profile.sites[( hash + i ) & ( MEMPROF_SITES - 1 )];
+
+		if( site->filename == filename && site->fileline == fileline && site->poolptr == poolptr )
+			return site;
+
+		if( site->filename )
+			continue;
+
+		// keep table sparse, so probing is short
+		if( mem_profile.numsites >= MEMPROF_SITES / 4 * 3 )
+			break;
+
+		site->filename = filename;
+		site->fileline = fileline;
+		site->poolptr = poolptr;
+		mem_profile.numsites++;
+		return site;
+	}
+
+	return NULL;
+}
+
+static void Mem_ProfileCount( poolhandle_t poolptr, const char *filename, int fileline, size_t size, qboolean alloc )
+{
+	memsite_t *site;
+
+	mutex_lock( mem_profile.lock );
+
+	if(( site = Mem_ProfileSite( poolptr, filename, fileline )) != NULL )
+	{
+		if( alloc )
+		{
+			site->allocs++;
+			site->allocbytes += size;
+		}
+		else site->frees++;
+	}
+	else mem_profile.overflow++;
+
+	mutex_unlock( mem_profile.lock );
+}
+
 void *_Mem_Alloc( poolhandle_t poolptr, size_t size, qboolean clear, const char *filename, int fileline )
 {
 	memheader_t *mem;
@@ -188,17 +620,50 @@ void *_Mem_Alloc( poolhandle_t poolptr, size_t size, qboolean clear, const char
 	if( !pool )
 		return NULL;
 
-	mem = (memheader_t *)Q_malloc( sizeof( memheader_t ) + size + sizeof( byte ));
-	if( mem == NULL )
+	if( unlikely( mem_profile.active ))
+		Mem_ProfileCount( poolptr, filename, fileline, size, true );
+
+	if( pool->slabs )
 	{
-		Sys_Error( "%s: out of memory (alloc size %s at %s:%i)\n", __func__, Q_memprint( size ), filename, fileline );
-		return NULL;
+		int sizeclass = Mem_SlabClass( size );
+
+		if( sizeclass >= 0 )
+		{
+			void *data = Mem_SlabAlloc( pool, sizeclass, filename, fileline );
+
+			if( clear && data )
+				memset( data, 0, size );
+
+			return data;
+		}
 	}
 
-	Mem_InitAlloc( mem, size, filename, fileline );
+	if( pool->chunksize )
+	{
+		mem = Mem_ArenaAlloc( pool, size, filename, fileline );
+		if( mem == NULL )
+			return NULL;
+
+		// arena allocations aren't chained, they are released with chunks
+		Mem_InitAlloc( mem, size, true, filename, fileline );
+		Mem_PoolAdd( pool, size, true );
+		mem->next = mem->prev = NULL;
+		mem->poolptr = poolptr;
+	}
+	else
+	{
+		mem = (memheader_t *)Q_malloc( sizeof( memheader_t ) + size + sizeof( byte ));
+		if( mem == NULL )
+		{
+			Sys_Error( "%s: out of memory (alloc size %s at %s:%i)\n", __func__, Q_memprint( size ), filename, fileline );
+			return NULL;
+		}
 
-	Mem_PoolAdd( pool, size );
-	Mem_PoolLinkAlloc( pool, mem );
+		Mem_InitAlloc( mem, size, false, filename, fileline );
+
+		Mem_PoolAdd( pool, size, false );
+		Mem_PoolLinkAlloc( pool, mem );
+	}
 
 	if( clear )
 		memset((void *)((byte *)mem + sizeof( memheader_t )), 0, mem->size );
@@ -217,6 +682,47 @@ static void Mem_FreeBlock( memheader_t *mem, const char *filename, int fileline
 	if( !pool )
 		return;
 
+	if( unlikely( mem_profile.active ))
+		Mem_ProfileCount( mem->poolptr, mem->filename, mem->fileline, mem->size, false );
+
+	if( Mem_IsArenaAlloc( mem ))
+	{
+		const size_t need = ALIGN( sizeof( memheader_t ) + mem->size + sizeof( byte ), MEMARENA_ALIGN );
+		memchunk_t *chunk = pool->chunks, **prev;
+
+		// last allocation in current chunk can be reused right away,
+		// which makes short lived temporary buffers free,
+		// large temporary buffers have own chunk that is released,
+		// everything else is reclaimed with the whole arena
+		if( chunk && (byte *)mem + need == (byte *)chunk + MEMCHUNK_HEADER + chunk->used )
+		{
+			chunk->used -= need;
+		}
+		else if( need > MEMARENA_MIN_CHUNK )
+		{
+			for( prev = &pool->chunks; ( chunk = *prev ) != NULL; prev = &chunk->next )
+			{
+				if( (byte *)mem != (byte *)chunk + MEMCHUNK_HEADER )
+					continue;
+
+				if( chunk->used == need )
+				{
+					*prev = chunk->next;
+					pool->realsize -= MEMCHUNK_HEADER + chunk->size;
+					pool->numchunks--;
+					Mem_PoolSubtract( pool, mem->size, true );
+					Q_free( chunk );
+					return;
+				}
+				break;
+			}
+		}
+
+		Mem_PoolSubtract( pool, mem->size, true );
+		mem->poolptr = 0;
+		return;
+	}
+
 	// unlink memheader from doubly linked list
 	if(( mem->prev ? mem->prev->next != mem : pool->chain != mem ) || ( mem->next && mem->next->prev != mem ))
 	{
@@ -224,7 +730,7 @@ static void Mem_FreeBlock( memheader_t *mem, const char *filename, int fileline
 		return;
 	}
 
-	Mem_PoolSubtract( pool, mem->size );
+	Mem_PoolSubtract( pool, mem->size, false );
 	Mem_PoolUnlinkAlloc( pool, mem );
 
 	Q_free( mem );
@@ -235,6 +741,12 @@ void _Mem_Free( void *data, const char *filename, int fileline )
 	if( data == NULL )
 		return;
 
+	if( Mem_IsSlabAlloc( data ))
+	{
+		Mem_SlabFree((slabheader_t *)data - 1, filename, fileline );
+		return;
+	}
+
 	Mem_FreeBlock((memheader_t *)((byte *)data - sizeof( memheader_t )), filename, fileline );
 }
 
@@ -247,10 +759,10 @@ static void Mem_MigratePool( poolhandle_t newpoolptr, memheader_t *mem, const ch
 	// might be made into public function at some point
 
 	Mem_PoolUnlinkAlloc( oldpool, mem );
-	Mem_PoolSubtract( oldpool, mem->size );
+	Mem_PoolSubtract( oldpool, mem->size, false );
 
 	Mem_PoolLinkAlloc( newpool, mem );
-	Mem_PoolAdd( newpool, mem->size );
+	Mem_PoolAdd( newpool, mem->size, false );
 }
 
 void *_Mem_Realloc( poolhandle_t poolptr, void *data, size_t size, qboolean clear, const char *filename, int fileline )
@@ -258,7 +770,7 @@ void *_Mem_Realloc( poolhandle_t poolptr, void *data, size_t size, qboolean clea
 	memheader_t *mem;
 	uintptr_t oldmem;
 	mempool_t *pool;
-	size_t oldsize;
+	size_t oldsize, newsize;
 
 	if( size <= 0 )
 		return data; // no need to reallocate
@@ -272,11 +784,89 @@ void *_Mem_Realloc( poolhandle_t poolptr, void *data, size_t size, qboolean clea
 	if( !data )
 		return _Mem_Alloc( poolptr, size, clear, filename, fileline );
 
+	if( Mem_IsSlabAlloc( data ))
+	{
+		const slabheader_t *hdr = (slabheader_t *)data - 1;
+		const size_t capacity = mem_slabsizes[hdr->sizeclass] - sizeof( slabheader_t );
+		void *newdata;
+
+		// still fits into the object
+		if( hdr->poolptr == poolptr && size <= capacity )
+			return data;
+
+		newdata = _Mem_Alloc( poolptr, size, false, filename, fileline );
+		memcpy( newdata, data, Q_min( size, capacity ));
+
+		if( clear && size > capacity )
+			memset((byte *)newdata + capacity, 0, size - capacity );
+
+		_Mem_Free( data, filename, fileline );
+
+		return newdata;
+	}
+
 	mem = (memheader_t *)((byte *)data - sizeof( memheader_t ));
 
 	if( !Mem_CheckAllocHeader( __func__, mem, filename, fileline ))
 		return NULL;
 
+	if( Mem_IsArenaAlloc( mem ))
+	{
+		void *newdata;
+
+		oldsize = mem->size;
+		pool = Mem_FindPool( mem->poolptr );
+
+		if( mem->poolptr == poolptr && ( newsize = Mem_ArenaResize( pool, mem, size )) != 0 )
+		{
+			if( unlikely( mem_profile.active ))
+			{
+				Mem_ProfileCount( poolptr, mem->filename, mem->fileline, oldsize, false );
+				Mem_ProfileCount( poolptr, filename, fileline, size, true );
+			}
+
+			Mem_InitAlloc( mem, newsize, true, filename, fileline );
+
+			if( newsize > oldsize )
+			{
+				Mem_PoolAdd( pool, newsize - oldsize, true );
+
+				if( clear )
+					memset((byte *)data + oldsize, 0, newsize - oldsize );
+			}
+			else Mem_PoolSubtract( pool, oldsize - newsize, true );
+
+			return data;
+		}
+
+		// move growing allocation to the heap, so it doesn't
+		// leave a dead copy in the arena on each resize
+		pool = Mem_FindPool( poolptr );
+		mem = (memheader_t *)Q_malloc( sizeof( memheader_t ) + size + sizeof( byte ));
+		if( mem == NULL )
+		{
+			Sys_Error( "%s: out of memory (alloc size %s at %s:%i)\n", __func__, Q_memprint( size ), filename, fileline );
+			return NULL;
+		}
+
+		if( unlikely( mem_profile.active ))
+			Mem_ProfileCount( poolptr, filename, fileline, size, true );
+
+		Mem_InitAlloc( mem, size, false, filename, fileline );
+		Mem_PoolAdd( pool, size, false );
+		Mem_PoolLinkAlloc( pool, mem );
+
+		newdata = (byte *)mem + sizeof( memheader_t );
+		memcpy( newdata, data, Q_min( size, oldsize ));
+
+		if( clear && size > oldsize )
+			memset((byte *)newdata + oldsize, 0, size - oldsize );
+
+		_Mem_Free( data, filename, fileline );
+
+		return newdata;
+	}
+
 	// migrate pool if requested, even if no reallocation needed
 	if( mem->poolptr != poolptr )
 		Mem_MigratePool( poolptr, mem, filename, fileline );
@@ -287,6 +877,13 @@ void *_Mem_Realloc( poolhandle_t poolptr, void *data, size_t size, qboolean clea
 
 	pool = Mem_FindPool( poolptr );
 
+	// old block is gone even if realloc didn't move it
+	if( unlikely( mem_profile.active ))
+	{
+		Mem_ProfileCount( poolptr, mem->filename, mem->fileline, oldsize, false );
+		Mem_ProfileCount( poolptr, filename, fileline, size, true );
+	}
+
 	oldmem = (uintptr_t)mem;
 	mem = Q_realloc( mem, sizeof( memheader_t ) + size + sizeof( byte ));
 
@@ -299,16 +896,16 @@ void *_Mem_Realloc( poolhandle_t poolptr, void *data, size_t size, qboolean clea
 	// Con_Printf( S_NOTE "%s: mem %s oldmem, size before %zu now %zu (alloc at %s:%i)\n",
 	// __func__, (uintptr_t)mem != oldmem ? "!=" : "==", oldsize, size, filename, fileline );
 
-	Mem_InitAlloc( mem, size, filename, fileline );
+	Mem_InitAlloc( mem, size, false, filename, fileline );
 
 	if( size > oldsize )
 	{
-		Mem_PoolAdd( pool, size - oldsize );
+		Mem_PoolAdd( pool, size - oldsize, false );
 
 		if( clear )
 			memset((byte *)mem + sizeof( memheader_t ) + oldsize, 0, size - oldsize );
 	}
-	else Mem_PoolSubtract( pool, oldsize - size );
+	else Mem_PoolSubtract( pool, oldsize - size, false );
 
 	if( oldmem != (uintptr_t)mem ) // just relink pointers
 	{
@@ -356,6 +953,51 @@ poolhandle_t _Mem_AllocPool( const char *name, const char *filename, int filelin
 	return Mem_InitPool( pool, name, filename, fileline );
 }
 
+/*
+========================
+_Mem_AllocPoolExt
+
+MEMPOOL_ARENA is for data that lives until the pool is freed or emptied,
+allocations are bump allocated from large chunks and Mem_Free only
+updates pool statistics
+
+MEMPOOL_SLAB serves small allocations from per size class free lists
+without malloc calls and with short header
+
+like any other pool, these must be used from the main thread only,
+poolchain is reallocated when pools are created, so even looking
+up a pool isn't safe while another thread creates one
+========================
+*/
+poolhandle_t _Mem_AllocPoolExt( const char *name, int flags, const char *filename, int fileline )
+{
+	poolhandle_t poolptr = _Mem_AllocPool( name, filename, fileline );
+	mempool_t *pool;
+
+	if( !poolptr )
+		return 0;
+
+	pool = Mem_FindPool( poolptr );
+
+	if( FBitSet( flags, MEMPOOL_ARENA ))
+		pool->chunksize = MEMARENA_MIN_CHUNK;
+
+	if( FBitSet( flags, MEMPOOL_SLAB ))
+	{
+		pool->slabs = (memslabs_t *)Q_malloc( sizeof( *pool->slabs ));
+		if( pool->slabs == NULL )
+		{
+			Sys_Error( "%s: out of memory (allocpool at %s:%i)\n", __func__, filename, fileline );
+			return 0;
+		}
+
+		memset( pool->slabs, 0, sizeof( *pool->slabs ));
+		pool->realsize += sizeof( *pool->slabs );
+	}
+
+	return poolptr;
+}
+
 void _Mem_FreePool( poolhandle_t *poolptr, const char *filename, int fileline )
 {
 	mempool_t	*pool;
@@ -373,6 +1015,14 @@ void _Mem_FreePool( poolhandle_t *poolptr, const char *filename, int fileline )
 		while( pool->chain )
 			Mem_FreeBlock( pool->chain, filename, fileline );
 
+		Mem_ArenaFreeChunks( pool );
+
+		if( pool->slabs )
+		{
+			Mem_SlabFreePages( pool );
+			Q_free( pool->slabs );
+		}
+
 		// free the pool itself
 		memset( pool, 0xBF, sizeof( mempool_t ));
 		pool->chain = NULL;
@@ -396,6 +1046,15 @@ void _Mem_EmptyPool( poolhandle_t poolptr, const char *filename, int fileline )
 
 	// free memory owned by the pool
 	while( pool->chain ) Mem_FreeBlock( pool->chain, filename, fileline );
+
+	if( pool->chunksize )
+	{
+		Mem_ArenaFreeChunks( pool );
+		pool->totalsize = 0;
+	}
+
+	if( pool->slabs )
+		Mem_SlabFreePages( pool );
 }
 
 static qboolean Mem_CheckAlloc( mempool_t *pool, void *data )
@@ -405,12 +1064,32 @@ static qboolean Mem_CheckAlloc( mempool_t *pool, void *data )
 	if( pool )
 	{
 		// search only one pool
+		memchunk_t *chunk;
+		slabpage_t *page;
+
+		if( pool->slabs )
+		{
+			for( page = pool->slabs->pages; page; page = page->next )
+			{
+				if( (byte *)data > (byte *)page && (byte *)data < (byte *)page + MEMSLAB_PAGE )
+					return Mem_IsSlabAlloc( data ) && ((slabheader_t *)data - 1 )->poolptr != 0;
+			}
+		}
+
 		target = (memheader_t *)((byte *)data - sizeof( memheader_t ));
 		for( header = pool->chain; header; header = header->next )
 		{
 			if( header == target )
 				return true;
 		}
+
+		for( chunk = pool->chunks; chunk; chunk = chunk->next )
+		{
+			const byte *start = (byte *)chunk + MEMCHUNK_HEADER;
+
+			if( (byte *)target >= start && (byte *)target < start + chunk->used )
+				return target->poolptr != 0; // not freed
+		}
 	}
 	else
 	{
@@ -454,6 +1133,8 @@ void _Mem_Check( const char *filename, int fileline )
 void Mem_PrintStats( void )
 {
 	size_t    count = 0, size = 0, realsize = 0, i;
+	size_t    arenas = 0, chunks = 0, arenasize = 0;
+	size_t    slabpools = 0, pages = 0;
 	mempool_t *pool;
 
 	Mem_Check();
@@ -465,10 +1146,27 @@ void Mem_PrintStats( void )
 		count++;
 		size += pool->totalsize;
 		realsize += pool->realsize;
+
+		if( pool->chunksize )
+		{
+			arenas++;
+			chunks += pool->numchunks;
+			arenasize += pool->realsize;
+		}
+
+		if( pool->slabs )
+		{
+			slabpools++;
+			pages += pool->slabs->numpages;
+		}
 	}
 
 	Con_Printf( "^3%zu^7 memory pools, totalling: ^1%s\n", count, Q_memprint( size ));
 	Con_Printf( "total allocated size: ^1%s\n", Q_memprint( realsize ));
+	if( arenas )
+		Con_Printf( "^3%zu^7 arena pools in ^3%zu^7 chunks: ^1%s\n", arenas, chunks, Q_memprint( arenasize ));
+	if( slabpools )
+		Con_Printf( "^3%zu^7 slab pools in ^3%zu^7 pages: ^1%s\n", slabpools, pages, Q_memprint( pages * MEMSLAB_PAGE ));
 }
 
 void Mem_PrintList( size_t minallocationsize )
@@ -502,6 +1200,21 @@ void Mem_PrintList( size_t minallocationsize )
 		}
 
 		pool->lastchecksize = pool->totalsize;
+
+		if( pool->chunksize )
+			Con_Printf( "%10s in %zu arena chunks\n", Q_memprint( pool->realsize ), pool->numchunks );
+
+		if( pool->slabs )
+		{
+			size_t j;
+
+			for( j = 0; j < MEMSLAB_CLASSES; j++ )
+			{
+				if( pool->slabs->used[j] )
+					Con_Printf( "%10zu slab objects of %i bytes\n", pool->slabs->used[j], mem_slabsizes[j] );
+			}
+		}
+
 		for( mem = pool->chain; mem; mem = mem->next )
 		{
 			if( mem->size >= minallocationsize )
@@ -510,6 +1223,362 @@ void Mem_PrintList( size_t minallocationsize )
 	}
 }
 
+/*
+========================
+Mem_ProfileWalk
+
+attribute live memory of all pools to call sites
+========================
+*/
+static void Mem_ProfileWalk( void )
+{
+	mempool_t *pool;
+	memchunk_t *chunk;
+	memheader_t *mem;
+	memsite_t *site;
+	size_t i;
+	int j;
+
+	if( !Mem_ProfileInitSites( ))
+		return;
+
+	for( j = 0; j < MEMPROF_SITES; j++ )
+	{
+		mem_profile.sites[j].live = 0;
+		mem_profile.sites[j].livecount = 0;
+	}
+
+	for( i = 0, pool = poolchain; i < poolcount; i++, pool++ )
+	{
+		size_t chained = 0;
+
+		if( !pool->filename )
+			continue;
+
+		for( mem = pool->chain; mem; mem = mem->next )
+		{
+			chained += mem->size;
+
+			if(( site = Mem_ProfileSite( Mem_PoolIndex( pool ), mem->filename, mem->fileline )) != NULL )
+			{
+				site->live += mem->size;
+				site->livecount++;
+			}
+		}
+
+		// arena allocations aren't chained, but lie one after another in chunks
+		for( chunk = pool->chunks; chunk; chunk = chunk->next )
+		{
+			byte *ptr = (byte *)chunk + MEMCHUNK_HEADER;
+			byte *end = ptr + chunk->used;
+
+			for( ; ptr < end; ptr += ALIGN( sizeof( memheader_t ) + mem->size + sizeof( byte ), MEMARENA_ALIGN ))
+			{
+				mem = (memheader_t *)ptr;
+
+				if( !mem->poolptr )
+					continue; // freed
+
+				chained += mem->size;
+
+				if(( site = Mem_ProfileSite( Mem_PoolIndex( pool ), mem->filename, mem->fileline )) != NULL )
+				{
+					site->live += mem->size;
+					site->livecount++;
+				}
+			}
+		}
+
+		// slab allocations don't remember their call site
+		if( pool->totalsize > chained )
+		{
+			site = Mem_ProfileSite( Mem_PoolIndex( pool ), mem_slabsite, 0 );
+
+			if( site )
+			{
+				site->live += pool->totalsize - chained;
+				site->livecount++;
+			}
+		}
+	}
+}
+
+static const char *Mem_ProfilePoolName( poolhandle_t poolptr )
+{
+	if( poolptr > 0 && poolptr <= poolcount && poolchain[poolptr - 1].filename )
+		return poolchain[poolptr - 1].name;
+
+	return "(freed pool)";
+}
+
+static const memsnap_t *Mem_ProfileSnap( int i )
+{
+	static const memsnap_t empty;
+
+	return mem_profile.snapshot ? &mem_profile.snapshot[i] : &empty;
+}
+
+static size_t Mem_ProfileDelta( const memsite_t *sites, int i, qboolean *negative )
+{
+	const size_t live = sites[i].live, prev = Mem_ProfileSnap( i )->live;
+
+	*negative = live < prev;
+	return live < prev ? prev - live : live - prev;
+}
+
+static const memsite_t *mem_sortsites;
+static qboolean mem_sortbydelta;
+
+static int Mem_ProfileCompare( const void *a, const void *b )
+{
+	const int ia = *(const int *)a, ib = *(const int *)b;
+	qboolean negative;
+	size_t ka, kb;
+
+	if( mem_sortbydelta )
+	{
+		ka = Mem_ProfileDelta( mem_sortsites, ia, &negative );
+		kb = Mem_ProfileDelta( mem_sortsites, ib, &negative );
+	}
+	else
+	{
+		ka = mem_sortsites[ia].live;
+		kb = mem_sortsites[ib].live;
+	}
+
+	if( ka != kb )
+		return ka > kb ? -1 : 1;
+
+	// churn is next important thing
+	ka = mem_sortsites[ia].allocs;
+	kb = mem_sortsites[ib].allocs;
+
+	return ka > kb ? -1 : ka < kb ? 1 : 0;
+}
+
+/*
+========================
+Mem_ProfileCopySites
+
+walk the pools and return a copy of the site table, so it can be
+printed without the lock, output may allocate and then count
+the allocation under the same lock
+========================
+*/
+static memsite_t *Mem_ProfileCopySites( size_t *overflow )
+{
+	memsite_t *sites = NULL;
+
+	mutex_lock( mem_profile.lock );
+	Mem_ProfileWalk();
+
+	if( mem_profile.sites && ( sites = (memsite_t *)Q_malloc( sizeof( *sites ) * MEMPROF_SITES )) != NULL )
+		memcpy( sites, mem_profile.sites, sizeof( *sites ) * MEMPROF_SITES );
+
+	*overflow = mem_profile.overflow;
+	mutex_unlock( mem_profile.lock );
+
+	return sites;
+}
+
+/*
+========================
+Mem_ProfileStart
+
+start counting allocations and frees by call site
+========================
+*/
+void Mem_ProfileStart( void )
+{
+	int i;
+
+	mutex_lock( mem_profile.lock );
+
+	if( mem_profile.sites )
+	{
+		for( i = 0; i < MEMPROF_SITES; i++ )
+		{
+			mem_profile.sites[i].allocs = 0;
+			mem_profile.sites[i].frees = 0;
+			mem_profile.sites[i].allocbytes = 0;
+		}
+	}
+
+	if( mem_profile.snapshot )
+	{
+		Q_free( mem_profile.snapshot );
+		mem_profile.snapshot = NULL;
+	}
+
+	mem_profile.overflow = 0;
+	mem_profile.starttime = Sys_DoubleTime();
+	mem_profile.active = true;
+
+	mutex_unlock( mem_profile.lock );
+}
+
+void Mem_ProfileStop( void )
+{
+	mem_profile.active = false;
+}
+
+/*
+========================
+Mem_ProfileSnapshot
+
+remember live memory and counters, so later report can be compared with it
+========================
+*/
+void Mem_ProfileSnapshot( void )
+{
+	int i;
+
+	mutex_lock( mem_profile.lock );
+	Mem_ProfileWalk();
+
+	if( mem_profile.sites )
+	{
+		if( !mem_profile.snapshot )
+			mem_profile.snapshot = (memsnap_t *)Q_malloc( sizeof( *mem_profile.snapshot ) * MEMPROF_SITES );
+
+		for( i = 0; mem_profile.snapshot && i < MEMPROF_SITES; i++ )
+		{
+			mem_profile.snapshot[i].allocs = mem_profile.sites[i].allocs;
+			mem_profile.snapshot[i].frees = mem_profile.sites[i].frees;
+			mem_profile.snapshot[i].live = mem_profile.sites[i].live;
+			mem_profile.snapshot[i].livecount = mem_profile.sites[i].livecount;
+		}
+
+		mem_profile.snaptime = Sys_DoubleTime();
+	}
+
+	mutex_unlock( mem_profile.lock );
+}
+
+/*
+========================
+Mem_ProfilePrint
+
+print call sites with most live memory, or with largest
+change since snapshot, allocation rate is shown while profiler runs
+========================
+*/
+void Mem_ProfilePrint( int count, qboolean diff )
+{
+	double elapsed;
+	size_t total = 0, overflow;
+	memsite_t *sites;
+	int *order, num = 0, i;
+
+	if(( sites = Mem_ProfileCopySites( &overflow )) == NULL )
+		return;
+
+	if(( order = (int *)Q_malloc( sizeof( *order ) * MEMPROF_SITES )) == NULL )
+	{
+		Q_free( sites );
+		return;
+	}
+
+	if( diff && !mem_profile.snapshot )
+	{
+		Con_Printf( "no snapshot to compare with\n" );
+		diff = false;
+	}
+
+	for( i = 0; i < MEMPROF_SITES; i++ )
+	{
+		const memsite_t *site = &sites[i];
+		const memsnap_t *snap = Mem_ProfileSnap( i );
+
+		if( !site->filename )
+			continue;
+
+		if( diff ? ( site->live == snap->live && site->allocs == snap->allocs ) : ( !site->live && !site->allocs ))
+			continue;
+
+		total += site->live;
+		order[num++] = i;
+	}
+
+	mem_sortsites = sites;
+	mem_sortbydelta = diff;
+	qsort( order, num, sizeof( *order ), Mem_ProfileCompare );
+
+	elapsed = Sys_DoubleTime() - ( diff ? mem_profile.snaptime : mem_profile.starttime );
+	elapsed = Q_max( elapsed, 0.001 );
+
+	Con_Printf( "\t^3live\t\tblocks\t%s\tallocs/s  frees/s   site\n", diff ? "change\t" : "" );
+
+	for( i = 0; i < num && i < count; i++ )
+	{
+		const memsite_t *site = &sites[order[i]];
+		const memsnap_t *snap = Mem_ProfileSnap( order[i] );
+		qboolean negative;
+		const size_t delta = Mem_ProfileDelta( sites, order[i], &negative );
+		double allocs = 0.0, frees = 0.0;
+		string change = "";
+
+		if( mem_profile.active || diff )
+		{
+			allocs = ( site->allocs - ( diff ? snap->allocs : 0 )) / elapsed;
+			frees = ( site->frees - ( diff ? snap->frees : 0 )) / elapsed;
+		}
+
+		if( diff )
+			Q_snprintf( change, sizeof( change ), "%c%s\t", negative ? '-' : '+', Q_memprint( delta ));
+
+		Con_Printf( "%10s %8zu\t%s%9.1f %9.1f   %s:%i (%s)\n", Q_memprint( site->live ), site->livecount, change,
+			allocs, frees, site->filename, site->fileline, Mem_ProfilePoolName( site->poolptr ));
+	}
+
+	Con_Printf( "^3%i^7 sites, ^1%s^7 live%s\n", num, Q_memprint( total ), mem_profile.active ? ", profiler is running" : "" );
+
+	if( overflow )
+		Con_Printf( S_WARN "%zu allocations weren't counted, too many call sites\n", overflow );
+
+	Q_free( order );
+	Q_free( sites );
+}
+
+/*
+========================
+Mem_ProfileDump
+
+write live memory in folded stacks format, as expected by flamegraph.pl,
+stack is pool, source file and call site
+========================
+*/
+void Mem_ProfileDump( file_t *f )
+{
+	size_t overflow;
+	memsite_t *sites;
+	int i;
+
+	if(( sites = Mem_ProfileCopySites( &overflow )) == NULL )
+		return;
+
+	for( i = 0; i < MEMPROF_SITES; i++ )
+	{
+		const memsite_t *site = &sites[i];
+		char poolname[64], *p;
+
+		if( !site->filename || !site->live )
+			continue;
+
+		// semicolon separates frames
+		Q_strncpy( poolname, Mem_ProfilePoolName( site->poolptr ), sizeof( poolname ));
+		for( p = poolname; *p; p++ )
+		{
+			if( *p == ';' )
+				*p = '_';
+		}
+
+		FS_Printf( f, "%s;%s;%s:%i %zu\n", poolname, site->filename, site->filename, site->fileline, site->live );
+	}
+
+	Q_free( sites );
+}
+
 /*
 ========================
 Memory_Init
@@ -523,4 +1592,234 @@ void Memory_Init( void )
 	}
 	poolchain = NULL; // init mem chain
 	poolcount = 0;
+
+	if( !mem_profile.initialized )
+	{
+		mutex_create( mem_profile.lock );
+		mem_profile.initialized = true;
+	}
+}
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+#include "eiface.h" // ARRAYSIZE
+
+static void Test_ArenaPool( void )
+{
+	poolhandle_t arena = Mem_AllocPoolExt( "arena test", MEMPOOL_ARENA );
+	mempool_t *pool = Mem_FindPool( arena );
+	byte *a, *b, *c, *big;
+	uintptr_t old;
+	size_t realsize;
+	int i;
+
+	a = Mem_Calloc( arena, 100 );
+	b = Mem_Malloc( arena, 100 );
+	TASSERT( a && b && a != b );
+	TASSERT_EQi( pool->totalsize, 200 );
+	TASSERT_EQi( pool->numchunks, 1 );
+	TASSERT( Mem_IsAllocatedExt( arena, a ));
+	TASSERT_EQi( a[99], 0 );
+
+	// last allocation grows in place
+	memset( b, 0x55, 100 );
+	c = Mem_Realloc( arena, b, 200 );
+	TASSERT_EQp( b, c );
+	TASSERT_EQi( c[99], 0x55 );
+	TASSERT_EQi( c[100], 0 );
+
+	// other allocations are moved to the heap
+	old = (uintptr_t)a;
+	b = Mem_Realloc( arena, a, 300 );
+	TASSERT( (uintptr_t)b != old );
+	TASSERT( !Mem_IsAllocatedExt( arena, (void *)old ));
+	TASSERT( Mem_IsAllocatedExt( arena, b ));
+	TASSERT_EQi( pool->totalsize, 500 );
+
+	// temporary buffers are reused
+	a = Mem_Malloc( arena, 64 );
+	old = (uintptr_t)a;
+	Mem_Free( a );
+	a = Mem_Malloc( arena, 64 );
+	TASSERT( (uintptr_t)a == old );
+
+	// large temporary buffers get own chunk, which is released
+	realsize = pool->realsize;
+	big = Mem_Malloc( arena, MEMARENA_MAX_CHUNK * 2 );
+	a = Mem_Malloc( arena, 16 );
+	Mem_Free( big );
+	TASSERT_EQi( pool->numchunks, 1 );
+	TASSERT_EQi( pool->realsize, realsize );
+	TASSERT( Mem_IsAllocatedExt( arena, a ));
+
+	// chunks grow, so many small allocations don't need many chunks
+	for( i = 0; i < 10000; i++ )
+	{
+		if( !( c = Mem_Malloc( arena, 100 )))
+			break;
+	}
+	TASSERT_EQi( i, 10000 );
+	TASSERT( pool->numchunks < 16 );
+
+	Mem_EmptyPool( arena );
+	TASSERT_EQi( pool->totalsize, 0 );
+	TASSERT_EQi( pool->numchunks, 0 );
+	TASSERT( pool->chain == NULL );
+
+	a = Mem_Malloc( arena, 100 );
+	TASSERT( Mem_IsAllocatedExt( arena, a ));
+
+	Mem_FreePool( &arena );
+	TASSERT_EQi( arena, 0 );
+}
+
+static void Test_SlabPool( void )
+{
+	poolhandle_t slab = Mem_AllocPoolExt( "slab test", MEMPOOL_SLAB );
+	mempool_t *pool = Mem_FindPool( slab );
+	byte *a, *b, *c, *big;
+	byte *objs[1000];
+	uintptr_t old;
+	int i;
+
+	a = Mem_Calloc( slab, 20 );
+	b = Mem_Malloc( slab, 20 );
+	TASSERT( a && b && a != b );
+	TASSERT( Mem_IsSlabAlloc( a ) && Mem_IsSlabAlloc( b ));
+	TASSERT_EQi( pool->slabs->numpages, 1 );
+	TASSERT_EQi( pool->totalsize, 48 ); // two 32 byte objects
+	TASSERT( Mem_IsAllocatedExt( slab, a ));
+	TASSERT_EQi( a[19], 0 );
+
+	// freed object is reused first
+	old = (uintptr_t)a;
+	Mem_Free( a );
+	TASSERT_EQi( pool->slabs->used[Mem_SlabClass( 20 )], 1 );
+	a = Mem_Malloc( slab, 24 );
+	TASSERT( (uintptr_t)a == old );
+
+	// realloc keeps the object while it fits and moves otherwise
+	memset( b, 0x55, 20 );
+	old = (uintptr_t)b;
+	b = Mem_Realloc( slab, b, 24 );
+	TASSERT( (uintptr_t)b == old );
+	c = Mem_Realloc( slab, b, 200 );
+	TASSERT( (uintptr_t)c != old && Mem_IsSlabAlloc( c ));
+	TASSERT_EQi( c[19], 0x55 );
+	TASSERT_EQi( c[199], 0 );
+	TASSERT( !Mem_IsAllocatedExt( slab, (void *)old ));
+
+	// large allocations use regular headers
+	big = Mem_Malloc( slab, 4096 );
+	TASSERT( !Mem_IsSlabAlloc( big ));
+	TASSERT( Mem_IsAllocatedExt( slab, big ));
+	c = Mem_Realloc( slab, c, 8192 );
+	TASSERT( !Mem_IsSlabAlloc( c ));
+	TASSERT_EQi( c[19], 0x55 );
+
+	for( i = 0; i < ARRAYSIZE( objs ); i++ )
+		objs[i] = Mem_Malloc( slab, 100 );
+	for( i = 0; i < ARRAYSIZE( objs ); i++ )
+		Mem_Free( objs[i] );
+	TASSERT_EQi( pool->slabs->used[Mem_SlabClass( 100 )], 0 );
+
+	Mem_EmptyPool( slab );
+	TASSERT_EQi( pool->totalsize, 0 );
+	TASSERT_EQi( pool->slabs->numpages, 0 );
+	TASSERT( pool->chain == NULL );
+
+	a = Mem_Malloc( slab, 8 );
+	TASSERT( Mem_IsAllocatedExt( slab, a ));
+
+	Mem_FreePool( &slab );
+	TASSERT_EQi( slab, 0 );
+}
+
+static void Test_Profile( void )
+{
+	poolhandle_t pool = Mem_AllocPool( "profile test" );
+	const int line = 12345; // fake call site
+	memsite_t *site;
+	void *a, *b;
+
+	Mem_ProfileStart();
+	a = _Mem_Alloc( pool, 100, false, __FILE__, line );
+	b = _Mem_Alloc( pool, 200, false, __FILE__, line );
+	Mem_Free( a );
+	Mem_ProfileStop();
+
+	site = Mem_ProfileSite( pool, __FILE__, line );
+	TASSERT( site != NULL );
+	TASSERT_EQi( site->allocs, 2 );
+	TASSERT_EQi( site->frees, 1 );
+	TASSERT_EQi( site->allocbytes, 300 );
+
+	Mem_ProfileSnapshot();
+	TASSERT_EQi( site->live, 200 );
+	TASSERT_EQi( site->livecount, 1 );
+
+	// not counted anymore
+	a = _Mem_Alloc( pool, 50, false, __FILE__, line );
+	TASSERT_EQi( site->allocs, 2 );
+
+	Mem_ProfileWalk();
+	TASSERT_EQi( site->live, 250 );
+	TASSERT_EQi( mem_profile.snapshot[site - mem_profile.sites].live, 200 );
+
+	// realloc counts as free of old block and alloc of new one
+	Mem_ProfileStart();
+	b = _Mem_Realloc( pool, b, 400, false, __FILE__, line + 1 );
+	Mem_ProfileStop();
+	TASSERT_EQi( site->frees, 1 );
+	site = Mem_ProfileSite( pool, __FILE__, line + 1 );
+	TASSERT( site != NULL );
+	TASSERT_EQi( site->allocs, 1 );
+
+	Mem_Free( a );
+	Mem_Free( b );
+	Mem_FreePool( &pool );
+}
+
+static void Test_ProfileArena( void )
+{
+	poolhandle_t pool = Mem_AllocPoolExt( "profile arena test", MEMPOOL_ARENA );
+	const int line = 23456; // fake call sites
+	memsite_t *site1, *site2;
+	void *a, *b, *c, *d;
+
+	a = _Mem_Alloc( pool, 100, false, __FILE__, line );
+	b = _Mem_Alloc( pool, 200, false, __FILE__, line + 1 );
+	c = _Mem_Alloc( pool, 300, false, __FILE__, line );
+	d = _Mem_Alloc( pool, 50, false, __FILE__, line + 1 );
+	Mem_Free( b ); // leaves dead block in the middle
+	c = _Mem_Realloc( pool, c, 40, false, __FILE__, line ); // leaves dead tail
+
+	Mem_ProfileWalk();
+	site1 = Mem_ProfileSite( pool, __FILE__, line );
+	site2 = Mem_ProfileSite( pool, __FILE__, line + 1 );
+	TASSERT( site1 != NULL && site2 != NULL );
+	TASSERT_EQi( site1->live, 140 );
+	TASSERT_EQi( site1->livecount, 2 );
+	TASSERT_EQi( site2->live, 50 );
+	TASSERT_EQi( site2->livecount, 1 );
+
+	// shrinking in place keeps arena walkable
+	a = _Mem_Realloc( pool, a, 10, false, __FILE__, line );
+	Mem_ProfileWalk();
+	TASSERT_EQi( site1->live, 50 );
+	TASSERT_EQi( site2->live, 50 );
+
+	Mem_Free( a );
+	Mem_Free( c );
+	Mem_Free( d );
+	Mem_FreePool( &pool );
+}
+
+void Test_RunZone( void )
+{
+	TRUN( Test_ArenaPool() );
+	TRUN( Test_SlabPool() );
+	TRUN( Test_Profile() );
+	TRUN( Test_ProfileArena() );
 }
+#endif // XASH_ENGINE_TESTS
@@ -194,6 +194,37 @@ static inline qboolean Platform_NanoSleep( int nsec )
 #endif
 }
 
+/*
+==================
+Platform_SleepUntil
+
+sleeps until Platform_DoubleTime reaches deadline, absolute sleeps
+don't accumulate wakeup latency of previous sleeps
+==================
+*/
+static inline void Platform_SleepUntil( double deadline )
+{
+#if XASH_TIMER == TIMER_POSIX && !XASH_IRIX && !XASH_APPLE && defined( TIMER_ABSTIME )
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)deadline;
+	ts.tv_nsec = (long)(( deadline - (double)ts.tv_sec ) * 1000000000.0 );
+	if( ts.tv_nsec > 999999999 )
+		ts.tv_nsec = 999999999;
+
+	// Platform_DoubleTime is CLOCK_MONOTONIC here, EINTR just ends the sleep early
+	clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL );
+#else
+	double remaining = deadline - Platform_DoubleTime();
+
+	if( remaining > 1.0 )
+		remaining = 1.0; // Platform_NanoSleep takes int
+
+	if( remaining > 0.0 )
+		Platform_NanoSleep( (int)( remaining * 1000000000.0 ));
+#endif
+}
+
 #if XASH_WIN32 || XASH_FREEBSD || XASH_NETBSD || XASH_OPENBSD || XASH_ANDROID || XASH_LINUX || XASH_APPLE
 void Sys_SetupCrashHandler( const char *argv0 );
 void Sys_RestoreCrashHandler( void );
@@ -50,6 +50,7 @@ static void Sys_Crash( int signal, siginfo_t *si, void *context )
 	write( STDERR_FILENO, message, len );
 
 	// now get log fd and write trace directly to log
+	Sys_CrashFlushLog();
 	logfd = Sys_LogFileNo();
 	write( logfd, message, len );
 
@@ -206,6 +206,7 @@ static void Sys_StackTrace( PEXCEPTION_POINTERS pInfo )
 #endif
 
 	Sys_PrintLog( message );
+	Sys_CrashFlushLog();
 
 	SymCleanup( process );
 }
@@ -28,6 +28,7 @@ GNU General Public License for more details.
 #include "netchan.h"
 #include "custom.h"
 #include "world.h"
+#include "precache.h"
 
 //=============================================================================
 
@@ -38,6 +39,21 @@ GNU General Public License for more details.
 extern int SV_UPDATE_BACKUP;
 #endif
 
+#define SV_UNLAG_HISTORY	512	// player positions history size (must be power of 2)
+#define SV_UNLAG_MASK	(SV_UNLAG_HISTORY - 1)
+#define SV_UNLAG_INTERVAL	0.005	// don't record history more often than that
+
+#define SV_ENTITY_CLASS_HASH	1024	// must be power of 2
+
+#define SV_THINK_WHEEL_SIZE	256	// must be power of 2
+#define SV_THINK_WHEEL_MASK	(SV_THINK_WHEEL_SIZE - 1)
+#define SV_THINK_WHEEL_RATE	64	// slots per second
+#define SV_SLEEP_CHECK_INTERVAL	0.1	// how often sleeping edicts are checked for changes made by game
+
+// unlag history flags
+#define UNLAG_VALID		BIT( 0 )	// player was spawned
+#define UNLAG_NOINTERP	BIT( 1 )	// dead or EF_NOINTERP
+
 // hostflags
 #define SVF_SKIPLOCALHOST	BIT( 0 )
 #define SVF_MERGE_VISIBILITY	BIT( 1 )	// we are do portal pass
@@ -120,6 +136,20 @@ typedef struct
 	file_t		*file;
 } server_log_t;
 
+typedef struct
+{
+	double		time;
+	vec3_t		origin[MAX_CLIENTS];
+	byte		flags[MAX_CLIENTS];
+} sv_unlag_frame_t;
+
+typedef struct
+{
+	sv_unlag_frame_t	frames[SV_UNLAG_HISTORY];
+	int		sequence;			// next frame to write
+	int		lastbreak[MAX_CLIENTS];	// last frame where interpolation isn't possible
+} sv_unlag_t;
+
 typedef struct server_s
 {
 	sv_state_t	state;		// precache commands are only valid during load
@@ -146,6 +176,10 @@ typedef struct server_s
 	char		sound_precache[MAX_SOUNDS][MAX_QPATH];
 	char		files_precache[MAX_CUSTOM][MAX_QPATH];
 	char		event_precache[MAX_EVENTS][MAX_QPATH];
+	precache_hash_t	model_hash;		// case insensitive precache lookup
+	precache_hash_t	sound_hash;
+	precache_hash_t	files_hash;
+	precache_hash_t	event_hash;
 	byte		model_precache_flags[MAX_MODELS];
 	model_t		*models[MAX_MODELS];
 	int		num_static_entities;
@@ -182,6 +216,8 @@ typedef struct server_s
 
 	model_t		*worldmodel;	// pointer to world
 
+	sv_unlag_t	unlag;		// players positions history shared by all clients
+
 	qboolean		playersonly;
 	qboolean		simulating;	// physics is running
 	qboolean		paused;
@@ -305,6 +341,42 @@ typedef struct
 	vec3_t		finalpos;
 } sv_interp_t;
 
+typedef struct
+{
+	uint		*active;			// bit per edict, sleeping edicts are skipped by SV_Physics
+	int		*next;			// think wheel links
+	int		*prev;
+	float		*thinktime;		// nextthink at the moment edict went asleep
+	int		wheel[SV_THINK_WHEEL_SIZE];	// first sleeping edict in each slot
+	int		lasttick;
+	double		nextcheck;		// time to check sleeping edicts again
+	qboolean		enabled;			// active list is valid
+} sv_scheduler_t;
+
+typedef struct
+{
+	float		freetime;			// edict freetime at the moment it was queued
+	int		num;
+} sv_freeedict_t;
+
+typedef struct
+{
+	uint		*eligible;		// bit per free edict that can be reused right now
+	int		firstword;		// no eligible edicts below this word
+	sv_freeedict_t	*pending;			// ring of freed edicts in order of freetime
+	int		head, tail;
+	int		numentities;		// svgame.numEntities at last update
+	int		maxclients;
+	double		lasttime;
+	qboolean		valid;
+
+	// statistics
+	uint		allocated;
+	uint		reused;
+	uint		rebuilds;
+	uint		scanned;			// edicts checked by legacy allocator
+} sv_edictalloc_t;
+
 typedef struct
 {
 	// user messages stuff
@@ -330,6 +402,8 @@ typedef struct
 	movevars_t	oldmovevars;		// movement variables oldstate
 	playermove_t	*pmove;			// pmove state
 	sv_interp_t	interp[MAX_CLIENTS];	// interpolate clients
+	sv_scheduler_t	scheduler;		// active edicts for physics
+	sv_edictalloc_t	edictalloc;		// free edicts ready for reuse
 	sv_pushed_t	pushed[MAX_PUSHED_ENTS];	// no reason to keep array for all edicts
 						// 256 it should be enough for any game situation
 
@@ -339,6 +413,8 @@ typedef struct
 	NEW_DLL_FUNCTIONS	dllFuncs2;		// new dll exported funcs (may be NULL)
 	physics_interface_t	physFuncs;		// physics interface functions (Xash3D extension)
 
+	struct sv_entityclass_s	*entityclasses[SV_ENTITY_CLASS_HASH];	// classname -> spawn function cache
+
 	poolhandle_t mempool;			// server premamnent pool: edicts etc
 	poolhandle_t stringspool;		// for engine strings
 } svgame_static_t;
@@ -430,6 +506,8 @@ extern convar_t		sv_trace_messages;
 extern convar_t		sv_enttools_enable;
 extern convar_t		sv_enttools_maxfire;
 extern convar_t		sv_autosave;
+extern convar_t		sv_save_compress;
+extern convar_t		sv_levelstate_budget;
 extern convar_t		deathmatch;
 extern convar_t		hostname;
 extern convar_t		skill;
@@ -440,6 +518,9 @@ extern convar_t		sv_nat;
 extern convar_t		sv_speedhack_kick;
 extern convar_t		sv_pausable;		// allows pause in multiplayer
 extern convar_t		sv_check_errors;
+extern convar_t		sv_physics_scheduler;
+extern convar_t		sv_legacy_edict_alloc;
+extern convar_t		sv_lightcache;
 extern convar_t		sv_lighting_modulate;
 extern convar_t		sv_novis;
 extern convar_t		sv_hostmap;
@@ -504,6 +585,8 @@ static inline model_t *GAME_EXPORT SV_ModelHandle( int modelindex )
 //
 void SV_Physics( void );
 qboolean SV_InitPhysicsAPI( void );
+void SV_InitScheduler( void );
+void SV_WakeEdict( edict_t *ent );
 void SV_CheckVelocity( edict_t *ent );
 qboolean SV_PlayerRunThink( edict_t *ent, float frametime, double time );
 void SV_Impact( edict_t *e1, edict_t *e2, trace_t *trace );
@@ -604,6 +687,7 @@ void SV_FreeEdicts( void );
 edict_t *SV_AllocEdict( void );
 void SV_FreeEdict( edict_t *pEdict );
 void SV_InitEdict( edict_t *pEdict );
+void SV_InitEdictAlloc( void );
 const char *SV_ClassName( const edict_t *e );
 void SV_CopyTraceToGlobal( trace_t *trace );
 qboolean SV_CheckEdict( const edict_t *e, const char *file, const int line );
@@ -665,12 +749,15 @@ void SV_ChangeLevel( qboolean loadfromsavedgame, const char *mapname, const char
 const char *SV_GetLatestSave( void );
 void SV_InitSaveRestore( void );
 void SV_ClearGameState( void );
+void SV_FlushSaveGame( qboolean wait );
+void SV_LevelStateInfo_f( void );
 
 //
 // sv_pmove.c
 //
 void SV_InitClientMove( void );
 void SV_RunCmd( sv_client_t *cl, usercmd_t *ucmd, int random_seed );
+void SV_RecordUnlagFrame( void );
 
 //
 // sv_world.c
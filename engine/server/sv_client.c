@@ -2628,6 +2628,7 @@ static qboolean SV_EntFire_f( sv_client_t *cl )
 		}
 
 		SV_ClientPrintf( cl, "entity %i\n", i );
+		SV_WakeEdict( ent );
 
 		count++;
 
@@ -916,6 +916,7 @@ SV_EdictUsage_f
 */
 static void SV_EdictUsage_f( void )
 {
+	const sv_edictalloc_t *ea;
 	int	active;
 
 	if( sv.state != ss_active )
@@ -928,6 +929,12 @@ static void SV_EdictUsage_f( void )
 	Con_Printf( "%5i edicts is used\n", active );
 	Con_Printf( "%5i edicts is free\n", GI->max_edicts - active );
 	Con_Printf( "%5i total\n", GI->max_edicts );
+
+	ea = &svgame.edictalloc;
+	Con_Printf( "%5u allocations, %u reused slots\n", ea->allocated, ea->reused );
+	Con_Printf( "%5i freed edicts waiting for reuse\n", ea->tail - ea->head );
+	Con_Printf( "%5u free lists rebuilds\n", ea->rebuilds );
+	if( ea->scanned ) Con_Printf( "%5u edicts scanned by legacy allocator\n", ea->scanned );
 }
 
 /*
@@ -1072,6 +1079,7 @@ void SV_InitOperatorCommands( void )
 		Cmd_AddCommand( "save", SV_Save_f, "save the game to a file" );
 		Cmd_AddCommand( "savequick", SV_QuickSave_f, "save the game to the quicksave" );
 		Cmd_AddCommand( "autosave", SV_AutoSave_f, "save the game to 'autosave' file" );
+		Cmd_AddCommand( "levelstateinfo", SV_LevelStateInfo_f, "list level transition states kept in memory" );
 	}
 	else if( host.type == HOST_DEDICATED )
 	{
@@ -1111,6 +1119,7 @@ void SV_KillOperatorCommands( void )
 		Cmd_RemoveCommand( "save" );
 		Cmd_RemoveCommand( "savequick" );
 		Cmd_RemoveCommand( "autosave" );
+		Cmd_RemoveCommand( "levelstateinfo" );
 	}
 	else if( host.type == HOST_DEDICATED )
 	{
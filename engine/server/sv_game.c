@@ -1007,6 +1007,178 @@ void SV_InitEdict( edict_t *pEdict )
 	pEdict->v.controller[2] = 0x7F;
 	pEdict->v.controller[3] = 0x7F;
 	pEdict->free = false;
+
+	if( svgame.edictalloc.eligible )
+	{
+		int num = NUM_FOR_EDICT( pEdict );
+		ClearBits( svgame.edictalloc.eligible[num >> 5], BIT( num & 31 ));
+	}
+
+	SV_WakeEdict( pEdict );
+}
+
+// the first couple seconds of server time can involve a lot of
+// freeing and allocating, so relax the replacement policy
+#define SV_EdictCanReuse( e )	(( e )->freetime < 2.0f || ( sv.time - ( e )->freetime ) > 0.5f )
+
+/*
+==============
+SV_InitEdictAlloc
+
+allocate free edicts lists
+==============
+*/
+void SV_InitEdictAlloc( void )
+{
+	sv_edictalloc_t *ea = &svgame.edictalloc;
+
+	ea->eligible = Mem_Calloc( svgame.mempool, sizeof( *ea->eligible ) * (( GI->max_edicts + 31 ) >> 5 ));
+	ea->pending = Mem_Calloc( svgame.mempool, sizeof( *ea->pending ) * GI->max_edicts );
+	ea->valid = false;
+}
+
+static void SV_MarkEdictEligible( sv_edictalloc_t *ea, int num )
+{
+	SetBits( ea->eligible[num >> 5], BIT( num & 31 ));
+	ea->firstword = Q_min( ea->firstword, num >> 5 );
+}
+
+static void SV_QueueFreeEdict( sv_edictalloc_t *ea, edict_t *e, int num )
+{
+	sv_freeedict_t *p;
+
+	if( SV_EdictCanReuse( e ))
+	{
+		SV_MarkEdictEligible( ea, num );
+		return;
+	}
+
+	if( ea->tail - ea->head >= GI->max_edicts )
+	{
+		ea->valid = false; // will be rebuilt
+		return;
+	}
+
+	p = &ea->pending[ea->tail % GI->max_edicts];
+	p->freetime = e->freetime;
+	p->num = num;
+	ea->tail++;
+}
+
+static int SV_CompareFreeEdicts( const void *a, const void *b )
+{
+	const sv_freeedict_t *fa = a, *fb = b;
+
+	if( fa->freetime != fb->freetime )
+		return fa->freetime < fb->freetime ? -1 : 1;
+	return fa->num - fb->num;
+}
+
+/*
+==============
+SV_RebuildEdictAlloc
+
+collect free edicts after level change or overflow
+==============
+*/
+static void SV_RebuildEdictAlloc( sv_edictalloc_t *ea )
+{
+	int i;
+
+	memset( ea->eligible, 0, sizeof( *ea->eligible ) * (( GI->max_edicts + 31 ) >> 5 ));
+	ea->firstword = ( GI->max_edicts + 31 ) >> 5;
+	ea->head = ea->tail = 0;
+
+	for( i = svs.maxclients + 1; i < svgame.numEntities; i++ )
+	{
+		edict_t *e = EDICT_NUM( i );
+
+		if( !e->free )
+			continue;
+
+		if( SV_EdictCanReuse( e ))
+		{
+			SV_MarkEdictEligible( ea, i );
+			continue;
+		}
+
+		ea->pending[ea->tail].freetime = e->freetime;
+		ea->pending[ea->tail].num = i;
+		ea->tail++;
+	}
+
+	qsort( ea->pending, ea->tail, sizeof( *ea->pending ), SV_CompareFreeEdicts );
+
+	ea->numentities = svgame.numEntities;
+	ea->maxclients = svs.maxclients;
+	ea->valid = true;
+	ea->rebuilds++;
+}
+
+/*
+==============
+SV_UpdateEdictAlloc
+
+move freed edicts which delay has expired to eligible set
+==============
+*/
+static void SV_UpdateEdictAlloc( sv_edictalloc_t *ea )
+{
+	if( !ea->valid || sv.time < ea->lasttime || ea->maxclients != svs.maxclients || svgame.numEntities < ea->numentities )
+		SV_RebuildEdictAlloc( ea );
+
+	ea->numentities = svgame.numEntities;
+	ea->lasttime = sv.time;
+
+	while( ea->head < ea->tail )
+	{
+		const sv_freeedict_t *p = &ea->pending[ea->head % GI->max_edicts];
+		edict_t *e = EDICT_NUM( p->num );
+
+		// reused or freed again since then
+		if( e->free && e->freetime == p->freetime )
+		{
+			if( !SV_EdictCanReuse( e ))
+				break;
+
+			SV_MarkEdictEligible( ea, p->num );
+		}
+
+		ea->head++;
+	}
+
+	if( ea->head == ea->tail )
+		ea->head = ea->tail = 0;
+}
+
+/*
+==============
+SV_FindEligibleEdict
+
+lowest free edict number that can be reused
+==============
+*/
+static int SV_FindEligibleEdict( sv_edictalloc_t *ea )
+{
+	int words = ( svgame.numEntities + 31 ) >> 5;
+	int i, j;
+
+	for( i = ea->firstword; i < words; i++ )
+	{
+		if( !ea->eligible[i] )
+			continue;
+
+		ea->firstword = i;
+
+		for( j = 0; j < 32; j++ )
+		{
+			if( FBitSet( ea->eligible[i], BIT( j )))
+				return ( i << 5 ) + j;
+		}
+	}
+
+	ea->firstword = i;
+	return -1;
 }
 
 /*
@@ -1044,6 +1216,16 @@ void SV_FreeEdict( edict_t *pEdict )
 	VectorClear( pEdict->v.angles );
 	VectorClear( pEdict->v.origin );
 	pEdict->free = true;
+
+	if( svgame.edictalloc.valid )
+	{
+		int num = NUM_FOR_EDICT( pEdict );
+
+		if( sv.time < svgame.edictalloc.lasttime )
+			svgame.edictalloc.valid = false;
+		else if( num > svs.maxclients )
+			SV_QueueFreeEdict( &svgame.edictalloc, pEdict, num );
+	}
 }
 
 /*
@@ -1055,19 +1237,41 @@ allocate new or reuse existing
 */
 edict_t *GAME_EXPORT SV_AllocEdict( void )
 {
+	sv_edictalloc_t	*ea = &svgame.edictalloc;
 	edict_t	*e;
 	int	i;
 
-	for( i = svs.maxclients + 1; i < svgame.numEntities; i++ )
+	ea->allocated++;
+
+	if( sv_legacy_edict_alloc.value )
+	{
+		for( i = svs.maxclients + 1; i < svgame.numEntities; i++ )
+		{
+			e = EDICT_NUM( i );
+			ea->scanned++;
+
+			if( e->free && SV_EdictCanReuse( e ))
+			{
+				SV_InitEdict( e );
+				ea->reused++;
+				return e;
+			}
+		}
+	}
+	else
 	{
-		e = EDICT_NUM( i );
-		// the first couple seconds of server time can involve a lot of
-		// freeing and allocating, so relax the replacement policy
-		if( e->free && ( e->freetime < 2.0f || ( sv.time - e->freetime ) > 0.5f ))
+		// same slot as linear search would find
+		SV_UpdateEdictAlloc( ea );
+
+		if(( i = SV_FindEligibleEdict( ea )) != -1 )
 		{
+			e = EDICT_NUM( i );
 			SV_InitEdict( e );
+			ea->reused++;
 			return e;
 		}
+
+		i = svgame.numEntities;
 	}
 
 	if( i >= GI->max_edicts )
@@ -1080,17 +1284,46 @@ edict_t *GAME_EXPORT SV_AllocEdict( void )
 	return e;
 }
 
+typedef struct sv_entityclass_s
+{
+	struct sv_entityclass_s	*next;
+	LINK_ENTITY_FUNC	func;	// NULL if game dll doesn't export this class
+	char		name[1];	// variable length
+} sv_entityclass_t;
+
 /*
 ==============
 SV_GetEntityClass
 
-get pointer for entity class
+get pointer for entity class,
+results are cached until game dll is unloaded
 ==============
 */
 static LINK_ENTITY_FUNC SV_GetEntityClass( const char *pszClassName )
 {
+	sv_entityclass_t *ec;
+	uint hash;
+	size_t len;
+
+	// hash is case insensitive but symbols are not
+	hash = COM_HashKey( pszClassName, SV_ENTITY_CLASS_HASH );
+
+	for( ec = svgame.entityclasses[hash]; ec; ec = ec->next )
+	{
+		if( !Q_strcmp( ec->name, pszClassName ))
+			return ec->func;
+	}
+
+	len = Q_strlen( pszClassName );
+	ec = Mem_Malloc( svgame.mempool, sizeof( *ec ) + len );
+	memcpy( ec->name, pszClassName, len + 1 );
+
 	// allocate edict private memory (passed by dlls)
-	return (LINK_ENTITY_FUNC)COM_GetProcAddress( svgame.hInstance, pszClassName );
+	ec->func = (LINK_ENTITY_FUNC)COM_GetProcAddress( svgame.hInstance, pszClassName );
+	ec->next = svgame.entityclasses[hash];
+	svgame.entityclasses[hash] = ec;
+
+	return ec->func;
 }
 
 /*
@@ -1332,11 +1565,8 @@ static int GAME_EXPORT pfnModelIndex( const char *m )
 	Q_strncpy( name, m, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_MODELS && sv.model_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.model_precache[i], name ))
-			return i;
-	}
+	if(( i = Precache_FindName( &sv.model_hash, sv.model_precache, MAX_MODELS, name )) != 0 )
+		return i;
 
 	Con_Printf( S_ERROR "Cannot get index for model %s: not precached\n", name );
 	return 0;
@@ -1534,7 +1764,11 @@ static edict_t *GAME_EXPORT SV_FindEntityByString( edict_t *pStartEdict, const c
 			if( t != NULL && t != svgame.globals->pStringBase )
 			{
 				if( !Q_strcmp( t, pszValue ))
+				{
+					// game is going to fire this entity
+					SV_WakeEdict( ed );
 					return ed;
+				}
 			}
 			break;
 		default:
@@ -1611,7 +1845,10 @@ static edict_t *GAME_EXPORT pfnFindEntityInSphere( edict_t *pStartEdict, const f
 		}
 
 		if( distSquared < flRadius )
+		{
+			SV_WakeEdict( ent );
 			return ent;
+		}
 	}
 
 	return svgame.edicts;
@@ -1774,6 +2011,7 @@ static edict_t *pfnEntitiesInPVS( edict_t *pview )
 
 		if( SV_BoxInPVS( viewpoint, ptest->v.absmin, ptest->v.absmax ))
 		{
+			SV_WakeEdict( pent );
 			pent->v.chain = pchain;
 			pchain = pent;
 		}
@@ -3147,7 +3385,7 @@ static void SV_AllocStringPool( void )
 	svgame.globals->pStringBase = "";
 #endif // !XASH_64BIT
 
-	svgame.stringspool = Mem_AllocPool( "Server Strings" );
+	svgame.stringspool = Mem_AllocPoolExt( "Server Strings", MEMPOOL_ARENA ); // emptied on each level change
 }
 
 static void SV_FreeStringPool( void )
@@ -3447,7 +3685,10 @@ static edict_t *GAME_EXPORT pfnFindEntityByVars( entvars_t *pvars )
 
 		// g-cont: we should compare pointers
 		if( &pEdict->v == pvars )
+		{
+			SV_WakeEdict( pEdict );
 			return pEdict; // found it
+		}
 	}
 
 	return NULL;
@@ -5344,6 +5585,8 @@ qboolean SV_LoadProgs( const char *name )
 	svgame.globals->maxEntities = GI->max_edicts;
 	svgame.globals->maxClients = svs.maxclients;
 	svgame.edicts = Mem_Calloc( svgame.mempool, sizeof( edict_t ) * GI->max_edicts );
+	SV_InitScheduler();
+	SV_InitEdictAlloc();
 	svs.static_entities = Z_Calloc( sizeof( entity_state_t ) * MAX_STATIC_ENTITIES );
 	svs.baselines = Z_Calloc( sizeof( entity_state_t ) * GI->max_edicts );
 	svgame.numEntities = svs.maxclients + 1; // clients + world
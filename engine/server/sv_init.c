@@ -113,11 +113,10 @@ int SV_ModelIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_MODELS && sv.model_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.model_precache[i], name ))
-			return i;
-	}
+	if(( i = Precache_FindName( &sv.model_hash, sv.model_precache, MAX_MODELS, name )) != 0 )
+		return i;
+
+	i = sv.model_hash.count + 1;
 
 	if( i == MAX_MODELS )
 	{
@@ -127,6 +126,7 @@ int SV_ModelIndex( const char *filename )
 
 	// register new model
 	Q_strncpy( sv.model_precache[i], name, sizeof( sv.model_precache[i] ));
+	Precache_AddHash( &sv.model_hash, sv.model_precache[i], i );
 
 	if( sv.state != ss_loading )
 	{
@@ -164,11 +164,10 @@ int GAME_EXPORT SV_SoundIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_SOUNDS && sv.sound_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.sound_precache[i], name ))
-			return i;
-	}
+	if(( i = Precache_FindName( &sv.sound_hash, sv.sound_precache, MAX_SOUNDS, name )) != 0 )
+		return i;
+
+	i = sv.sound_hash.count + 1;
 
 	if( i == MAX_SOUNDS )
 	{
@@ -178,6 +177,7 @@ int GAME_EXPORT SV_SoundIndex( const char *filename )
 
 	// register new sound
 	Q_strncpy( sv.sound_precache[i], name, sizeof( sv.sound_precache[i] ));
+	Precache_AddHash( &sv.sound_hash, sv.sound_precache[i], i );
 
 	if( sv.state != ss_loading )
 	{
@@ -207,11 +207,10 @@ int SV_EventIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_EVENTS && sv.event_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.event_precache[i], name ))
-			return i;
-	}
+	if(( i = Precache_FindName( &sv.event_hash, sv.event_precache, MAX_EVENTS, name )) != 0 )
+		return i;
+
+	i = sv.event_hash.count + 1;
 
 	if( i == MAX_EVENTS )
 	{
@@ -221,6 +220,7 @@ int SV_EventIndex( const char *filename )
 
 	// register new event
 	Q_strncpy( sv.event_precache[i], name, sizeof( sv.event_precache[i] ));
+	Precache_AddHash( &sv.event_hash, sv.event_precache[i], i );
 
 	if( sv.state != ss_loading )
 	{
@@ -249,11 +249,10 @@ int GAME_EXPORT SV_GenericIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_CUSTOM && sv.files_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.files_precache[i], name ))
-			return i;
-	}
+	if(( i = Precache_FindName( &sv.files_hash, sv.files_precache, MAX_CUSTOM, name )) != 0 )
+		return i;
+
+	i = sv.files_hash.count + 1;
 
 	if( i == MAX_CUSTOM )
 	{
@@ -263,6 +262,7 @@ int GAME_EXPORT SV_GenericIndex( const char *filename )
 
 	// register new generic resource
 	Q_strncpy( sv.files_precache[i], name, sizeof( sv.files_precache[i] ));
+	Precache_AddHash( &sv.files_hash, sv.files_precache[i], i );
 
 	if( sv.state != ss_loading )
 	{
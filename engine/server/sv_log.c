@@ -75,7 +75,11 @@ void Log_Open( void )
 		return;
 	}
 
-	if( fp ) svs.log.file = fp;
+	if( fp )
+	{
+		svs.log.file = fp;
+		Sys_StartLogThread();
+	}
 	Log_Printf( "Log file started (file \"%s\") (game \"%s\") (version \"%i/" XASH_VERSION "/%d\")\n",
 	szTestFile, Info_ValueForKey( svs.serverinfo, "*gamedir" ), PROTOCOL_VERSION, Q_buildnum() );
 }
@@ -85,6 +89,7 @@ void Log_Close( void )
 	if( svs.log.file )
 	{
 		Log_Printf( "Log file closed\n" );
+		Sys_FlushLog( 0.0 ); // log thread must be done with this file
 		FS_Close( svs.log.file );
 	}
 	svs.log.file = NULL;
@@ -101,26 +106,35 @@ void Log_Printf( const char *fmt, ... )
 {
 	va_list		argptr;
 	static char	string[1024];
+	static time_t	stamptime;
+	static int	stamplen;
 	char		*p;
 	time_t		ltime;
-	struct tm	*today;
 	int		len;
 
 	if( !svs.log.net_log && !svs.log.active )
 		return;
 
 	time( &ltime );
-	today = localtime( &ltime );
 
-	len = Q_snprintf( string, sizeof( string ), "%02i/%02i/%04i - %02i:%02i:%02i: ",
-		today->tm_mon+1, today->tm_mday, 1900 + today->tm_year, today->tm_hour, today->tm_min, today->tm_sec );
+	// timestamp is kept in the buffer while second is not changed
+	if( ltime != stamptime || !stamplen )
+	{
+		struct tm *today = localtime( &ltime );
 
-	p = string + len;
+		stamplen = Q_snprintf( string, sizeof( string ), "%02i/%02i/%04i - %02i:%02i:%02i: ",
+			today->tm_mon+1, today->tm_mday, 1900 + today->tm_year, today->tm_hour, today->tm_min, today->tm_sec );
+		stamptime = ltime;
+	}
+
+	p = string + stamplen;
 
 	va_start( argptr, fmt );
-	Q_vsnprintf( p, sizeof( string ) - len, fmt, argptr );
+	len = Q_vsnprintf( p, sizeof( string ) - stamplen, fmt, argptr );
 	va_end( argptr );
 
+	len = len < 0 ? sizeof( string ) - 1 : stamplen + len;
+
 	if( svs.log.net_log )
 		Netchan_OutOfBandPrint( NS_SERVER, svs.log.net_address, "log %s", string );
 
@@ -132,7 +146,10 @@ void Log_Printf( const char *fmt, ... )
 
 		// echo to log file
 		if( svs.log.file && mp_logfile.value )
-			FS_Printf( svs.log.file, "%s", string );
+		{
+			if( !Sys_QueueLog( svs.log.file, string, len ))
+				FS_Write( svs.log.file, string, len );
+		}
 	}
 }
 
@@ -64,6 +64,8 @@ CVAR_DEFINE_AUTO( sv_log_onefile, "0", FCVAR_ARCHIVE, "logs server information t
 CVAR_DEFINE_AUTO( sv_trace_messages, "0", FCVAR_LATCH, "enable server usermessages tracing (good for developers)" );
 CVAR_DEFINE_AUTO( sv_master_response_timeout, "4", FCVAR_ARCHIVE, "master server heartbeat response timeout in seconds" );
 CVAR_DEFINE_AUTO( sv_autosave, "1", FCVAR_ARCHIVE|FCVAR_SERVER|FCVAR_PRIVILEGED, "enable autosaving" );
+CVAR_DEFINE_AUTO( sv_levelstate_budget, "32", FCVAR_ARCHIVE, "memory budget in megabytes for level transition states, 0 keeps them in save folder" );
+CVAR_DEFINE_AUTO( sv_save_compress, "1", FCVAR_ARCHIVE|FCVAR_PRIVILEGED, "write deflated savegames, disable to keep them GoldSrc compatible" );
 CVAR_DEFINE_AUTO( sv_speedhack_kick, "10", FCVAR_ARCHIVE, "number of speedhack warns before automatic kick (0 to disable)" );
 
 // game-related cvars
@@ -135,6 +137,9 @@ CVAR_DEFINE_AUTO( sv_novis, "0", 0, "force to ignore server visibility" );			//
 CVAR_DEFINE( sv_pausable, "pausable", "1", 0, "allow players to pause or not" );
 CVAR_DEFINE( sv_maxclients, "maxplayers", "1", FCVAR_LATCH, "server max capacity" );
 CVAR_DEFINE_AUTO( sv_check_errors, "0", FCVAR_ARCHIVE, "check edicts for errors" );
+CVAR_DEFINE_AUTO( sv_legacy_edict_alloc, "0", FCVAR_ARCHIVE, "find free edicts with linear search, reused slots are the same" );
+CVAR_DEFINE_AUTO( sv_physics_scheduler, "0", FCVAR_ARCHIVE, "skip idle entities in physics, think time changed by other entities may be delayed up to 0.1 seconds" );
+CVAR_DEFINE_AUTO( sv_lightcache, "0", FCVAR_ARCHIVE, "approximate entity illumination with light sampled on a grid, faster but not exact" );
 CVAR_DEFINE_AUTO( sv_validate_changelevel, "0", 0, "test change level for level-designer errors" );
 CVAR_DEFINE( sv_hostmap, "hostmap", "", 0, "keep name of last entered map" );
 
@@ -681,6 +686,9 @@ void Host_ServerFrame( void )
 	// if server is not active, do nothing
 	if( !svs.initialized ) return;
 
+	// release finished background save
+	SV_FlushSaveGame( false );
+
 	if( sv_fps.value != 0.0f && ( sv.simulating || sv.state != ss_active ))
 		sv.time_residual += host.frametime;
 
@@ -706,6 +714,9 @@ void Host_ServerFrame( void )
 	// let everything in the world think and move
 	if( !SV_RunGameFrame ()) return;
 
+	// remember players positions for lag compensation
+	SV_RecordUnlagFrame ();
+
 	// send messages back to the clients that had packets read this frame
 	SV_SendClientMessages ();
 
@@ -929,6 +940,9 @@ void SV_Init( void )
 	Cvar_RegisterVariable( &sv_stopspeed );
 	Cvar_RegisterVariable( &sv_maxclients );
 	Cvar_RegisterVariable( &sv_check_errors );
+	Cvar_RegisterVariable( &sv_physics_scheduler );
+	Cvar_RegisterVariable( &sv_legacy_edict_alloc );
+	Cvar_RegisterVariable( &sv_lightcache );
 	Cvar_RegisterVariable( &public_server );
 	Cvar_RegisterVariable( &sv_failuretime );
 	Cvar_RegisterVariable( &sv_unlag );
@@ -964,6 +978,8 @@ void SV_Init( void )
 
 	Cvar_RegisterVariable( &sv_background_freeze );
 	Cvar_RegisterVariable( &sv_autosave );
+	Cvar_RegisterVariable( &sv_save_compress );
+	Cvar_RegisterVariable( &sv_levelstate_budget );
 
 	Cvar_RegisterVariable( &mapcyclefile );
 	Cvar_RegisterVariable( &motdfile );
@@ -1100,6 +1116,9 @@ before Sys_Quit or Sys_Error
 */
 void SV_Shutdown( const char *finalmsg )
 {
+	// pending save must reach the disk
+	SV_FlushSaveGame( true );
+
 	// already freed
 	if( !SV_Initialized( ))
 	{
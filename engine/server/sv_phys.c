@@ -312,6 +312,9 @@ void SV_Impact( edict_t *e1, edict_t *e2, trace_t *trace )
 			return;
 	}
 
+	SV_WakeEdict( e1 );
+	SV_WakeEdict( e2 );
+
 	if( e1->v.solid != SOLID_NOT )
 	{
 		SV_CopyTraceToGlobal( trace );
@@ -1201,7 +1204,11 @@ static void SV_Physics_Pusher( edict_t *ent )
 
 	// if the pusher has a "blocked" function, call it
 	// otherwise, just stay in place until the obstacle is gone
-	if( pBlocker ) svgame.dllFuncs.pfnBlocked( ent, pBlocker );
+	if( pBlocker )
+	{
+		SV_WakeEdict( pBlocker );
+		svgame.dllFuncs.pfnBlocked( ent, pBlocker );
+	}
 
 	for( i = 0; i < 3; i++ )
 	{
@@ -1783,6 +1790,268 @@ static void SV_Physics_Entity( edict_t *ent )
 		SV_FreeEdict( ent );
 }
 
+/*
+================
+SV_InitScheduler
+
+allocate active list and think wheel for all edicts
+================
+*/
+void SV_InitScheduler( void )
+{
+	sv_scheduler_t *sched = &svgame.scheduler;
+
+	sched->active = Mem_Calloc( svgame.mempool, sizeof( *sched->active ) * (( GI->max_edicts + 31 ) >> 5 ));
+	sched->next = Mem_Calloc( svgame.mempool, sizeof( *sched->next ) * GI->max_edicts );
+	sched->prev = Mem_Calloc( svgame.mempool, sizeof( *sched->prev ) * GI->max_edicts );
+	sched->thinktime = Mem_Calloc( svgame.mempool, sizeof( *sched->thinktime ) * GI->max_edicts );
+	sched->enabled = false;
+}
+
+static int SV_ThinkTick( double time )
+{
+	return (int)( time * SV_THINK_WHEEL_RATE );
+}
+
+static void SV_UnlinkThink( sv_scheduler_t *sched, int num )
+{
+	int next = sched->next[num];
+	int prev = sched->prev[num];
+
+	if( prev != -1 )
+		sched->next[prev] = next;
+	else sched->wheel[SV_ThinkTick( sched->thinktime[num] ) & SV_THINK_WHEEL_MASK] = next;
+
+	if( next != -1 )
+		sched->prev[next] = prev;
+
+	sched->thinktime[num] = 0.0f;
+}
+
+/*
+================
+SV_WakeEdict
+
+edict will be processed by SV_Physics again,
+called when engine sees that edict can be changed
+================
+*/
+void SV_WakeEdict( edict_t *ent )
+{
+	sv_scheduler_t *sched = &svgame.scheduler;
+	int num;
+
+	if( !sched->enabled )
+		return;
+
+	num = NUM_FOR_EDICT( ent );
+
+	if( FBitSet( sched->active[num >> 5], BIT( num & 31 )))
+		return;
+
+	// only edicts with nextthink in future are in think wheel
+	if( sched->thinktime[num] > 0.0f )
+		SV_UnlinkThink( sched, num );
+	else sched->thinktime[num] = 0.0f;
+
+	SetBits( sched->active[num >> 5], BIT( num & 31 ));
+}
+
+static void SV_WakeAllEdicts( void )
+{
+	sv_scheduler_t *sched = &svgame.scheduler;
+	int i;
+
+	memset( sched->active, 0xFF, sizeof( *sched->active ) * (( GI->max_edicts + 31 ) >> 5 ));
+	memset( sched->thinktime, 0, sizeof( *sched->thinktime ) * GI->max_edicts );
+
+	for( i = 0; i < SV_THINK_WHEEL_SIZE; i++ )
+		sched->wheel[i] = -1;
+}
+
+/*
+================
+SV_RunThinkWheel
+
+wake up edicts which will think this frame
+================
+*/
+static void SV_RunThinkWheel( int tick )
+{
+	sv_scheduler_t *sched = &svgame.scheduler;
+	int t, num, next;
+
+	// last slot is checked again because it may contain edicts for the next frame
+	for( t = Q_max( sched->lasttick, tick - SV_THINK_WHEEL_MASK ); t <= tick; t++ )
+	{
+		for( num = sched->wheel[t & SV_THINK_WHEEL_MASK]; num != -1; num = next )
+		{
+			next = sched->next[num];
+
+			if( sched->thinktime[num] > ( sv.time + sv.frametime ))
+				continue; // next revolution
+
+			SV_UnlinkThink( sched, num );
+			SetBits( sched->active[num >> 5], BIT( num & 31 ));
+		}
+	}
+
+	sched->lasttick = tick;
+}
+
+/*
+================
+SV_CanSleep
+
+edict has nothing to do in physics until its nextthink
+================
+*/
+static qboolean SV_CanSleep( const edict_t *ent )
+{
+	if( ent->v.movetype != MOVETYPE_NONE )
+		return false;
+
+	if( FBitSet( ent->v.flags, FL_KILLME|FL_ONGROUND|FL_BASEVELOCITY ) || !VectorIsNull( ent->v.basevelocity ))
+		return false;
+
+	// will be cleared by SV_PrepWorldFrame
+	if( FBitSet( ent->v.effects, EF_MUZZLEFLASH|EF_NOINTERP ))
+		return false;
+
+	return true;
+}
+
+/*
+================
+SV_CheckSleepingEdicts
+
+game can change any edict without calling the engine,
+e.g. set nextthink of entity it keeps a pointer to,
+so wake up sleeping edicts that were changed since
+================
+*/
+static void SV_CheckSleepingEdicts( void )
+{
+	sv_scheduler_t *sched = &svgame.scheduler;
+	edict_t *ent;
+	int i;
+
+	for( i = svs.maxclients + 1; i < svgame.numEntities; i++ )
+	{
+		if( FBitSet( sched->active[i >> 5], BIT( i & 31 )))
+			continue;
+
+		ent = EDICT_NUM( i );
+
+		if( ent->free )
+			continue;
+
+		if( ent->v.nextthink != sched->thinktime[i] || !SV_CanSleep( ent ))
+			SV_WakeEdict( ent );
+	}
+
+	sched->nextcheck = sv.time + SV_SLEEP_CHECK_INTERVAL;
+}
+
+/*
+================
+SV_SleepEdict
+
+remove edict from active list if it doesn't need physics,
+it will be woken up by think wheel, by engine
+or by SV_CheckSleepingEdicts
+================
+*/
+static void SV_SleepEdict( edict_t *ent, int num )
+{
+	sv_scheduler_t *sched = &svgame.scheduler;
+	float thinktime = ent->v.nextthink;
+	int slot;
+
+	if( !SV_CanSleep( ent ))
+		return;
+
+	// think wheel can't go back in time
+	if( thinktime > 0.0f && thinktime <= ( sv.time + sv.frametime ))
+		return;
+
+	ClearBits( sched->active[num >> 5], BIT( num & 31 ));
+
+	// remember nextthink to see if game has changed it
+	sched->thinktime[num] = thinktime;
+
+	if( thinktime <= 0.0f )
+		return; // not in think wheel
+
+	slot = SV_ThinkTick( thinktime ) & SV_THINK_WHEEL_MASK;
+	sched->prev[num] = -1;
+	sched->next[num] = sched->wheel[slot];
+
+	if( sched->wheel[slot] != -1 )
+		sched->prev[sched->wheel[slot]] = num;
+	sched->wheel[slot] = num;
+}
+
+/*
+================
+SV_PhysicsScheduled
+
+same as SV_Physics loop but skips sleeping edicts,
+edicts are still processed in index order
+================
+*/
+static void SV_PhysicsScheduled( void )
+{
+	sv_scheduler_t *sched = &svgame.scheduler;
+	int tick = SV_ThinkTick( sv.time + sv.frametime );
+	edict_t	*ent;
+	int i;
+
+	if( !sched->enabled || tick < sched->lasttick || svgame.globals->force_retouch != 0.0f )
+	{
+		SV_WakeAllEdicts();
+		sched->lasttick = tick;
+		sched->nextcheck = sv.time + SV_SLEEP_CHECK_INTERVAL;
+		sched->enabled = true;
+	}
+	else
+	{
+		SV_RunThinkWheel( tick );
+
+		if( sv.time >= sched->nextcheck )
+			SV_CheckSleepingEdicts();
+	}
+
+	for( i = 0; i < svgame.numEntities; i++ )
+	{
+		// skip whole word of sleeping edicts
+		if( !sched->active[i >> 5] )
+		{
+			i |= 31;
+			continue;
+		}
+
+		if( !FBitSet( sched->active[i >> 5], BIT( i & 31 )))
+			continue;
+
+		ent = EDICT_NUM( i );
+
+		if( !SV_IsValidEdict( ent ))
+		{
+			ClearBits( sched->active[i >> 5], BIT( i & 31 ));
+			continue;
+		}
+
+		if( i > 0 && i <= svs.maxclients )
+			continue;
+
+		SV_Physics_Entity( ent );
+
+		if( i > 0 && SV_IsValidEdict( ent ))
+			SV_SleepEdict( ent, i );
+	}
+}
+
 static void SV_RunLightStyles( void )
 {
 	int	i;
@@ -1823,18 +2092,27 @@ void SV_Physics( void )
 	// let the progs know that a new frame has started
 	svgame.dllFuncs.pfnStartFrame();
 
-	// treat each object in turn
-	for( i = 0; i < svgame.numEntities; i++ )
+	if( sv_physics_scheduler.value && !svgame.physFuncs.SV_PhysicsEntity )
 	{
-		ent = EDICT_NUM( i );
+		SV_PhysicsScheduled();
+	}
+	else
+	{
+		svgame.scheduler.enabled = false;
 
-		if( !SV_IsValidEdict( ent ))
-			continue;
+		// treat each object in turn
+		for( i = 0; i < svgame.numEntities; i++ )
+		{
+			ent = EDICT_NUM( i );
 
-		if( i > 0 && i <= svs.maxclients )
-			continue;
+			if( !SV_IsValidEdict( ent ))
+				continue;
 
-		SV_Physics_Entity( ent );
+			if( i > 0 && i <= svs.maxclients )
+				continue;
+
+			SV_Physics_Entity( ent );
+		}
 	}
 
 	if( svgame.globals->force_retouch != 0.0f )
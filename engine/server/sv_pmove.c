@@ -664,40 +664,107 @@ static void SV_FinishPMove( playermove_t *pmove, sv_client_t *cl )
 	pmove->runfuncs = false;
 }
 
-static entity_state_t *SV_FindEntInPack( int index, client_frame_t *frame )
+static qboolean SV_UnlagCheckTeleport( vec3_t old_pos, vec3_t new_pos )
+{
+	int	i;
+
+	for( i = 0; i < 3; i++ )
+	{
+		if( fabs( old_pos[i] - new_pos[i] ) > 64.0f )
+			return true;
+	}
+	return false;
+}
+
+/*
+===========
+SV_RecordUnlagFrame
+
+remember players positions once per server frame,
+history is shared by all clients
+===========
+*/
+void SV_RecordUnlagFrame( void )
 {
-	entity_state_t	*state;
+	sv_unlag_t	*unlag = &sv.unlag;
+	sv_unlag_frame_t	*frame, *prev;
+	sv_client_t	*check;
 	int		i;
 
-	for( i = 0; i < frame->num_entities; i++ )
+	if( svs.maxclients <= 1 || !sv_unlag.value )
+		return;
+
+	prev = unlag->sequence > 0 ? &unlag->frames[(unlag->sequence - 1) & SV_UNLAG_MASK] : NULL;
+
+	if( prev && host.realtime - prev->time < SV_UNLAG_INTERVAL )
+		return;
+
+	frame = &unlag->frames[unlag->sequence & SV_UNLAG_MASK];
+	frame->time = host.realtime;
+
+	for( i = 0, check = svs.clients; i < svs.maxclients; i++, check++ )
 	{
-		state = &svs.packet_entities[(frame->first_entity+i)%svs.num_client_entities];
+		edict_t *ent = check->edict;
+
+		if( check->state != cs_spawned || !SV_IsValidEdict( ent ))
+		{
+			frame->flags[i] = 0;
+			unlag->lastbreak[i] = unlag->sequence;
+			continue;
+		}
+
+		frame->flags[i] = UNLAG_VALID;
+		VectorCopy( ent->v.origin, frame->origin[i] );
 
-		if( state->number == index )
-			return state;
+		if( ent->v.health <= 0 || FBitSet( ent->v.effects, EF_NOINTERP ))
+		{
+			SetBits( frame->flags[i], UNLAG_NOINTERP );
+			unlag->lastbreak[i] = unlag->sequence;
+		}
+		else if( prev && FBitSet( prev->flags[i], UNLAG_VALID ) && SV_UnlagCheckTeleport( prev->origin[i], frame->origin[i] ))
+		{
+			// can't interpolate between these two frames
+			unlag->lastbreak[i] = Q_max( unlag->lastbreak[i], unlag->sequence - 1 );
+		}
 	}
-	return NULL;
+
+	unlag->sequence++;
 }
 
-static qboolean SV_UnlagCheckTeleport( vec3_t old_pos, vec3_t new_pos )
+/*
+===========
+SV_FindUnlagFrame
+
+find the latest frame recorded before the given time
+===========
+*/
+static int SV_FindUnlagFrame( const sv_unlag_t *unlag, double time )
 {
-	int	i;
+	int	lo = Q_max( unlag->sequence - SV_UNLAG_HISTORY, 0 );
+	int	hi = unlag->sequence - 1;
+	int	result = -1;
 
-	for( i = 0; i < 3; i++ )
+	while( lo <= hi )
 	{
-		if( fabs( old_pos[i] - new_pos[i] ) > 64.0f )
-			return true;
+		int mid = lo + ( hi - lo ) / 2;
+
+		if( time > unlag->frames[mid & SV_UNLAG_MASK].time )
+		{
+			result = mid;
+			lo = mid + 1;
+		}
+		else hi = mid - 1;
 	}
-	return false;
+
+	return result;
 }
 
 static void SV_SetupMoveInterpolant( sv_client_t *cl )
 {
-	int		i, j, clientnum;
+	int		i, num;
 	float		finalpush, lerp_msec;
 	float		latency, lerpFrac;
-	client_frame_t	*frame, *frame2;
-	entity_state_t	*state, *lerpstate;
+	const sv_unlag_frame_t	*frame, *frame2;
 	vec3_t		curpos, newpos;
 	sv_client_t	*check;
 	sv_interp_t	*lerp;
@@ -741,94 +808,54 @@ static void SV_SetupMoveInterpolant( sv_client_t *cl )
 	finalpush = ( host.realtime - latency - lerp_msec ) + sv_unlagpush.value;
 	if( finalpush > host.realtime ) finalpush = host.realtime; // pushed too much ?
 
-	frame = frame2 = NULL;
-
-	for( i = 0; i < SV_UPDATE_BACKUP; i++, frame2 = frame )
-	{
-		frame = &cl->frames[(cl->netchan.outgoing_sequence - (i + 1)) & SV_UPDATE_MASK];
-
-		for( j = 0; j < frame->num_entities; j++ )
-		{
-			state = &svs.packet_entities[(frame->first_entity+j)%svs.num_client_entities];
-
-			if( state->number < 1 || state->number > svs.maxclients )
-				continue;
-
-			lerp = &svgame.interp[state->number-1];
-			if( lerp->nointerp ) continue;
-
-			if( state->health <= 0 || FBitSet( state->effects, EF_NOINTERP ))
-				lerp->nointerp = true;
-
-			if( lerp->firstframe )
-			{
-				if( SV_UnlagCheckTeleport( state->origin, lerp->finalpos ))
-					lerp->nointerp = true;
-			}
-			else lerp->firstframe = true;
-
-			VectorCopy( state->origin, lerp->finalpos );
-		}
-
-		if( finalpush > frame->senttime )
-			break;
-	}
+	num = SV_FindUnlagFrame( &sv.unlag, finalpush );
 
-	if( i == SV_UPDATE_BACKUP || finalpush - frame->senttime > 1.0f )
+	if( num < 0 || finalpush - sv.unlag.frames[num & SV_UNLAG_MASK].time > 1.0f )
 	{
 		memset( svgame.interp, 0, sizeof( svgame.interp ));
 		has_update = false;
 		return;
 	}
 
-	if( !frame2 )
+	frame = &sv.unlag.frames[num & SV_UNLAG_MASK];
+
+	if( num + 1 >= sv.unlag.sequence )
 	{
 		frame2 = frame;
 		lerpFrac = 0;
 	}
 	else
 	{
-		if( frame2->senttime - frame->senttime == 0.0 )
+		frame2 = &sv.unlag.frames[(num + 1) & SV_UNLAG_MASK];
+
+		if( frame2->time - frame->time == 0.0 )
 		{
 			lerpFrac = 0;
 		}
 		else
 		{
-			lerpFrac = (finalpush - frame->senttime) / (frame2->senttime - frame->senttime);
+			lerpFrac = (finalpush - frame->time) / (frame2->time - frame->time);
 			lerpFrac = bound( 0.0f, lerpFrac, 1.0f );
 		}
 	}
 
-	for( i = 0; i < frame->num_entities; i++ )
+	for( i = 0, check = svs.clients; i < svs.maxclients; i++, check++ )
 	{
-		state = &svs.packet_entities[(frame->first_entity+i)%svs.num_client_entities];
-
-		if( state->number < 1 || state->number > svs.maxclients )
-			continue;
-
-		clientnum = state->number - 1;
-		check = &svs.clients[clientnum];
-
-		if( check->state != cs_spawned || check == cl )
-			continue;
-
-		lerp = &svgame.interp[clientnum];
+		lerp = &svgame.interp[i];
 
-		if( !lerp->active || lerp->nointerp )
+		if( !lerp->active )
 			continue;
 
-		lerpstate = SV_FindEntInPack( state->number, frame2 );
-
-		if( !lerpstate )
-		{
-			VectorCopy( state->origin, curpos );
-		}
-		else
+		// died, teleported or respawned since then
+		if( sv.unlag.lastbreak[i] >= num )
 		{
-			VectorSubtract( lerpstate->origin, state->origin, newpos );
-			VectorMA( state->origin, lerpFrac, newpos, curpos );
+			lerp->nointerp = true;
+			continue;
 		}
 
+		VectorSubtract( frame2->origin[i], frame->origin[i], newpos );
+		VectorMA( frame->origin[i], lerpFrac, newpos, curpos );
+
 		VectorCopy( curpos, lerp->curpos );
 		VectorCopy( curpos, lerp->newpos );
 
@@ -962,9 +989,11 @@ void SV_RunCmd( sv_client_t *cl, usercmd_t *ucmd, int random_seed )
 
 	// setup playermove state
 	SV_SetupPMove( svgame.pmove, cl, ucmd, cl->physinfo );
+	PM_SetupBroadphase( svgame.pmove );
 
 	// motor!
 	svgame.dllFuncs.pfnPM_Move( svgame.pmove, true );
+	PM_ClearBroadphase( svgame.pmove );
 
 	// copy results back to client
 	SV_FinishPMove( svgame.pmove, cl );
@@ -1010,3 +1039,35 @@ void SV_RunCmd( sv_client_t *cl, usercmd_t *ucmd, int random_seed )
 		SV_RestoreMoveInterpolant( cl );
 	}
 }
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+void Test_RunUnlag( void )
+{
+	sv_unlag_t *unlag = Mem_Calloc( host.mempool, sizeof( *unlag ));
+	int i;
+
+	TASSERT_EQi( SV_FindUnlagFrame( unlag, 1.0 ), -1 );
+
+	// wrap around the history few times
+	for( i = 0; i < SV_UNLAG_HISTORY * 3 + 7; i++ )
+	{
+		unlag->frames[unlag->sequence & SV_UNLAG_MASK].time = i * 0.01;
+		unlag->sequence++;
+	}
+
+	TASSERT_EQi( SV_FindUnlagFrame( unlag, 0.0 ), -1 );
+	TASSERT_EQi( SV_FindUnlagFrame( unlag, ( unlag->sequence - SV_UNLAG_HISTORY ) * 0.01 ), -1 );
+	TASSERT_EQi( SV_FindUnlagFrame( unlag, ( unlag->sequence - SV_UNLAG_HISTORY ) * 0.01 + 0.005 ), unlag->sequence - SV_UNLAG_HISTORY );
+	TASSERT_EQi( SV_FindUnlagFrame( unlag, 1000.0 ), unlag->sequence - 1 );
+
+	for( i = unlag->sequence - SV_UNLAG_HISTORY; i < unlag->sequence - 1; i++ )
+	{
+		TASSERT_EQi( SV_FindUnlagFrame( unlag, i * 0.01 + 0.001 ), i );
+		TASSERT_EQi( SV_FindUnlagFrame( unlag, i * 0.01 + 0.009 ), i );
+	}
+
+	Mem_Free( unlag );
+}
+#endif // XASH_ENGINE_TESTS
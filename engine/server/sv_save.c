@@ -20,6 +20,11 @@ GNU General Public License for more details.
 #include "render_api.h"	// decallist_t
 #include "sound.h"		// S_GetDynamicSounds
 #include "ref_common.h" // decals
+#include "miniz.h"
+
+#if XASH_SDL == 2
+#include <SDL_thread.h>
+#endif
 
 /*
 ==============================================================================
@@ -32,6 +37,8 @@ half-life implementation of saverestore system
 #define SAVEGAME_HEADER		(('V'<<24)+('A'<<16)+('S'<<8)+'J')	// little-endian "JSAV"
 #define SAVEGAME_VERSION		0x0071				// Version 0.71 GoldSrc compatible
 #define CLIENT_SAVEGAME_VERSION	0x0067				// Version 0.67
+#define SAVEGAME_PACKED_HEADER	(('Z'<<24)+('V'<<16)+('S'<<8)+'J')	// little-endian "JSVZ"
+#define SAVEGAME_PACKED_VERSION	1				// deflated .sav stream follows the header
 
 #define SAVE_HEAPSIZE		0x400000				// reserve 4Mb for now
 #define SAVE_HASHSTRINGS		0xFFF				// 4095 unique strings
@@ -354,6 +361,281 @@ static void SaveBuildComment( char *text, int maxlength )
 	Q_snprintf( text, maxlength, "%-64.64s %02d:%02d", pName, (int)(sv.time / 60.0 ), (int)fmod( sv.time, 60.0 ));
 }
 
+/*
+==============================================================================
+LEVEL STATE STORE
+
+HL1-HL3 files written during transitions are kept in memory,
+they only go to the save folder when sv_levelstate_budget is exceeded
+==============================================================================
+*/
+typedef struct levelstate_s
+{
+	char		name[MAX_QPATH];	// e.g. save/c1a0.HL1
+	byte		*data;
+	size_t		size;
+	struct levelstate_s	*next;
+} levelstate_t;
+
+typedef struct levelfile_s
+{
+	file_t		*file;		// disk file, when not in memory
+	levelstate_t	*state;		// memory file to read
+	char		name[MAX_QPATH];	// memory file to write
+	byte		*data;
+	size_t		size;
+	size_t		maxsize;
+	size_t		pos;
+} levelfile_t;
+
+static levelstate_t	*sv_levelstates;	// oldest first
+static size_t	sv_levelstates_size;
+
+/*
+=============
+LevelStateFind
+=============
+*/
+static levelstate_t *LevelStateFind( const char *name, levelstate_t **prev )
+{
+	levelstate_t	*state, *last = NULL;
+
+	for( state = sv_levelstates; state; last = state, state = state->next )
+	{
+		if( !Q_stricmp( state->name, name ))
+			break;
+	}
+
+	if( prev ) *prev = last;
+
+	return state;
+}
+
+/*
+=============
+LevelStateRemove
+=============
+*/
+static void LevelStateRemove( levelstate_t *state, levelstate_t *prev )
+{
+	if( prev ) prev->next = state->next;
+	else sv_levelstates = state->next;
+
+	sv_levelstates_size -= state->size;
+	Mem_Free( state->data );
+	Mem_Free( state );
+}
+
+/*
+=============
+LevelStateSpill
+
+move level file from memory to save folder
+=============
+*/
+static qboolean LevelStateSpill( const char *name, const byte *data, size_t size )
+{
+	file_t	*pFile;
+
+	if(( pFile = FS_Open( name, "wb", true )) == NULL )
+	{
+		Con_Printf( S_ERROR "%s: can't open %s for write\n", __func__, name );
+		return false;
+	}
+
+	FS_Write( pFile, data, size );
+	FS_Close( pFile );
+
+	return true;
+}
+
+/*
+=============
+LevelStateStore
+
+keep level file in memory, oldest files are moved to disk to fit the budget
+=============
+*/
+static qboolean LevelStateStore( const char *name, byte *data, size_t size )
+{
+	size_t		budget = Q_max( sv_levelstate_budget.value, 0.0f ) * 1024 * 1024;
+	levelstate_t	*state, *prev;
+
+	if(( state = LevelStateFind( name, &prev )) != NULL )
+		LevelStateRemove( state, prev );
+
+	while( sv_levelstates && sv_levelstates_size + size > budget )
+	{
+		state = sv_levelstates;
+
+		if( !LevelStateSpill( state->name, state->data, state->size ))
+			break;
+
+		LevelStateRemove( state, NULL );
+	}
+
+	if( sv_levelstates_size + size > budget )
+	{
+		qboolean	success = LevelStateSpill( name, data, size );
+
+		Mem_Free( data );
+		return success;
+	}
+
+	// memory copy takes precedence, but don't keep stale file for the savegame
+	FS_Delete( name );
+
+	state = Mem_Calloc( host.mempool, sizeof( *state ));
+	Q_strncpy( state->name, name, sizeof( state->name ));
+	state->data = data;
+	state->size = size;
+
+	// append as newest
+	if( sv_levelstates )
+	{
+		for( prev = sv_levelstates; prev->next; prev = prev->next );
+		prev->next = state;
+	}
+	else sv_levelstates = state;
+
+	sv_levelstates_size += size;
+
+	return true;
+}
+
+/*
+=============
+LevelStateClear
+=============
+*/
+static void LevelStateClear( void )
+{
+	while( sv_levelstates )
+		LevelStateRemove( sv_levelstates, NULL );
+}
+
+/*
+=============
+LevelOpen
+
+open level file for reading or writing
+=============
+*/
+static levelfile_t *LevelOpen( const char *name, qboolean write )
+{
+	levelstate_t	*state = NULL, *prev;
+	file_t		*file = NULL;
+	levelfile_t	*pFile;
+
+	if( write )
+	{
+		if( sv_levelstate_budget.value <= 0.0f )
+		{
+			// nothing to keep in memory, older copy would shadow the new file
+			if(( state = LevelStateFind( name, &prev )) != NULL )
+			{
+				LevelStateRemove( state, prev );
+				state = NULL;
+			}
+
+			if(( file = FS_Open( name, "wb", true )) == NULL )
+				return NULL;
+		}
+	}
+	else if(( state = LevelStateFind( name, NULL )) == NULL )
+	{
+		if(( file = FS_Open( name, "rb", true )) == NULL )
+			return NULL;
+	}
+
+	pFile = Mem_Calloc( host.mempool, sizeof( *pFile ));
+	pFile->file = file;
+	pFile->state = state;
+
+	if( write && !file )
+		Q_strncpy( pFile->name, name, sizeof( pFile->name ));
+
+	return pFile;
+}
+
+/*
+=============
+LevelRead
+=============
+*/
+static int LevelRead( levelfile_t *pFile, void *buffer, int size )
+{
+	if( pFile->file )
+		return FS_Read( pFile->file, buffer, size );
+
+	size = Q_min( size, (int)( pFile->state->size - pFile->pos ));
+	memcpy( buffer, pFile->state->data + pFile->pos, size );
+	pFile->pos += size;
+
+	return size;
+}
+
+/*
+=============
+LevelWrite
+=============
+*/
+static void LevelWrite( levelfile_t *pFile, const void *buffer, int size )
+{
+	if( pFile->file )
+	{
+		FS_Write( pFile->file, buffer, size );
+		return;
+	}
+
+	if( pFile->size + size > pFile->maxsize )
+	{
+		pFile->maxsize = Q_max( pFile->maxsize * 2, pFile->size + size );
+		pFile->data = Mem_Realloc( host.mempool, pFile->data, pFile->maxsize );
+	}
+
+	memcpy( pFile->data + pFile->size, buffer, size );
+	pFile->size += size;
+}
+
+/*
+=============
+LevelClose
+
+written memory file is moved into the store
+=============
+*/
+static qboolean LevelClose( levelfile_t *pFile )
+{
+	qboolean	success = true;
+
+	if( pFile->file )
+		FS_Close( pFile->file );
+	else if( COM_CheckStringEmpty( pFile->name ))
+		success = LevelStateStore( pFile->name, pFile->data, pFile->size );
+
+	Mem_Free( pFile );
+
+	return success;
+}
+
+/*
+=============
+SV_LevelStateInfo_f
+=============
+*/
+void SV_LevelStateInfo_f( void )
+{
+	levelstate_t	*state;
+	int		count = 0;
+
+	for( state = sv_levelstates; state; state = state->next, count++ )
+		Con_Printf( "%s: %s\n", state->name, Q_memprint( state->size ));
+
+	Con_Printf( "%d level files, %s of %s budget\n", count, Q_memprint( sv_levelstates_size ),
+		Q_memprint( Q_max( sv_levelstate_budget.value, 0.0f ) * 1024 * 1024 ));
+}
+
 /*
 =============
 DirectoryCount
@@ -364,13 +646,17 @@ in save folder
 */
 static int DirectoryCount( const char *pPath )
 {
-	int	count;
-	search_t	*t;
+	levelstate_t	*state;
+	int		count = 0;
+	search_t		*t;
+
+	for( state = sv_levelstates; state; state = state->next )
+		count++;
 
 	t = FS_Search( pPath, true, true );	// lookup only in gamedir
-	if( !t ) return 0; // empty
+	if( !t ) return count; // empty
 
-	count = t->numfilenames;
+	count += t->numfilenames;
 	Mem_Free( t );
 
 	return count;
@@ -497,6 +783,8 @@ static void ClearSaveDir( void )
 	search_t	*t;
 	int	i;
 
+	LevelStateClear();
+
 	// just delete all HL? files
 	t = FS_Search( DEFAULT_SAVE_DIRECTORY "*.HL?", true, true );
 	if( !t ) return; // already empty
@@ -633,36 +921,386 @@ static void AgeSaveList( const char *pName, int count )
 	}
 }
 
+/*
+==============================================================================
+SAVE FILE STREAM
+
+packed saves are deflated legacy .sav images, the reader inflates them on the fly
+==============================================================================
+*/
+typedef struct savefile_s
+{
+	file_t	*file;
+	qboolean	packed;
+	qboolean	eof;		// no more packed input
+	mz_stream	stream;
+	byte	buffer[16384];	// packed input
+} savefile_t;
+
+/*
+=============
+SaveOpen
+
+open legacy or packed .sav file for reading
+=============
+*/
+static savefile_t *SaveOpen( const char *path )
+{
+	savefile_t	*pFile;
+	int		hdr[4];
+	file_t		*f;
+
+	if(( f = FS_Open( path, "rb", true )) == NULL )
+		return NULL;
+
+	pFile = Mem_Calloc( host.mempool, sizeof( *pFile ));
+	pFile->file = f;
+
+	// id, version, unpacked size, packed size
+	if( FS_Read( f, hdr, sizeof( hdr )) == sizeof( hdr ) && hdr[0] == SAVEGAME_PACKED_HEADER )
+	{
+		pFile->packed = true;
+
+		// unknown packing will be reported as corrupted save
+		if( hdr[1] != SAVEGAME_PACKED_VERSION || mz_inflateInit( &pFile->stream ) != MZ_OK )
+			pFile->eof = true;
+	}
+	else FS_Seek( f, 0, SEEK_SET );
+
+	return pFile;
+}
+
+/*
+=============
+SaveRead
+
+read from .sav file, missing data is zero filled
+=============
+*/
+static int SaveRead( savefile_t *pFile, void *buffer, int size )
+{
+	int	read, status;
+
+	if( size <= 0 )
+		return 0;
+
+	if( !pFile->packed )
+	{
+		read = FS_Read( pFile->file, buffer, size );
+	}
+	else
+	{
+		pFile->stream.next_out = buffer;
+		pFile->stream.avail_out = size;
+
+		while( pFile->stream.avail_out > 0 )
+		{
+			if( pFile->stream.avail_in == 0 && !pFile->eof )
+			{
+				int len = FS_Read( pFile->file, pFile->buffer, sizeof( pFile->buffer ));
+
+				if( len <= 0 )
+					pFile->eof = true;
+				pFile->stream.next_in = pFile->buffer;
+				pFile->stream.avail_in = Q_max( len, 0 );
+			}
+
+			status = mz_inflate( &pFile->stream, MZ_NO_FLUSH );
+
+			if( status == MZ_STREAM_END )
+				break;
+
+			if( status != MZ_OK && ( status != MZ_BUF_ERROR || pFile->eof ))
+				break;
+		}
+
+		read = size - pFile->stream.avail_out;
+	}
+
+	read = Q_max( read, 0 );
+
+	if( read < size )
+		memset( (byte *)buffer + read, 0, size - read );
+
+	return read;
+}
+
+/*
+=============
+SaveClose
+=============
+*/
+static void SaveClose( savefile_t *pFile )
+{
+	if( pFile->packed )
+		mz_inflateEnd( &pFile->stream );
+
+	FS_Close( pFile->file );
+	Mem_Free( pFile );
+}
+
+/*
+==============================================================================
+SAVE WRITER
+
+.sav image is collected on the main thread, then deflated and written
+in background into temporary file which replaces the save when it's done
+==============================================================================
+*/
+typedef struct savejob_s
+{
+	byte		*data;		// legacy .sav image
+	size_t		size;
+	byte		*packed;		// header and deflated image, NULL for legacy saves
+	size_t		packedsize;
+	char		tmppath[MAX_SYSPATH];
+	char		path[MAX_SYSPATH];
+	qboolean		success;
+	volatile qboolean	done;
+} savejob_t;
+
+static savejob_t	*save_job; // pending background save
+
+static void SaveWriterThread( void );
+
+#if XASH_SDL == 2
+#define create_thread( thread, pfn ) (( thread ) = SDL_CreateThread(( pfn ), "Savegame writer", NULL ))
+#define join_thread( x )     SDL_WaitThread(( x ), NULL )
+typedef SDL_Thread *thread_t;
+static int SaveWriterStart( void *unused )
+{
+	SaveWriterThread();
+	return 0;
+}
+#elif !XASH_WIN32
+#include <pthread.h>
+#define create_thread( thread, pfn ) !pthread_create( &( thread ), NULL, ( pfn ), NULL )
+#define join_thread( x )     pthread_join(( x ), NULL )
+typedef pthread_t thread_t;
+static void *SaveWriterStart( void *unused )
+{
+	SaveWriterThread();
+	return NULL;
+}
+#else // WIN32
+#include <windows.h>
+#define create_thread( thread, pfn ) (( thread ) = CreateThread( NULL, 0, ( pfn ), NULL, 0, NULL ))
+#define join_thread( x )     ( WaitForSingleObject(( x ), INFINITE ), CloseHandle(( x )))
+typedef HANDLE thread_t;
+static DWORD WINAPI SaveWriterStart( LPVOID unused )
+{
+	SaveWriterThread();
+	return 0;
+}
+#endif // !_WIN32
+
+static thread_t	save_thread;
+
+/*
+=============
+SaveWriterThread
+
+deflate and write the pending save
+=============
+*/
+static void SaveWriterThread( void )
+{
+	savejob_t		*job = save_job;
+	const byte	*out = job->data;
+	size_t		outsize = job->size;
+	FILE		*f;
+
+	if( job->packed )
+	{
+		mz_ulong	len = job->packedsize - sizeof( int ) * 4;
+
+		// fallback to legacy save if deflate was failed
+		if( mz_compress2( job->packed + sizeof( int ) * 4, &len, job->data, job->size, MZ_DEFAULT_LEVEL ) == MZ_OK )
+		{
+			int packedsize = len;
+
+			memcpy( job->packed + sizeof( int ) * 3, &packedsize, sizeof( int ));
+			out = job->packed;
+			outsize = len + sizeof( int ) * 4;
+		}
+	}
+
+	if(( f = fopen( job->tmppath, "wb" )) != NULL )
+	{
+		job->success = fwrite( out, 1, outsize, f ) == outsize;
+		job->success &= fclose( f ) == 0;
+	}
+
+	// replace the old save only when new one is complete
+	if( job->success )
+	{
+#if XASH_WIN32
+		job->success = MoveFileExA( job->tmppath, job->path, MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+		job->success = rename( job->tmppath, job->path ) == 0;
+#endif
+	}
+
+	if( !job->success )
+		remove( job->tmppath );
+
+	job->done = true;
+}
+
+
+/*
+=============
+SaveFreeJob
+=============
+*/
+static void SaveFreeJob( void )
+{
+	if( !save_job->success )
+		Con_Printf( S_ERROR "Couldn't write %s\n", save_job->path );
+
+	if( save_job->packed )
+		Mem_Free( save_job->packed );
+	Mem_Free( save_job->data );
+	Mem_Free( save_job );
+	save_job = NULL;
+}
+
+/*
+=============
+SV_FlushSaveGame
+
+release finished background save, or wait for it
+=============
+*/
+void SV_FlushSaveGame( qboolean wait )
+{
+	if( !save_job )
+		return;
+
+	if( !wait && !save_job->done )
+		return;
+
+	join_thread( save_thread );
+	SaveFreeJob();
+}
+
+/*
+=============
+SaveWriteAsync
+
+start writing .sav image, takes ownership of the data
+=============
+*/
+static qboolean SaveWriteAsync( const char *name, byte *data, size_t size )
+{
+	char		tmpname[MAX_QPATH];
+	const char	*path = NULL;
+	savejob_t		*job;
+	file_t		*f;
+
+	// create the file through filesystem to get it's real path
+	Q_snprintf( tmpname, sizeof( tmpname ), "%s.tmp", name );
+
+	if(( f = FS_Open( tmpname, "wb", true )) != NULL )
+	{
+		FS_Close( f );
+		path = FS_GetDiskPath( tmpname, true );
+	}
+
+	if( !path )
+	{
+		Con_Printf( S_ERROR "%s: can't open %s for write\n", __func__, name );
+		Mem_Free( data );
+		return false;
+	}
+
+	job = Mem_Calloc( host.mempool, sizeof( *job ));
+	job->data = data;
+	job->size = size;
+	Q_strncpy( job->tmppath, path, sizeof( job->tmppath ));
+	Q_strncpy( job->path, path, Q_min( sizeof( job->path ), Q_strlen( path ) - 3 )); // strip .tmp
+
+	if( sv_save_compress.value )
+	{
+		int	hdr[3] = { SAVEGAME_PACKED_HEADER, SAVEGAME_PACKED_VERSION, size };
+
+		job->packedsize = sizeof( int ) * 4 + mz_compressBound( size );
+		job->packed = Mem_Malloc( host.mempool, job->packedsize );
+		memcpy( job->packed, hdr, sizeof( hdr ));
+	}
+
+	save_job = job;
+
+	if( !create_thread( save_thread, SaveWriterStart ))
+	{
+		qboolean	success;
+
+		// can't spawn a thread, do it right now
+		SaveWriterThread();
+		success = save_job->success;
+		SaveFreeJob();
+
+		return success;
+	}
+
+	return true;
+}
+
 /*
 =============
 DirectoryCopy
 
-put the HL1-HL3 files into .sav file
+put the HL1-HL3 files into .sav image
 =============
 */
-static void DirectoryCopy( const char *pPath, file_t *pFile )
+static byte *DirectoryCopy( const char *pPath, byte *pData, size_t *pSize )
 {
-	char	szName[MAX_OSPATH];
-	int	i, fileSize;
-	file_t	*pCopy;
-	search_t	*t;
+	char		szName[MAX_OSPATH];
+	int		i, fileSize;
+	levelstate_t	*state;
+	file_t		*pCopy;
+	search_t		*t;
+
+	// level files kept in memory
+	for( state = sv_levelstates; state; state = state->next )
+	{
+		fileSize = state->size;
+		pData = Mem_Realloc( host.mempool, pData, *pSize + MAX_OSPATH + sizeof( int ) + fileSize );
+
+		memset( szName, 0, sizeof( szName ));
+		Q_strncpy( szName, COM_FileWithoutPath( state->name ), sizeof( szName ));
+		memcpy( pData + *pSize, szName, MAX_OSPATH );
+		memcpy( pData + *pSize + MAX_OSPATH, &fileSize, sizeof( int ));
+		memcpy( pData + *pSize + MAX_OSPATH + sizeof( int ), state->data, fileSize );
+		*pSize += MAX_OSPATH + sizeof( int ) + fileSize;
+	}
 
 	t = FS_Search( pPath, true, true );
-	if( !t ) return; // nothing to copy ?
+	if( !t ) return pData; // nothing to copy ?
 
 	for( i = 0; i < t->numfilenames; i++ )
 	{
 		pCopy = FS_Open( t->filenames[i], "rb", true );
-		fileSize = FS_FileLength( pCopy );
+		fileSize = pCopy ? FS_FileLength( pCopy ) : 0;
+
+		pData = Mem_Realloc( host.mempool, pData, *pSize + MAX_OSPATH + sizeof( int ) + fileSize );
 
 		memset( szName, 0, sizeof( szName )); // clearing the string to prevent garbage in output file
 		Q_strncpy( szName, COM_FileWithoutPath( t->filenames[i] ), sizeof( szName ));
-		FS_Write( pFile, szName, MAX_OSPATH );
-		FS_Write( pFile, &fileSize, sizeof( int ));
-		FS_FileCopy( pFile, pCopy, fileSize );
-		FS_Close( pCopy );
+		memcpy( pData + *pSize, szName, MAX_OSPATH );
+		memcpy( pData + *pSize + MAX_OSPATH, &fileSize, sizeof( int ));
+		*pSize += MAX_OSPATH + sizeof( int );
+
+		if( pCopy )
+		{
+			FS_Read( pCopy, pData + *pSize, fileSize );
+			FS_Close( pCopy );
+		}
+		*pSize += fileSize;
 	}
 	Mem_Free( t );
+
+	return pData;
 }
 
 /*
@@ -672,30 +1310,46 @@ DirectoryExtract
 extract the HL1-HL3 files from the .sav file
 =============
 */
-static qboolean DirectoryExtract( file_t *pFile, int fileCount )
+static qboolean DirectoryExtract( savefile_t *pFile, int fileCount )
 {
 	char	szName[MAX_OSPATH];
 	char	fileName[MAX_OSPATH];
-	int	i, fileSize;
-	file_t	*pCopy;
+	byte	buffer[16384];
+	int	i, fileSize, len;
+	levelfile_t	*pCopy;
 
 	for( i = 0; i < fileCount; i++ )
 	{
 		// filename can only be as long as a map name + extension
-		FS_Read( pFile, szName, MAX_OSPATH );
-		FS_Read( pFile, &fileSize, sizeof( int ));
+		SaveRead( pFile, szName, MAX_OSPATH );
+		SaveRead( pFile, &fileSize, sizeof( int ));
+		szName[MAX_OSPATH - 1] = '\0';
 		Q_snprintf( fileName, sizeof( fileName ), DEFAULT_SAVE_DIRECTORY "%s", szName );
 		COM_FixSlashes( fileName );
 
-		pCopy = FS_Open( fileName, "wb", true );
+		pCopy = LevelOpen( fileName, true );
 		if( !pCopy )
 		{
 			Con_Printf( S_ERROR "%s: can't open %s for write\n", __func__, fileName );
 			return false;
 		}
 
-		FS_FileCopy( pCopy, pFile, fileSize );
-		FS_Close( pCopy );
+		for( ; fileSize > 0; fileSize -= len )
+		{
+			len = Q_min( fileSize, (int)sizeof( buffer ));
+
+			if( SaveRead( pFile, buffer, len ) != len )
+			{
+				Con_Printf( S_ERROR "%s: %s is truncated\n", __func__, fileName );
+				LevelClose( pCopy );
+				return false;
+			}
+
+			LevelWrite( pCopy, buffer, len );
+		}
+
+		if( !LevelClose( pCopy ))
+			return false;
 	}
 
 	return true;
@@ -816,7 +1470,7 @@ BuildHashTable
 build the stringtable from buffer
 =============
 */
-static void BuildHashTable( SAVERESTOREDATA *pSaveData, file_t *pFile )
+static void BuildHashTable( SAVERESTOREDATA *pSaveData )
 {
 	char	*pszTokenList = pSaveData->pBaseData;
 	int	i;
@@ -824,8 +1478,6 @@ static void BuildHashTable( SAVERESTOREDATA *pSaveData, file_t *pFile )
 	// Parse the symbol table
 	if( pSaveData->tokenSize > 0 )
 	{
-		FS_Read( pFile, pszTokenList, pSaveData->tokenSize );
-
 		// make sure the token strings pointed to by the pToken hashtable.
 		for( i = 0; i < pSaveData->tokenCount; i++ )
 		{
@@ -852,31 +1504,31 @@ static int GetClientDataSize( const char *level )
 	int	tokenCount, tokenSize;
 	int	size, id, version;
 	char	name[MAX_QPATH];
-	file_t	*pFile;
+	levelfile_t	*pFile;
 
 	Q_snprintf( name, sizeof( name ), DEFAULT_SAVE_DIRECTORY "%s.HL2", level );
 
-	if(( pFile = FS_Open( name, "rb", true )) == NULL )
+	if(( pFile = LevelOpen( name, false )) == NULL )
 		return 0;
 
-	FS_Read( pFile, &id, sizeof( id ));
+	LevelRead( pFile, &id, sizeof( id ));
 	if( id != SAVEGAME_HEADER )
 	{
-		FS_Close( pFile );
+		LevelClose( pFile );
 		return 0;
 	}
 
-	FS_Read( pFile, &version, sizeof( version ));
+	LevelRead( pFile, &version, sizeof( version ));
 	if( version != CLIENT_SAVEGAME_VERSION )
 	{
-		FS_Close( pFile );
+		LevelClose( pFile );
 		return 0;
 	}
 
-	FS_Read( pFile, &size, sizeof( int ));
-	FS_Read( pFile, &tokenCount, sizeof( int ));
-	FS_Read( pFile, &tokenSize, sizeof( int ));
-	FS_Close( pFile );
+	LevelRead( pFile, &size, sizeof( int ));
+	LevelRead( pFile, &tokenCount, sizeof( int ));
+	LevelRead( pFile, &tokenSize, sizeof( int ));
+	LevelClose( pFile );
 
 	return ( size + tokenSize );
 }
@@ -898,33 +1550,33 @@ static SAVERESTOREDATA *LoadSaveData( const char *level )
 	int		clientSize;
 	SAVERESTOREDATA	*pSaveData;
 	int		totalSize;
-	file_t		*pFile;
+	levelfile_t		*pFile;
 
 	Q_snprintf( name, sizeof( name ), DEFAULT_SAVE_DIRECTORY "%s.HL1", level );
 	Con_Printf( "Loading game from %s...\n", name );
 
-	if(( pFile = FS_Open( name, "rb", true )) == NULL )
+	if(( pFile = LevelOpen( name, false )) == NULL )
 	{
 		Con_Printf( S_ERROR "Couldn't open save data file %s.\n", name );
 		return NULL;
 	}
 
 	// Read the header
-	FS_Read( pFile, &id, sizeof( int ));
-	FS_Read( pFile, &version, sizeof( int ));
+	LevelRead( pFile, &id, sizeof( int ));
+	LevelRead( pFile, &version, sizeof( int ));
 
 	// is this a valid save?
 	if( id != SAVEFILE_HEADER || version != SAVEGAME_VERSION )
 	{
-		FS_Close( pFile );
+		LevelClose( pFile );
 		return NULL;
 	}
 
 	// Read the sections info and the data
-	FS_Read( pFile, &size, sizeof( int ));		// total size of all data to initialize read buffer
-	FS_Read( pFile, &tableCount, sizeof( int ));	// entities count to right initialize entity table
-	FS_Read( pFile, &tokenCount, sizeof( int ));	// num hash tokens to prepare token table
-	FS_Read( pFile, &tokenSize, sizeof( int ));	// total size of hash tokens
+	LevelRead( pFile, &size, sizeof( int ));		// total size of all data to initialize read buffer
+	LevelRead( pFile, &tableCount, sizeof( int ));	// entities count to right initialize entity table
+	LevelRead( pFile, &tokenCount, sizeof( int ));	// num hash tokens to prepare token table
+	LevelRead( pFile, &tokenSize, sizeof( int ));	// total size of hash tokens
 
 	// determine highest size of seve-restore buffer
 	// because it's used twice: for HL1 and HL2 restore
@@ -940,15 +1592,16 @@ static SAVERESTOREDATA *LoadSaveData( const char *level )
 	pSaveData->tokenSize = tokenSize;
 
 	// Parse the symbol table
-	BuildHashTable( pSaveData, pFile );
+	LevelRead( pFile, pSaveData->pBaseData, tokenSize );
+	BuildHashTable( pSaveData );
 
 	// Set up the restore basis
 	pSaveData->fUseLandmark = true;
 	pSaveData->time = 0.0f;
 
 	// now reading all the rest of data
-	FS_Read( pFile, pSaveData->pBaseData, size );
-	FS_Close( pFile ); // data is sucessfully moved into SaveRestore buffer (ETABLE will be init later)
+	LevelRead( pFile, pSaveData->pBaseData, size );
+	LevelClose( pFile ); // data is sucessfully moved into SaveRestore buffer (ETABLE will be init later)
 
 	return pSaveData;
 }
@@ -1011,11 +1664,11 @@ static qboolean EntityPatchWrite( SAVERESTOREDATA *pSaveData, const char *level
 {
 	char	name[MAX_QPATH];
 	int	i, size = 0;
-	file_t	*pFile;
+	levelfile_t	*pFile;
 
 	Q_snprintf( name, sizeof( name ), DEFAULT_SAVE_DIRECTORY "%s.HL3", level );
 
-	if(( pFile = FS_Open( name, "wb", true )) == NULL )
+	if(( pFile = LevelOpen( name, true )) == NULL )
 	{
 		Con_Printf( S_ERROR "%s: can't open %s for write\n", __func__, name );
 		return false;
@@ -1028,17 +1681,15 @@ static qboolean EntityPatchWrite( SAVERESTOREDATA *pSaveData, const char *level
 	}
 
 	// patch count
-	FS_Write( pFile, &size, sizeof( int ));
+	LevelWrite( pFile, &size, sizeof( int ));
 
 	for( i = 0; i < pSaveData->tableCount; i++ )
 	{
 		if( FBitSet( pSaveData->pTable[i].flags, FENTTABLE_REMOVED ))
-			FS_Write( pFile, &i, sizeof( int ));
+			LevelWrite( pFile, &i, sizeof( int ));
 	}
 
-	FS_Close( pFile );
-
-	return true;
+	return LevelClose( pFile );
 }
 
 /*
@@ -1053,23 +1704,23 @@ static void EntityPatchRead( SAVERESTOREDATA *pSaveData, const char *level )
 {
 	char	name[MAX_QPATH];
 	int	i, size, entityId;
-	file_t	*pFile;
+	levelfile_t	*pFile;
 
 	Q_snprintf( name, sizeof( name ), DEFAULT_SAVE_DIRECTORY "%s.HL3", level );
 
-	if(( pFile = FS_Open( name, "rb", true )) == NULL )
+	if(( pFile = LevelOpen( name, false )) == NULL )
 		return;
 
 	// patch count
-	FS_Read( pFile, &size, sizeof( int ));
+	LevelRead( pFile, &size, sizeof( int ));
 
 	for( i = 0; i < size; i++ )
 	{
-		FS_Read( pFile, &entityId, sizeof( int ));
+		LevelRead( pFile, &entityId, sizeof( int ));
 		pSaveData->pTable[entityId].flags = FENTTABLE_REMOVED;
 	}
 
-	FS_Close( pFile );
+	LevelClose( pFile );
 }
 
 /*
@@ -1189,7 +1840,7 @@ static qboolean SaveClientState( SAVERESTOREDATA *pSaveData, const char *level,
 	char		*pTokenData;
 	decallist_t	*decalList = NULL;
 	SAVE_CLIENT	header = { 0 };
-	file_t		*pFile;
+	levelfile_t		*pFile;
 
 	// clearing the saving buffer to reuse
 	SaveClear( pSaveData );
@@ -1255,7 +1906,7 @@ static qboolean SaveClientState( SAVERESTOREDATA *pSaveData, const char *level,
 	Q_snprintf( name, sizeof( name ), DEFAULT_SAVE_DIRECTORY "%s.HL2", level );
 
 	// output to disk
-	if(( pFile = FS_Open( name, "wb", true )) == NULL )
+	if(( pFile = LevelOpen( name, true )) == NULL )
 	{
 		Con_Printf( S_ERROR "%s: can't open %s for write\n", __func__, name );
 		return false;
@@ -1264,18 +1915,17 @@ static qboolean SaveClientState( SAVERESTOREDATA *pSaveData, const char *level,
 	version = CLIENT_SAVEGAME_VERSION;
 	id = SAVEGAME_HEADER;
 
-	FS_Write( pFile, &id, sizeof( id ));
-	FS_Write( pFile, &version, sizeof( version ));
-	FS_Write( pFile, &pSaveData->size, sizeof( int )); // does not include token table
+	LevelWrite( pFile, &id, sizeof( id ));
+	LevelWrite( pFile, &version, sizeof( version ));
+	LevelWrite( pFile, &pSaveData->size, sizeof( int )); // does not include token table
 
 	// write out the tokens first so we can load them before we load the entities
-	FS_Write( pFile, &pSaveData->tokenCount, sizeof( int ));
-	FS_Write( pFile, &pSaveData->tokenSize, sizeof( int ));
-	FS_Write( pFile, pTokenData, pSaveData->tokenSize );
-	FS_Write( pFile, pSaveData->pBaseData, pSaveData->size ); // header and globals
-	FS_Close( pFile );
+	LevelWrite( pFile, &pSaveData->tokenCount, sizeof( int ));
+	LevelWrite( pFile, &pSaveData->tokenSize, sizeof( int ));
+	LevelWrite( pFile, pTokenData, pSaveData->tokenSize );
+	LevelWrite( pFile, pSaveData->pBaseData, pSaveData->size ); // header and globals
 
-	return true;
+	return LevelClose( pFile );
 }
 
 /*
@@ -1294,30 +1944,30 @@ static void LoadClientState( SAVERESTOREDATA *pSaveData, const char *level, qboo
 	soundlist_t	soundEntry;
 	decallist_t	decalEntry;
 	SAVE_CLIENT	header;
-	file_t		*pFile;
+	levelfile_t		*pFile;
 
 	Q_snprintf( name, sizeof( name ), DEFAULT_SAVE_DIRECTORY "%s.HL2", level );
 
-	if(( pFile = FS_Open( name, "rb", true )) == NULL )
+	if(( pFile = LevelOpen( name, false )) == NULL )
 		return; // something bad is happens
 
-	FS_Read( pFile, &id, sizeof( id ));
+	LevelRead( pFile, &id, sizeof( id ));
 	if( id != SAVEGAME_HEADER )
 	{
-		FS_Close( pFile );
+		LevelClose( pFile );
 		return;
 	}
 
-	FS_Read( pFile, &version, sizeof( version ));
+	LevelRead( pFile, &version, sizeof( version ));
 	if( version != CLIENT_SAVEGAME_VERSION )
 	{
-		FS_Close( pFile );
+		LevelClose( pFile );
 		return;
 	}
 
-	FS_Read( pFile, &size, sizeof( int ));
-	FS_Read( pFile, &tokenCount, sizeof( int ));
-	FS_Read( pFile, &tokenSize, sizeof( int ));
+	LevelRead( pFile, &size, sizeof( int ));
+	LevelRead( pFile, &tokenCount, sizeof( int ));
+	LevelRead( pFile, &tokenSize, sizeof( int ));
 
 	// sanity check
 	ASSERT( pSaveData->bufferSize >= ( size + tokenSize ));
@@ -1328,10 +1978,11 @@ static void LoadClientState( SAVERESTOREDATA *pSaveData, const char *level, qboo
 	pSaveData->tokenSize = tokenSize;
 
 	// Parse the symbol table
-	BuildHashTable( pSaveData, pFile );
+	LevelRead( pFile, pSaveData->pBaseData, tokenSize );
+	BuildHashTable( pSaveData );
 
-	FS_Read( pFile, pSaveData->pBaseData, size );
-	FS_Close( pFile );
+	LevelRead( pFile, pSaveData->pBaseData, size );
+	LevelClose( pFile );
 
 	// Read the client header
 	svgame.dllFuncs.pfnSaveReadFields( pSaveData, "ClientHeader", &header, gSaveClient, ARRAYSIZE( gSaveClient ));
@@ -1474,7 +2125,7 @@ static SAVERESTOREDATA *SaveGameState( int changelevel )
 	ENTITYTABLE	*pTable;
 	SAVE_HEADER	header;
 	SAVE_LIGHTSTYLE	light;
-	file_t		*pFile;
+	levelfile_t		*pFile;
 
 	if( !svgame.dllFuncs.pfnParmsChangeLevel )
 		return NULL;
@@ -1573,7 +2224,7 @@ static SAVERESTOREDATA *SaveGameState( int changelevel )
 	pTokenData = StoreHashTable( pSaveData );
 
 	// output to disk
-	if(( pFile = FS_Open( name, "wb", true )) == NULL )
+	if(( pFile = LevelOpen( name, true )) == NULL )
 	{
 		Con_Printf( S_ERROR "%s: can't open %s for write\n", __func__, name );
 		SaveFinish( pSaveData );
@@ -1586,18 +2237,23 @@ static SAVERESTOREDATA *SaveGameState( int changelevel )
 	id = SAVEFILE_HEADER;
 
 	// write the header
-	FS_Write( pFile, &id, sizeof( id ));
-	FS_Write( pFile, &version, sizeof( version ));
+	LevelWrite( pFile, &id, sizeof( id ));
+	LevelWrite( pFile, &version, sizeof( version ));
 
 	// Write out the tokens and table FIRST so they are loaded in the right order, then write out the rest of the data in the file.
-	FS_Write( pFile, &pSaveData->size, sizeof( int ));	// total size of all data to initialize read buffer
-	FS_Write( pFile, &pSaveData->tableCount, sizeof( int ));	// entities count to right initialize entity table
-	FS_Write( pFile, &pSaveData->tokenCount, sizeof( int ));	// num hash tokens to prepare token table
-	FS_Write( pFile, &pSaveData->tokenSize, sizeof( int ));	// total size of hash tokens
-	FS_Write( pFile, pTokenData, pSaveData->tokenSize );	// write tokens into the file
-	FS_Write( pFile, pTableData, tableSize );		// dump ETABLE structures
-	FS_Write( pFile, pSaveData->pBaseData, dataSize );	// and finally store all the other data
-	FS_Close( pFile );
+	LevelWrite( pFile, &pSaveData->size, sizeof( int ));	// total size of all data to initialize read buffer
+	LevelWrite( pFile, &pSaveData->tableCount, sizeof( int ));	// entities count to right initialize entity table
+	LevelWrite( pFile, &pSaveData->tokenCount, sizeof( int ));	// num hash tokens to prepare token table
+	LevelWrite( pFile, &pSaveData->tokenSize, sizeof( int ));	// total size of hash tokens
+	LevelWrite( pFile, pTokenData, pSaveData->tokenSize );	// write tokens into the file
+	LevelWrite( pFile, pTableData, tableSize );		// dump ETABLE structures
+	LevelWrite( pFile, pSaveData->pBaseData, dataSize );	// and finally store all the other data
+
+	if( !LevelClose( pFile ))
+	{
+		SaveFinish( pSaveData );
+		return NULL;
+	}
 
 	if( !EntityPatchWrite( pSaveData, sv.name ))
 	{
@@ -1705,7 +2361,11 @@ static qboolean SaveGameSlot( const char *pSaveName, const char *pSaveComment )
 	char		*pTokenData;
 	SAVERESTOREDATA	*pSaveData;
 	GAME_HEADER	gameHeader;
-	file_t		*pFile;
+	byte		*pData;
+	size_t		size;
+
+	// previous save must be completed before the list is aged
+	SV_FlushSaveGame( true );
 
 	pSaveData = SaveGameState( false );
 	if( !pSaveData )
@@ -1737,34 +2397,33 @@ static qboolean SaveGameSlot( const char *pSaveName, const char *pSaveComment )
 	else if( !Q_stricmp( pSaveName, "autosave" ))
 		AgeSaveList( pSaveName, GI->autosave_aged_count );
 
-	// output to disk
-	if(( pFile = FS_Open( name, "wb", true )) == NULL )
-	{
-		Con_Printf( S_ERROR "%s: can't open %s for write\n", __func__, name );
-		SaveFinish( pSaveData );
-		return false;
-	}
-
-	// pending the preview image for savegame
-	Cbuf_AddTextf( "saveshot \"%s\"\n", pSaveName );
-	Con_Printf( "Saving game to %s...\n", name );
-
 	version = SAVEGAME_VERSION;
 	id = SAVEGAME_HEADER;
 
-	FS_Write( pFile, &id, sizeof( id ));
-	FS_Write( pFile, &version, sizeof( version ));
-	FS_Write( pFile, &pSaveData->size, sizeof( int )); // does not include token table
+	// snapshot the whole save, disk output is done in background
+	size = sizeof( int ) * 5 + pSaveData->tokenSize + pSaveData->size;
+	pData = Mem_Malloc( host.mempool, size );
+
+	memcpy( pData, &id, sizeof( id ));
+	memcpy( pData + 4, &version, sizeof( version ));
+	memcpy( pData + 8, &pSaveData->size, sizeof( int )); // does not include token table
 
 	// write out the tokens first so we can load them before we load the entities
-	FS_Write( pFile, &pSaveData->tokenCount, sizeof( int ));
-	FS_Write( pFile, &pSaveData->tokenSize, sizeof( int ));
-	FS_Write( pFile, pTokenData, pSaveData->tokenSize );
-	FS_Write( pFile, pSaveData->pBaseData, pSaveData->size ); // header and globals
+	memcpy( pData + 12, &pSaveData->tokenCount, sizeof( int ));
+	memcpy( pData + 16, &pSaveData->tokenSize, sizeof( int ));
+	memcpy( pData + 20, pTokenData, pSaveData->tokenSize );
+	memcpy( pData + 20 + pSaveData->tokenSize, pSaveData->pBaseData, pSaveData->size ); // header and globals
 
-	DirectoryCopy( hlPath, pFile );
+	pData = DirectoryCopy( hlPath, pData, &size );
 	SaveFinish( pSaveData );
-	FS_Close( pFile );
+
+	// output to disk
+	if( !SaveWriteAsync( name, pData, size ))
+		return false;
+
+	// pending the preview image for savegame
+	Cbuf_AddTextf( "saveshot \"%s\"\n", pSaveName );
+	Con_Printf( "Saving game to %s...\n", name );
 
 	return true;
 }
@@ -1776,42 +2435,40 @@ SaveReadHeader
 read header of .sav file
 =============
 */
-static int SaveReadHeader( file_t *pFile, GAME_HEADER *pHeader )
+static int SaveReadHeader( savefile_t *pFile, GAME_HEADER *pHeader )
 {
 	int		tokenCount, tokenSize;
 	int		size, id, version;
 	SAVERESTOREDATA	*pSaveData;
 
-	FS_Read( pFile, &id, sizeof( id ));
+	SaveRead( pFile, &id, sizeof( id ));
 	if( id != SAVEGAME_HEADER )
-	{
-		FS_Close( pFile );
 		return 0;
-	}
 
-	FS_Read( pFile, &version, sizeof( version ));
+	SaveRead( pFile, &version, sizeof( version ));
 	if( version != SAVEGAME_VERSION )
-	{
-		FS_Close( pFile );
 		return 0;
-	}
 
-	FS_Read( pFile, &size, sizeof( int ));
-	FS_Read( pFile, &tokenCount, sizeof( int ));
-	FS_Read( pFile, &tokenSize, sizeof( int ));
+	SaveRead( pFile, &size, sizeof( int ));
+	SaveRead( pFile, &tokenCount, sizeof( int ));
+	SaveRead( pFile, &tokenSize, sizeof( int ));
+
+	if( size < 0 || tokenSize < 0 || tokenSize > SAVE_HEAPSIZE || tokenCount < 0 || tokenCount > SAVE_HASHSTRINGS )
+		return 0;
 
 	pSaveData = SaveInit( size + tokenSize, tokenCount );
 	pSaveData->tokenCount = tokenCount;
 	pSaveData->tokenSize = tokenSize;
 
 	// Parse the symbol table
-	BuildHashTable( pSaveData, pFile );
+	SaveRead( pFile, pSaveData->pBaseData, tokenSize );
+	BuildHashTable( pSaveData );
 
 	// Set up the restore basis
 	pSaveData->fUseLandmark = false;
 	pSaveData->time = 0.0f;
 
-	FS_Read( pFile, pSaveData->pBaseData, size );
+	SaveRead( pFile, pSaveData->pBaseData, size );
 
 	svgame.dllFuncs.pfnSaveReadFields( pSaveData, "GameHeader", pHeader, gGameHeader, ARRAYSIZE( gGameHeader ));
 
@@ -2121,7 +2778,7 @@ qboolean SV_LoadGame( const char *pPath )
 {
 	qboolean		validload = false;
 	GAME_HEADER	gameHeader;
-	file_t		*pFile;
+	savefile_t	*pFile;
 	uint		flags;
 
 	if( Host_IsDedicated() )
@@ -2133,6 +2790,9 @@ qboolean SV_LoadGame( const char *pPath )
 	if( !COM_CheckString( pPath ))
 		return false;
 
+	// wait for the save is going to be loaded
+	SV_FlushSaveGame( true );
+
 	// silently ignore if missed
 	if( !FS_FileExists( pPath, true ))
 		return false;
@@ -2142,7 +2802,7 @@ qboolean SV_LoadGame( const char *pPath )
 		return false;
 
 	svs.initialized = true;
-	pFile = FS_Open( pPath, "rb", true );
+	pFile = SaveOpen( pPath );
 
 	if( pFile )
 	{
@@ -2151,7 +2811,7 @@ qboolean SV_LoadGame( const char *pPath )
 		if( SaveReadHeader( pFile, &gameHeader ))
 			validload = DirectoryExtract( pFile, gameHeader.mapCount );
 
-		FS_Close( pFile );
+		SaveClose( pFile );
 
 		if( validload )
 		{
@@ -2261,6 +2921,8 @@ const char *SV_GetLatestSave( void )
 	int		i, found = 0;
 	search_t		*t;
 
+	SV_FlushSaveGame( true );
+
 	if(( t = FS_Search( DEFAULT_SAVE_DIRECTORY "*.sav" , true, true )) == NULL )
 		return NULL;
 
@@ -2300,37 +2962,40 @@ int GAME_EXPORT SV_GetSaveComment( const char *savename, char *comment )
 	int	i, tag, size, nNumberOfFields, nFieldSize, tokenSize, tokenCount;
 	char	*pData, *pSaveData, *pFieldName, **pTokenList;
 	string	mapName, description;
-	file_t	*f;
+	savefile_t	*f;
 
-	if(( f = FS_Open( savename, "rb", true )) == NULL )
+	// don't miss the save which is being written
+	SV_FlushSaveGame( true );
+
+	if(( f = SaveOpen( savename )) == NULL )
 	{
 		// just not exist - clear comment
 		comment[0] = '\0';
 		return 0;
 	}
 
-	FS_Read( f, &tag, sizeof( int ));
+	SaveRead( f, &tag, sizeof( int ));
 	if( tag != SAVEGAME_HEADER )
 	{
 		// invalid header
 		Q_strncpy( comment, "<corrupted>", MAX_STRING );
-		FS_Close( f );
+		SaveClose( f );
 		return 0;
 	}
 
-	FS_Read( f, &tag, sizeof( int ));
+	SaveRead( f, &tag, sizeof( int ));
 
 	if( tag == 0x0065 )
 	{
 		Q_strncpy( comment, "<old version "XASH_ENGINE_NAME" unsupported>", MAX_STRING );
-		FS_Close( f );
+		SaveClose( f );
 		return 0;
 	}
 
 	if( tag < SAVEGAME_VERSION )
 	{
 		Q_strncpy( comment, "<old version>", MAX_STRING );
-		FS_Close( f );
+		SaveClose( f );
 		return 0;
 	}
 
@@ -2338,35 +3003,35 @@ int GAME_EXPORT SV_GetSaveComment( const char *savename, char *comment )
 	{
 		// old xash version ?
 		Q_strncpy( comment, "<invalid version>", MAX_STRING );
-		FS_Close( f );
+		SaveClose( f );
 		return 0;
 	}
 
 	mapName[0] = '\0';
 	comment[0] = '\0';
 
-	FS_Read( f, &size, sizeof( int ));
-	FS_Read( f, &tokenCount, sizeof( int ));	// These two ints are the token list
-	FS_Read( f, &tokenSize, sizeof( int ));
+	SaveRead( f, &size, sizeof( int ));
+	SaveRead( f, &tokenCount, sizeof( int ));	// These two ints are the token list
+	SaveRead( f, &tokenSize, sizeof( int ));
 	size += tokenSize;
 
 	// sanity check.
 	if( tokenCount < 0 || tokenCount > SAVE_HASHSTRINGS )
 	{
 		Q_strncpy( comment, "<corrupted hashtable>", MAX_STRING );
-		FS_Close( f );
+		SaveClose( f );
 		return 0;
 	}
 
 	if( tokenSize < 0 || tokenSize > SAVE_HEAPSIZE )
 	{
 		Q_strncpy( comment, "<corrupted hashtable>", MAX_STRING );
-		FS_Close( f );
+		SaveClose( f );
 		return 0;
 	}
 
 	pSaveData = (char *)Mem_Malloc( host.mempool, size );
-	FS_Read( f, pSaveData, size );
+	SaveRead( f, pSaveData, size );
 	pData = pSaveData;
 
 	// allocate a table for the strings, and parse the table
@@ -2393,7 +3058,7 @@ int GAME_EXPORT SV_GetSaveComment( const char *savename, char *comment )
 		Q_strncpy( comment, "<missing GameHeader>", MAX_STRING );
 		if( pTokenList ) Mem_Free( pTokenList );
 		if( pSaveData ) Mem_Free( pSaveData );
-		FS_Close( f );
+		SaveClose( f );
 		return 0;
 	}
 
@@ -2434,7 +3099,7 @@ int GAME_EXPORT SV_GetSaveComment( const char *savename, char *comment )
 	// delete the string table we allocated
 	if( pTokenList ) Mem_Free( pTokenList );
 	if( pSaveData ) Mem_Free( pSaveData );
-	FS_Close( f );
+	SaveClose( f );
 
 	// at least mapname should be filled
 	if( COM_CheckStringEmpty( mapName ) )
@@ -2486,3 +3151,148 @@ void SV_InitSaveRestore( void )
 {
 	pfnSaveGameComment = COM_GetProcAddress( svgame.hInstance, "SV_SaveGameComment" );
 }
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+static void Test_SaveStream( qboolean packed )
+{
+	const char	*name = DEFAULT_SAVE_DIRECTORY "test_stream.sav";
+	size_t		i, size = 300000;
+	byte		*data, *check;
+	savefile_t	*pFile;
+	float		compress = sv_save_compress.value;
+
+	data = Mem_Malloc( host.mempool, size );
+	check = Mem_Malloc( host.mempool, size + 16 );
+
+	for( i = 0; i < size; i++ )
+		data[i] = ( i * 7 ) ^ ( i >> 9 );
+	memcpy( check, data, size );
+
+	sv_save_compress.value = packed;
+	TASSERT( SaveWriteAsync( name, data, size )); // takes ownership of data
+	SV_FlushSaveGame( true );
+	sv_save_compress.value = compress;
+
+	TASSERT( !FS_FileExists( DEFAULT_SAVE_DIRECTORY "test_stream.sav.tmp", true ));
+	TASSERT(( pFile = SaveOpen( name )) != NULL );
+
+	if( pFile )
+	{
+		byte	*read = Mem_Malloc( host.mempool, size + 16 );
+
+		TASSERT_EQi( pFile->packed, packed );
+		if( packed )
+		{
+			TASSERT( FS_FileLength( pFile->file ) < size );
+		}
+
+		// read in odd chunks to cross the packed input buffer
+		for( i = 0; i < size; i += 1000 )
+			TASSERT_EQi( SaveRead( pFile, read + i, Q_min( 1000, size - i )), Q_min( 1000, size - i ));
+		TASSERT( !memcmp( read, check, size ));
+
+		// reading past the end is zero filled
+		memset( read, 0xff, 16 );
+		TASSERT_EQi( SaveRead( pFile, read, 16 ), 0 );
+		TASSERT( read[0] == 0 && read[15] == 0 );
+
+		SaveClose( pFile );
+		Mem_Free( read );
+	}
+
+	FS_Delete( name );
+	Mem_Free( check );
+}
+
+static void Test_LevelFile( const char *name, int seed, qboolean write )
+{
+	byte		data[80];
+	levelfile_t	*pFile;
+	int		i;
+
+	if(( pFile = LevelOpen( name, write )) == NULL )
+	{
+		TASSERT( pFile != NULL );
+		return;
+	}
+
+	if( write )
+	{
+		for( i = 0; i < sizeof( data ); i++ )
+			data[i] = seed + i;
+
+		LevelWrite( pFile, data, 40 );
+		LevelWrite( pFile, data + 40, 40 );
+	}
+	else
+	{
+		TASSERT_EQi( LevelRead( pFile, data, sizeof( data )), sizeof( data ));
+		TASSERT_EQi( LevelRead( pFile, data, sizeof( data )), 0 );
+
+		for( i = 0; i < sizeof( data ); i++ )
+			TASSERT_EQi( data[i], (byte)( seed + i ));
+	}
+
+	TASSERT( LevelClose( pFile ));
+}
+
+static void Test_LevelStateStore( void )
+{
+	float	budget = sv_levelstate_budget.value;
+
+	ClearSaveDir();
+
+	// room for one file only
+	sv_levelstate_budget.value = 100.0f / ( 1024 * 1024 );
+
+	Test_LevelFile( DEFAULT_SAVE_DIRECTORY "test1.HL1", 1, true );
+	TASSERT( sv_levelstates != NULL );
+	TASSERT( !FS_FileExists( DEFAULT_SAVE_DIRECTORY "test1.HL1", true ));
+
+	// oldest file goes to disk
+	Test_LevelFile( DEFAULT_SAVE_DIRECTORY "test2.HL1", 2, true );
+	TASSERT( FS_FileExists( DEFAULT_SAVE_DIRECTORY "test1.HL1", true ));
+	TASSERT( sv_levelstates && !sv_levelstates->next );
+
+	// rewrite replaces the stored copy
+	Test_LevelFile( DEFAULT_SAVE_DIRECTORY "test2.HL1", 3, true );
+	TASSERT_EQi( sv_levelstates_size, 80 );
+
+	Test_LevelFile( DEFAULT_SAVE_DIRECTORY "test1.HL1", 1, false );
+	Test_LevelFile( DEFAULT_SAVE_DIRECTORY "test2.HL1", 3, false );
+
+	// disabled store keeps everything on disk
+	sv_levelstate_budget.value = 0.0f;
+	Test_LevelFile( DEFAULT_SAVE_DIRECTORY "test3.HL1", 4, true );
+	TASSERT( FS_FileExists( DEFAULT_SAVE_DIRECTORY "test3.HL1", true ));
+
+	// same level saved with the store on, then off, disk copy wins
+	sv_levelstate_budget.value = 100.0f / ( 1024 * 1024 );
+	Test_LevelFile( DEFAULT_SAVE_DIRECTORY "test4.HL1", 5, true );
+	TASSERT( LevelStateFind( DEFAULT_SAVE_DIRECTORY "test4.HL1", NULL ) != NULL );
+	sv_levelstate_budget.value = 0.0f;
+	Test_LevelFile( DEFAULT_SAVE_DIRECTORY "test4.HL1", 6, true );
+	TASSERT( LevelStateFind( DEFAULT_SAVE_DIRECTORY "test4.HL1", NULL ) == NULL );
+	Test_LevelFile( DEFAULT_SAVE_DIRECTORY "test4.HL1", 6, false );
+
+	ClearSaveDir();
+	TASSERT( sv_levelstates == NULL );
+	FS_Delete( DEFAULT_SAVE_DIRECTORY "test1.HL1" );
+	FS_Delete( DEFAULT_SAVE_DIRECTORY "test3.HL1" );
+	FS_Delete( DEFAULT_SAVE_DIRECTORY "test4.HL1" );
+
+	sv_levelstate_budget.value = budget;
+}
+
+void Test_RunSaveFile( void )
+{
+	// there is no game directory in tests
+	FS_AllowDirectPaths( true );
+	TRUN( Test_SaveStream( false ));
+	TRUN( Test_SaveStream( true ));
+	TRUN( Test_LevelStateStore( ));
+	FS_AllowDirectPaths( false );
+}
+#endif // XASH_ENGINE_TESTS
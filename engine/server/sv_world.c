@@ -32,6 +32,31 @@ typedef struct moveclip_s
 	qboolean		monsterclip;
 } moveclip_t;
 
+#define LIGHTCELL_SIZE		8	// horizontal cell size, half of default lightmap sample
+#define LIGHTCELL_HEIGHT	4
+#define LIGHTCACHE_SIZE		8192	// must be power of 2
+#define LIGHTCACHE_MASK		( LIGHTCACHE_SIZE - 1 )
+
+#define LIGHTCELL_VALID		BIT( 0 )
+#define LIGHTCELL_INVLIGHT	BIT( 1 )	// sampled upwards
+#define LIGHTCELL_LIT		BIT( 2 )	// surface with lightmap was hit
+
+// unscaled lightmap samples, lightstyles are applied at lookup
+typedef struct lightsample_s
+{
+	int	flags;
+	byte	styles[MAXLIGHTMAPS];
+	color24	samples[MAXLIGHTMAPS];
+} lightsample_t;
+
+typedef struct lightcell_s
+{
+	int		cell[3];
+	lightsample_t	light;
+} lightcell_t;
+
+static lightcell_t	sv_lightcells[LIGHTCACHE_SIZE];
+
 /*
 ===============================================================================
 
@@ -476,6 +501,8 @@ void SV_ClearWorld( void )
 		sv.lightstyles[i].time = 0.0f;
 	}
 
+	memset( sv_lightcells, 0, sizeof( sv_lightcells ));
+
 	memset( sv_areanodes, 0, sizeof( sv_areanodes ));
 	iTouchLinkSemaphore = 0;
 	sv_numareanodes = 0;
@@ -571,6 +598,7 @@ static void SV_TouchLinks( edict_t *ent, areanode_t *node )
 		if( !sv.playersonly )
 		{
 			svgame.globals->time = sv.time;
+			SV_WakeEdict( touch );
 			svgame.dllFuncs.pfnTouch( touch, ent );
 		}
 	}
@@ -646,6 +674,8 @@ void GAME_EXPORT SV_LinkEdict( edict_t *ent, qboolean touch_triggers )
 	if( ent == svgame.edicts ) return;		// don't add the world
 	if( !SV_IsValidEdict( ent )) return;		// never add freed ents
 
+	SV_WakeEdict( ent );
+
 	// set the abs box
 	svgame.dllFuncs.pfnSetAbsBox( ent );
 
@@ -1513,7 +1543,7 @@ trace_t SV_MoveToss( edict_t *tossent, edict_t *ignore )
 SV_RecursiveLightPoint
 =================
 */
-static qboolean SV_RecursiveLightPoint( model_t *model, mnode_t *node, const vec3_t start, const vec3_t end, vec3_t point_color )
+static qboolean SV_RecursiveLightPoint( model_t *model, mnode_t *node, const vec3_t start, const vec3_t end, lightsample_t *light )
 {
 	float front, back, frac;
 	int i, side;
@@ -1533,14 +1563,14 @@ static qboolean SV_RecursiveLightPoint( model_t *model, mnode_t *node, const vec
 
 	side = front < 0.0f;
 	if(( back < 0.0f ) == side )
-		return SV_RecursiveLightPoint( model, children[side], start, end, point_color );
+		return SV_RecursiveLightPoint( model, children[side], start, end, light );
 
 	frac = front / ( front - back );
 
 	VectorLerp( start, frac, end, mid );
 
 	// co down front side
-	if( SV_RecursiveLightPoint( model, children[side], start, mid, point_color ))
+	if( SV_RecursiveLightPoint( model, children[side], start, mid, light ))
 		return true; // hit something
 
 	if(( back < 0.0f ) == side )
@@ -1582,19 +1612,19 @@ static qboolean SV_RecursiveLightPoint( model_t *model, mnode_t *node, const vec
 		ds /= sample_size;
 		dt /= sample_size;
 
-		VectorClear( point_color );
+		SetBits( light->flags, LIGHTCELL_LIT );
 
 		lm = surf->samples + Q_rint( dt ) * smax + Q_rint( ds );
 		size = smax * tmax;
 
-		for( map = 0; map < MAXLIGHTMAPS && surf->styles[map] != 255; map++ )
+		for( map = 0; map < MAXLIGHTMAPS; map++ )
 		{
-			float scale = sv.lightstyles[surf->styles[map]].value;
+			light->styles[map] = surf->styles[map];
 
-			point_color[0] += lm->r * scale;
-			point_color[1] += lm->g * scale;
-			point_color[2] += lm->b * scale;
+			if( surf->styles[map] == 255 )
+				break;
 
+			light->samples[map] = *lm;
 			lm += size; // skip to next lightmap
 		}
 
@@ -1602,7 +1632,94 @@ static qboolean SV_RecursiveLightPoint( model_t *model, mnode_t *node, const vec
 	}
 
 	// go down back side
-	return SV_RecursiveLightPoint( model, children[!side], mid, end, point_color );
+	return SV_RecursiveLightPoint( model, children[!side], mid, end, light );
+}
+
+/*
+=================
+SV_LightSampleColor
+
+apply current lightstyles values
+=================
+*/
+static void SV_LightSampleColor( const lightsample_t *light, vec3_t point_color )
+{
+	int	map;
+
+	if( !FBitSet( light->flags, LIGHTCELL_LIT ))
+		return; // keep default color
+
+	VectorClear( point_color );
+
+	for( map = 0; map < MAXLIGHTMAPS && light->styles[map] != 255; map++ )
+	{
+		float scale = sv.lightstyles[light->styles[map]].value;
+
+		point_color[0] += light->samples[map].r * scale;
+		point_color[1] += light->samples[map].g * scale;
+		point_color[2] += light->samples[map].b * scale;
+	}
+}
+
+/*
+=================
+SV_LightPoint
+
+find lightmap samples under or above the point
+=================
+*/
+static void SV_LightPoint( const vec3_t point, qboolean invlight, lightsample_t *light )
+{
+	vec3_t	end;
+
+	VectorCopy( point, end );
+
+	if( invlight )
+		end[2] = point[2] + world.size[2];
+	else end[2] = point[2] - world.size[2];
+
+	light->flags = 0;
+	SV_RecursiveLightPoint( sv.worldmodel, sv.worldmodel->nodes, point, end, light );
+}
+
+/*
+=================
+SV_CachedLightPoint
+
+sample light from the cell that contains the point, cells are
+sampled from the center at the top, or the bottom for invlight,
+so a point standing on the floor still sees the floor
+=================
+*/
+static const lightsample_t *SV_CachedLightPoint( const vec3_t point, qboolean invlight )
+{
+	lightcell_t	*lc;
+	vec3_t		start;
+	int		cell[3];
+	int		flags;
+	uint		hash;
+
+	cell[0] = (int)floor( point[0] / LIGHTCELL_SIZE );
+	cell[1] = (int)floor( point[1] / LIGHTCELL_SIZE );
+	cell[2] = (int)floor( point[2] / LIGHTCELL_HEIGHT );
+	flags = LIGHTCELL_VALID | ( invlight ? LIGHTCELL_INVLIGHT : 0 );
+
+	hash = ((uint)cell[0] * 73856093U ) ^ ((uint)cell[1] * 19349663U ) ^ ((uint)cell[2] * 83492791U ) ^ (uint)invlight;
+	lc = &sv_lightcells[hash & LIGHTCACHE_MASK];
+
+	if( FBitSet( lc->light.flags, LIGHTCELL_VALID ) && VectorCompare( lc->cell, cell )
+		&& FBitSet( lc->light.flags, LIGHTCELL_INVLIGHT ) == FBitSet( flags, LIGHTCELL_INVLIGHT ))
+		return &lc->light;
+
+	start[0] = ( cell[0] + 0.5f ) * LIGHTCELL_SIZE;
+	start[1] = ( cell[1] + 0.5f ) * LIGHTCELL_SIZE;
+	start[2] = ( invlight ? cell[2] : cell[2] + 1 ) * LIGHTCELL_HEIGHT;
+
+	VectorCopy( cell, lc->cell );
+	SV_LightPoint( start, invlight, &lc->light );
+	SetBits( lc->light.flags, flags );
+
+	return &lc->light;
 }
 
 /*
@@ -1642,7 +1759,7 @@ grab the ambient lighting color for current point
 int SV_LightForEntity( edict_t *pEdict )
 {
 	vec3_t point_color = { 1.0f, 1.0f, 1.0f };
-	vec3_t start, end;
+	qboolean invlight;
 
 	if( !SV_IsValidEdict( pEdict ))
 		return -1;
@@ -1654,14 +1771,19 @@ int SV_LightForEntity( edict_t *pEdict )
 	if( FBitSet( pEdict->v.flags, FL_CLIENT ))
 		return pEdict->v.light_level;
 
-	VectorCopy( pEdict->v.origin, start );
-	VectorCopy( pEdict->v.origin, end );
+	invlight = FBitSet( pEdict->v.effects, EF_INVLIGHT ) ? true : false;
 
-	if( FBitSet( pEdict->v.effects, EF_INVLIGHT ))
-		end[2] = start[2] + world.size[2];
-	else end[2] = start[2] - world.size[2];
+	if( sv_lightcache.value )
+	{
+		SV_LightSampleColor( SV_CachedLightPoint( pEdict->v.origin, invlight ), point_color );
+	}
+	else
+	{
+		lightsample_t light;
 
-	SV_RecursiveLightPoint( sv.worldmodel, sv.worldmodel->nodes, start, end, point_color );
+		SV_LightPoint( pEdict->v.origin, invlight, &light );
+		SV_LightSampleColor( &light, point_color );
+	}
 
 	return VectorAvg( point_color );
 }
@@ -0,0 +1,528 @@
+/*
+async.c - asynchronous file loading
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#if XASH_POSIX
+#include <pthread.h>
+#endif
+#include "port.h"
+#include "filesystem_internal.h"
+#include "crtlib.h"
+#include "xash3d_mathlib.h"
+#include "common/com_strings.h"
+
+/*
+===============================================================================
+
+ASYNC LOADING
+
+file is looked up and opened when it's queued, so search paths are only
+touched by the caller thread. Workers just fill the preallocated buffer
+from a private handle or a pinned archive mapping, everything else,
+including callbacks, happens in FS_PollAsync on the caller thread.
+Without threads jobs are completed in FS_PollAsync by priority.
+
+===============================================================================
+*/
+#define FS_ASYNC_THREADS     2 // default, XASH3D_FS_THREADS overrides it
+#define FS_ASYNC_MAX_THREADS 8
+
+enum
+{
+	FS_ASYNC_PENDING = 0,
+	FS_ASYNC_RUNNING,
+	FS_ASYNC_DONE,
+};
+
+typedef struct fs_asyncjob_s
+{
+	struct fs_asyncjob_s *next;
+	int         handle;
+	int         priority;
+	int         state;
+	qboolean    cancel;
+	qboolean    success;
+
+	file_t       *file;  // read by worker
+	fs_mapping_t *map;   // or copied from mapping
+	const byte   *view;
+
+	byte        *data;
+	fs_offset_t size;
+
+	fs_async_callback_t callback;
+	void        *userdata;
+	char        path[MAX_SYSPATH];
+} fs_asyncjob_t;
+
+#if XASH_POSIX
+#define mutex_create( x )     pthread_mutex_init( &( x ), NULL )
+#define mutex_destroy( x )    pthread_mutex_destroy( &( x ))
+#define mutex_lock( x )       pthread_mutex_lock( &( x ))
+#define mutex_unlock( x )     pthread_mutex_unlock( &( x ))
+#define cond_create( x )      pthread_cond_init( &( x ), NULL )
+#define cond_destroy( x )     pthread_cond_destroy( &( x ))
+#define cond_wait( x, m )     pthread_cond_wait( &( x ), &( m ))
+#define cond_signal( x )      pthread_cond_signal( &( x ))
+#define cond_broadcast( x )   pthread_cond_broadcast( &( x ))
+#define create_thread( thread, pfn ) !pthread_create( &( thread ), NULL, ( pfn ), NULL )
+#define join_thread( x )      pthread_join(( x ), NULL )
+typedef pthread_mutex_t mutex_t;
+typedef pthread_cond_t cond_t;
+typedef pthread_t thread_t;
+#define HAVE_ASYNC_THREADS 1
+#else // !XASH_POSIX
+// dup'd handles share file position here, so reads can't be done in parallel
+#define mutex_lock( x )
+#define mutex_unlock( x )
+#define HAVE_ASYNC_THREADS 0
+#endif // !XASH_POSIX
+
+static struct
+{
+	fs_asyncjob_t *jobs;     // queue order
+	int            numjobs;  // not yet passed to callback
+	int            handle;   // last given handle
+	uint           completed;
+	uint           canceled;
+
+#if HAVE_ASYNC_THREADS
+	mutex_t  lock;
+	cond_t   wake;       // for workers, new job or quit
+	cond_t   done;       // for FS_PollAsync, job is finished
+	thread_t threads[FS_ASYNC_MAX_THREADS];
+	qboolean quit;
+#endif // HAVE_ASYNC_THREADS
+	int      numthreads;
+	qboolean initialized;
+} fs_async;
+
+/*
+============
+FS_AsyncNextJob
+
+highest priority pending job, first queued wins among equal ones
+============
+*/
+static fs_asyncjob_t *FS_AsyncNextJob( void )
+{
+	fs_asyncjob_t *job, *best = NULL;
+
+	for( job = fs_async.jobs; job; job = job->next )
+	{
+		if( job->state != FS_ASYNC_PENDING )
+			continue;
+
+		if( !best || job->priority > best->priority )
+			best = job;
+	}
+
+	return best;
+}
+
+/*
+============
+FS_AsyncRunJob
+
+doesn't touch anything but the job, can be called by any thread
+============
+*/
+static void FS_AsyncRunJob( fs_asyncjob_t *job )
+{
+	if( job->view )
+	{
+		memcpy( job->data, job->view, job->size );
+		job->success = true;
+	}
+	else if( job->file )
+	{
+		job->success = FS_Read( job->file, job->data, job->size ) == job->size;
+	}
+
+	job->data[job->size] = '\0';
+}
+
+#if HAVE_ASYNC_THREADS
+static void *FS_AsyncThread( void *unused )
+{
+	mutex_lock( fs_async.lock );
+
+	while( true )
+	{
+		fs_asyncjob_t *job;
+
+		while( !fs_async.quit && ( job = FS_AsyncNextJob( )) == NULL )
+			cond_wait( fs_async.wake, fs_async.lock );
+
+		if( fs_async.quit )
+			break;
+
+		job->state = FS_ASYNC_RUNNING;
+		mutex_unlock( fs_async.lock );
+
+		// canceled pending jobs are never picked, running ones are dropped in FS_PollAsync
+		FS_AsyncRunJob( job );
+
+		mutex_lock( fs_async.lock );
+		job->state = FS_ASYNC_DONE;
+		cond_broadcast( fs_async.done );
+	}
+
+	mutex_unlock( fs_async.lock );
+	return NULL;
+}
+#endif // HAVE_ASYNC_THREADS
+
+/*
+============
+FS_InitAsync
+
+workers are started with the first job
+============
+*/
+static void FS_InitAsync( void )
+{
+#if HAVE_ASYNC_THREADS
+	const char *str = getenv( "XASH3D_FS_THREADS" );
+	int i, numthreads = FS_ASYNC_THREADS;
+
+	if( COM_CheckString( str ))
+		numthreads = bound( 0, Q_atoi( str ), FS_ASYNC_MAX_THREADS );
+
+	mutex_create( fs_async.lock );
+	cond_create( fs_async.wake );
+	cond_create( fs_async.done );
+	fs_async.quit = false;
+
+	for( i = 0; i < numthreads; i++ )
+	{
+		if( !create_thread( fs_async.threads[fs_async.numthreads], FS_AsyncThread ))
+		{
+			Con_Printf( S_WARN "%s: can't create worker thread\n", __func__ );
+			break;
+		}
+
+		fs_async.numthreads++;
+	}
+#endif // HAVE_ASYNC_THREADS
+
+	fs_async.initialized = true;
+}
+
+/*
+============
+FS_UnlinkAsyncJob
+============
+*/
+static void FS_UnlinkAsyncJob( fs_asyncjob_t *job )
+{
+	fs_asyncjob_t **prev;
+
+	for( prev = &fs_async.jobs; *prev; prev = &( *prev )->next )
+	{
+		if( *prev == job )
+		{
+			*prev = job->next;
+			fs_async.numjobs--;
+			break;
+		}
+	}
+}
+
+/*
+============
+FS_FreeAsyncJob
+
+called from caller thread only, when job is unlinked
+============
+*/
+static void FS_FreeAsyncJob( fs_asyncjob_t *job )
+{
+	if( job->file )
+		FS_Close( job->file );
+
+	if( job->map )
+		FS_ReleaseMapping( job->map );
+
+	Mem_Free( job );
+}
+
+/*
+============
+FS_LoadFileAsync
+
+returns handle of the queued job or 0 on error, even if the
+file wasn't found callback will be called with NULL data
+============
+*/
+int FS_LoadFileAsync( const char *path, qboolean gamedironly, int priority, fs_async_callback_t callback, void *userdata )
+{
+	searchpath_t *search;
+	char netpath[MAX_SYSPATH];
+	fs_asyncjob_t *job;
+	int pack_ind;
+
+	if( !callback || !COM_CheckString( path ))
+		return 0;
+
+	if( !fs_async.initialized )
+		FS_InitAsync();
+
+	job = (fs_asyncjob_t *)Mem_Calloc( fs_mempool, sizeof( *job ));
+	job->priority = priority;
+	job->callback = callback;
+	job->userdata = userdata;
+	Q_strncpy( job->path, path, sizeof( job->path ));
+
+	search = FS_FindLoadFile( path, &pack_ind, netpath, sizeof( netpath ), gamedironly );
+
+	if( !search )
+	{
+		job->state = FS_ASYNC_DONE;
+	}
+	else if( search->pfnMapFile && ( job->view = search->pfnMapFile( search, pack_ind, &job->size, &job->map )) != NULL )
+	{
+		job->map->refcount++;
+	}
+	else if(( job->file = search->pfnOpenFile( search, netpath, "rb", pack_ind )) != NULL )
+	{
+		job->size = job->file->real_length;
+	}
+	else
+	{
+		// not readable by handle, like wad lumps, load it right now
+		job->data = g_api.LoadFileFromArchive( search, netpath, pack_ind, &job->size, false );
+		job->success = job->data != NULL;
+		job->state = FS_ASYNC_DONE;
+	}
+
+	if( job->state == FS_ASYNC_PENDING )
+		job->data = (byte *)Mem_Malloc( fs_mempool, job->size + 1 );
+
+	mutex_lock( fs_async.lock );
+	job->handle = ++fs_async.handle;
+
+	// handles are positive, even if counter overflows
+	if( job->handle <= 0 )
+		job->handle = fs_async.handle = 1;
+
+	// append to keep queue order among equal priorities
+	if( fs_async.jobs )
+	{
+		fs_asyncjob_t *last;
+
+		for( last = fs_async.jobs; last->next; last = last->next );
+		last->next = job;
+	}
+	else fs_async.jobs = job;
+
+	fs_async.numjobs++;
+
+#if HAVE_ASYNC_THREADS
+	if( job->state == FS_ASYNC_PENDING )
+		cond_signal( fs_async.wake );
+#endif // HAVE_ASYNC_THREADS
+	mutex_unlock( fs_async.lock );
+
+	return job->handle;
+}
+
+/*
+============
+FS_CancelAsync
+
+returns true if callback won't be called for this job
+============
+*/
+qboolean FS_CancelAsync( int handle )
+{
+	fs_asyncjob_t *job;
+	qboolean result = false;
+
+	if( !fs_async.initialized )
+		return false;
+
+	mutex_lock( fs_async.lock );
+
+	for( job = fs_async.jobs; job; job = job->next )
+	{
+		if( job->handle == handle && !job->cancel )
+		{
+			job->cancel = true;
+			result = true;
+
+			// nobody will start it now
+			if( job->state == FS_ASYNC_PENDING )
+				job->state = FS_ASYNC_DONE;
+			break;
+		}
+	}
+
+	mutex_unlock( fs_async.lock );
+
+	return result;
+}
+
+/*
+============
+FS_PollAsync
+
+calls back finished jobs, if wait is set, blocks until the queue is empty,
+returns number of jobs that are still in progress
+============
+*/
+int FS_PollAsync( qboolean wait )
+{
+	qboolean ran = false;
+
+	if( !fs_async.initialized )
+		return 0;
+
+	while( true )
+	{
+		fs_asyncjob_t *job;
+
+		mutex_lock( fs_async.lock );
+
+		for( job = fs_async.jobs; job; job = job->next )
+		{
+			if( job->state == FS_ASYNC_DONE )
+				break;
+		}
+
+		if( !job )
+		{
+			// without workers one job is done per call, unless asked to wait
+			if( !fs_async.numjobs || ( !wait && ( fs_async.numthreads || ran )))
+			{
+				mutex_unlock( fs_async.lock );
+				break;
+			}
+
+#if HAVE_ASYNC_THREADS
+			if( fs_async.numthreads )
+			{
+				cond_wait( fs_async.done, fs_async.lock );
+				mutex_unlock( fs_async.lock );
+				continue;
+			}
+#endif // HAVE_ASYNC_THREADS
+
+			job = FS_AsyncNextJob();
+			if( !job )
+			{
+				mutex_unlock( fs_async.lock );
+				break;
+			}
+
+			job->state = FS_ASYNC_RUNNING;
+			mutex_unlock( fs_async.lock );
+
+			FS_AsyncRunJob( job );
+			job->state = FS_ASYNC_DONE;
+			ran = true;
+			continue;
+		}
+
+		// callback may poll again or queue new jobs
+		FS_UnlinkAsyncJob( job );
+		mutex_unlock( fs_async.lock );
+
+		if( job->cancel )
+		{
+			Mem_Free( job->data );
+			fs_async.canceled++;
+		}
+		else
+		{
+			if( !job->success )
+			{
+				Mem_Free( job->data );
+				job->data = NULL;
+				job->size = 0;
+			}
+
+			fs_async.completed++;
+			job->callback( job->path, job->data, job->size, job->userdata );
+		}
+
+		FS_FreeAsyncJob( job );
+	}
+
+	return fs_async.numjobs;
+}
+
+/*
+============
+FS_ShutdownAsync
+
+drop all jobs without calling back and stop workers
+============
+*/
+void FS_ShutdownAsync( void )
+{
+	fs_asyncjob_t *job;
+#if HAVE_ASYNC_THREADS
+	int i;
+#endif
+
+	if( !fs_async.initialized )
+		return;
+
+	mutex_lock( fs_async.lock );
+	for( job = fs_async.jobs; job; job = job->next )
+		job->cancel = true;
+
+#if HAVE_ASYNC_THREADS
+	fs_async.quit = true;
+	cond_broadcast( fs_async.wake );
+#endif // HAVE_ASYNC_THREADS
+	mutex_unlock( fs_async.lock );
+
+#if HAVE_ASYNC_THREADS
+	for( i = 0; i < fs_async.numthreads; i++ )
+		join_thread( fs_async.threads[i] );
+
+	mutex_destroy( fs_async.lock );
+	cond_destroy( fs_async.wake );
+	cond_destroy( fs_async.done );
+#endif // HAVE_ASYNC_THREADS
+
+	while( fs_async.jobs )
+	{
+		job = fs_async.jobs;
+		FS_UnlinkAsyncJob( job );
+		Mem_Free( job->data );
+		FS_FreeAsyncJob( job );
+	}
+
+	memset( &fs_async, 0, sizeof( fs_async ));
+}
+
+/*
+============
+FS_AsyncPrintInfo
+============
+*/
+void FS_AsyncPrintInfo( void )
+{
+	if( !fs_async.initialized )
+		return;
+
+	Con_Printf( "Async loading: %i threads, %i jobs queued, %u completed, %u canceled\n",
+		fs_async.numthreads, fs_async.numjobs, fs_async.completed, fs_async.canceled );
+}
@@ -35,7 +35,7 @@ GNU General Public License for more details.
 #endif
 #include <stdio.h>
 #include <stdarg.h>
-#if HAVE_MEMFD_CREATE
+#if HAVE_MEMFD_CREATE || XASH_POSIX
 #include <sys/mman.h>
 #endif
 #include "port.h"
@@ -77,6 +77,32 @@ static char fs_rodir[MAX_SYSPATH];
 static string fs_language;
 static qboolean fs_ext_path = false;	// attempt to read\write from ./ or ../ pathes
 
+static fs_mapping_t *fs_mappings;	// all live mappings, to find the view owner
+static int fs_mmap_mode = -1;	// not initialized
+
+typedef struct fs_indexentry_s
+{
+	const char   *name;  // owned by the archive
+	searchpath_t *search;
+	int          index;  // file index in the archive
+	int          order;  // searchpath position, lower is searched first
+	int          next;   // next entry in the bucket, -1 is the end
+} fs_indexentry_t;
+
+// merged file list of all archives in the search path, directories
+// and wads aren't indexed, so they are still searched in order
+static struct
+{
+	qboolean        dirty; // rebuilt on next lookup after search path changed
+	int             *buckets;
+	int             numbuckets;
+	fs_indexentry_t *entries;
+	int             numentries;
+	searchpath_t    **live;
+	int             *liveorder;
+	int             numlive;
+} fs_pathindex;
+
 typedef struct fs_archive_s
 {
 	const char *ext;
@@ -419,6 +445,7 @@ static searchpath_t *FS_AddArchive_Fullpath( const fs_archive_t *archive, const
 
 	search->next = fs_searchpaths;
 	fs_searchpaths = search;
+	fs_pathindex.dirty = true;
 
 	// time to add in search list all the wads from this archive
 	if( archive->load_wads && !FBitSet( flags, FS_SKIP_ARCHIVED_WADS ))
@@ -536,6 +563,8 @@ void FS_ClearSearchPath( void )
 		Mem_Free( cur );
 	}
 
+	fs_pathindex.dirty = true;
+
 	for( i = 0; i < FI.numgames; i++ )
 	{
 		if( FI.games[i] )
@@ -1818,8 +1847,11 @@ void FS_ShutdownStdio( void )
 	}
 	FI.numgames = 0;
 
+	FS_ShutdownAsync(); // holds files and mappings
 	FS_ClearSearchPath(); // release all wad files too
 	Mem_FreePool( &fs_mempool );
+	memset( &fs_pathindex, 0, sizeof( fs_pathindex ));
+	fs_mappings = NULL;
 }
 
 /*
@@ -1851,6 +1883,12 @@ void FS_Path_f( void )
 
 		Con_Printf( "\n" );
 	}
+
+	if( !fs_pathindex.dirty && fs_pathindex.buckets )
+		Con_Printf( "Path index: %i archived files, %i unindexed paths\n", fs_pathindex.numentries, fs_pathindex.numlive );
+
+	FS_ZipCachePrintInfo();
+	FS_AsyncPrintInfo();
 }
 
 /*
@@ -2163,6 +2201,133 @@ qboolean FS_GetRootDirectory( char *path, size_t size )
 	return true;
 }
 
+/*
+====================
+FS_FreePathIndex
+====================
+*/
+static void FS_FreePathIndex( void )
+{
+	if( fs_pathindex.buckets )
+		Mem_Free( fs_pathindex.buckets );
+	if( fs_pathindex.entries )
+		Mem_Free( fs_pathindex.entries );
+	if( fs_pathindex.live )
+		Mem_Free( fs_pathindex.live );
+	if( fs_pathindex.liveorder )
+		Mem_Free( fs_pathindex.liveorder );
+
+	memset( &fs_pathindex, 0, sizeof( fs_pathindex ));
+}
+
+/*
+====================
+FS_BuildPathIndex
+
+Hash file names of all archives in the search path,
+it's done lazily, so mounting many archives in a row is cheap
+====================
+*/
+static void FS_BuildPathIndex( void )
+{
+	searchpath_t *search;
+	int numentries = 0, numlive = 0, order, i;
+
+	FS_FreePathIndex();
+
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		if( !search->pfnFileName )
+		{
+			numlive++;
+			continue;
+		}
+
+		for( i = 0; search->pfnFileName( search, i ); i++ )
+			numentries++;
+	}
+
+	fs_pathindex.numbuckets = 256;
+	while( fs_pathindex.numbuckets < numentries * 2 )
+		fs_pathindex.numbuckets <<= 1;
+
+	fs_pathindex.buckets = Mem_Malloc( fs_mempool, sizeof( *fs_pathindex.buckets ) * fs_pathindex.numbuckets );
+	memset( fs_pathindex.buckets, 0xFF, sizeof( *fs_pathindex.buckets ) * fs_pathindex.numbuckets );
+
+	if( numentries )
+		fs_pathindex.entries = Mem_Malloc( fs_mempool, sizeof( *fs_pathindex.entries ) * numentries );
+
+	if( numlive )
+	{
+		fs_pathindex.live = Mem_Malloc( fs_mempool, sizeof( *fs_pathindex.live ) * numlive );
+		fs_pathindex.liveorder = Mem_Malloc( fs_mempool, sizeof( *fs_pathindex.liveorder ) * numlive );
+	}
+
+	for( search = fs_searchpaths, order = 0; search; search = search->next, order++ )
+	{
+		const char *name;
+
+		if( !search->pfnFileName )
+		{
+			fs_pathindex.live[fs_pathindex.numlive] = search;
+			fs_pathindex.liveorder[fs_pathindex.numlive] = order;
+			fs_pathindex.numlive++;
+			continue;
+		}
+
+		for( i = 0; ( name = search->pfnFileName( search, i )) != NULL; i++ )
+		{
+			fs_indexentry_t *entry = &fs_pathindex.entries[fs_pathindex.numentries];
+			uint bucket = COM_HashKey( name, fs_pathindex.numbuckets );
+
+			entry->name = name;
+			entry->search = search;
+			entry->index = i;
+			entry->order = order;
+			entry->next = fs_pathindex.buckets[bucket];
+			fs_pathindex.buckets[bucket] = fs_pathindex.numentries++;
+		}
+	}
+
+	fs_pathindex.dirty = false;
+}
+
+/*
+====================
+FS_LookupPathIndex
+
+Returns archive entry that comes first in the search path
+====================
+*/
+static const fs_indexentry_t *FS_LookupPathIndex( const char *name, qboolean gamedironly )
+{
+	const fs_indexentry_t *best = NULL;
+	int i;
+
+	if( fs_pathindex.dirty || !fs_pathindex.buckets )
+		FS_BuildPathIndex();
+
+	for( i = fs_pathindex.buckets[COM_HashKey( name, fs_pathindex.numbuckets )]; i >= 0; i = fs_pathindex.entries[i].next )
+	{
+		const fs_indexentry_t *entry = &fs_pathindex.entries[i];
+
+		if( best && best->order < entry->order )
+			continue;
+
+		if( gamedironly && !FBitSet( entry->search->flags, FS_GAMEDIRONLY_SEARCH_FLAGS ))
+			continue;
+
+		// prefer first file if archive has duplicates
+		if( best && best->order == entry->order && best->index < entry->index )
+			continue;
+
+		if( !Q_stricmp( entry->name, name ))
+			best = entry;
+	}
+
+	return best;
+}
+
 /*
 ====================
 FS_FindFile
@@ -2175,13 +2340,18 @@ and the file index in the package if relevant
 */
 searchpath_t *FS_FindFile( const char *name, int *index, char *fixedname, size_t len, qboolean gamedironly )
 {
-	searchpath_t	*search;
+	const fs_indexentry_t *entry = FS_LookupPathIndex( name, gamedironly );
+	int i;
 
-	// search through the path, one element at a time
-	for( search = fs_searchpaths; search; search = search->next )
+	// directories and wads that come before the archive still can override it
+	for( i = 0; i < fs_pathindex.numlive; i++ )
 	{
+		searchpath_t *search = fs_pathindex.live[i];
 		int pack_ind;
 
+		if( entry && fs_pathindex.liveorder[i] > entry->order )
+			break;
+
 		if( gamedironly & !FBitSet( search->flags, FS_GAMEDIRONLY_SEARCH_FLAGS ))
 			continue;
 
@@ -2194,6 +2364,15 @@ searchpath_t *FS_FindFile( const char *name, int *index, char *fixedname, size_t
 		}
 	}
 
+	if( entry )
+	{
+		if( fixedname )
+			Q_strncpy( fixedname, entry->name, len );
+		if( index )
+			*index = entry->index;
+		return entry->search;
+	}
+
 	if( fs_ext_path )
 	{
 		char netpath[MAX_SYSPATH], dirpath[MAX_SYSPATH];
@@ -2359,7 +2538,9 @@ int FS_Close( file_t *file )
 
 	if( file->ztk )
 	{
-		inflateEnd( &file->ztk->zstream );
+		if( file->ztk->cache )
+			FS_ZipCacheRelease( file->ztk->cache );
+		else inflateEnd( &file->ztk->zstream );
 		Mem_Free( file->ztk );
 	}
 
@@ -2367,6 +2548,114 @@ int FS_Close( file_t *file )
 	return 0;
 }
 
+/*
+====================
+FS_MapEnabled
+
+archives are mapped by default only with 64-bit address space,
+XASH3D_ARCHIVE_MMAP forces it on or off
+====================
+*/
+static qboolean FS_MapEnabled( void )
+{
+	if( fs_mmap_mode < 0 )
+	{
+		const char *str = getenv( "XASH3D_ARCHIVE_MMAP" );
+
+		if( COM_CheckString( str ))
+			fs_mmap_mode = Q_atoi( str ) != 0;
+		else fs_mmap_mode = XASH_64BIT ? 1 : 0;
+	}
+
+	return fs_mmap_mode;
+}
+
+/*
+====================
+FS_MapHandle
+
+Map file contents into memory, only uncompressed files can be mapped
+====================
+*/
+fs_mapping_t *FS_MapHandle( file_t *file )
+{
+#if XASH_POSIX
+	fs_mapping_t *map;
+	fs_offset_t start;
+	size_t length;
+	long pagesize;
+	void *base;
+
+	if( !file || file->ztk || FBitSet( file->flags, FILE_DEFLATED ) || file->handle < 0 || file->real_length <= 0 )
+		return NULL;
+
+	if( !FS_MapEnabled( ))
+		return NULL;
+
+	// offset must be page aligned
+	pagesize = sysconf( _SC_PAGESIZE );
+	start = file->offset - file->offset % pagesize;
+	length = file->offset - start + file->real_length;
+
+	base = mmap( NULL, length, PROT_READ, MAP_PRIVATE, file->handle, start );
+	if( base == MAP_FAILED )
+	{
+		Con_Reportf( S_WARN "%s: can't map file: %s\n", __func__, strerror( errno ));
+		return NULL;
+	}
+
+	map = (fs_mapping_t *)Mem_Calloc( fs_mempool, sizeof( *map ));
+	map->base = base;
+	map->length = length;
+	map->data = (const byte *)base + ( file->offset - start );
+	map->size = file->real_length;
+	map->refcount = 1;
+	map->next = fs_mappings;
+	fs_mappings = map;
+
+	return map;
+#else // !XASH_POSIX
+	return NULL;
+#endif // !XASH_POSIX
+}
+
+/*
+====================
+FS_ReleaseMapping
+
+Mapping is kept while there are views into it, even if the archive is closed
+====================
+*/
+void FS_ReleaseMapping( fs_mapping_t *map )
+{
+	fs_mapping_t **prev;
+
+	if( !map || --map->refcount > 0 )
+		return;
+
+	for( prev = &fs_mappings; *prev; prev = &( *prev )->next )
+	{
+		if( *prev == map )
+		{
+			*prev = map->next;
+			break;
+		}
+	}
+
+#if XASH_POSIX
+	munmap( map->base, map->length );
+#endif // XASH_POSIX
+	Mem_Free( map );
+}
+
+const byte *FS_MappingView( fs_mapping_t *map, fs_offset_t offset, fs_offset_t size )
+{
+	if( !map || offset < 0 || size < 0 || offset + size > map->size )
+		return NULL;
+
+	return map->data + offset;
+}
+
 /*
 ====================
 FS_Flush
@@ -2406,9 +2695,9 @@ fs_offset_t FS_Write( file_t *file, const void *data, size_t datasize )
 
 	if( !file ) return 0;
 
-	// if necessary, seek to the exact file position we're supposed to be
-	if( file->buff_ind != file->buff_len )
-		lseek( file->handle, file->buff_ind - file->buff_len, SEEK_CUR );
+	// seek to the exact file position we're supposed to be, reads
+	// don't move the handle position, see FS_ReadAt
+	lseek( file->handle, file->offset + file->position - file->buff_len + file->buff_ind, SEEK_SET );
 
 	// purge cached data
 	FS_Purge( file );
@@ -2425,6 +2714,24 @@ fs_offset_t FS_Write( file_t *file, const void *data, size_t datasize )
 	return result;
 }
 
+/*
+====================
+FS_ReadAt
+
+Handles opened from the same archive share the file position,
+so read without touching it where it's possible
+====================
+*/
+static fs_offset_t FS_ReadAt( int handle, void *buffer, size_t count, fs_offset_t offset )
+{
+#if XASH_POSIX
+	return pread( handle, buffer, count, offset );
+#else // !XASH_POSIX
+	lseek( handle, offset, SEEK_SET );
+	return read( handle, buffer, count );
+#endif // !XASH_POSIX
+}
+
 /*
 ====================
 FS_Read
@@ -2470,6 +2777,18 @@ fs_offset_t FS_Read( file_t *file, void *buffer, size_t buffersize )
 
 	FS_EnsureOpenFile( file ); // FIXME: broken XASH_REDUCE_FD in case of compressed files!
 
+	if( FBitSet( file->flags, FILE_DEFLATED ) && file->ztk->cache )
+	{
+		// already decompressed
+		count = file->real_length - file->position;
+		count = Q_min( count, (fs_offset_t)buffersize );
+
+		memcpy( &((byte *)buffer)[done], FS_ZipCacheData( file->ztk->cache ) + file->position, count );
+		file->position += count;
+
+		return done + count;
+	}
+
 	if( FBitSet( file->flags, FILE_DEFLATED ))
 	{
 		// If the file is compressed, it's more complicated...
@@ -2491,8 +2810,7 @@ fs_offset_t FS_Read( file_t *file, void *buffer, size_t buffersize )
 				count = (fs_offset_t)( ztk->comp_length - ztk->in_position );
 				if( count > (fs_offset_t)sizeof( ztk->input ))
 					count = (fs_offset_t)sizeof( ztk->input );
-				lseek( file->handle, file->offset + (fs_offset_t)ztk->in_position, SEEK_SET );
-				if( read( file->handle, ztk->input, count ) != count )
+				if( FS_ReadAt( file->handle, ztk->input, count, file->offset + (fs_offset_t)ztk->in_position ) != count )
 				{
 					Con_Printf( "%s: unexpected end of file\n", __func__ );
 					break;
@@ -2563,8 +2881,7 @@ fs_offset_t FS_Read( file_t *file, void *buffer, size_t buffersize )
 	{
 		if( count > (fs_offset_t)buffersize )
 			count = (fs_offset_t)buffersize;
-		lseek( file->handle, file->offset + file->position, SEEK_SET );
-		nb = read( file->handle, &((byte *)buffer)[done], count );
+		nb = FS_ReadAt( file->handle, &((byte *)buffer)[done], count, file->offset + file->position );
 
 		if( nb > 0 )
 		{
@@ -2578,8 +2895,7 @@ fs_offset_t FS_Read( file_t *file, void *buffer, size_t buffersize )
 	{
 		if( count > (fs_offset_t)sizeof( file->buff ))
 			count = (fs_offset_t)sizeof( file->buff );
-		lseek( file->handle, file->offset + file->position, SEEK_SET );
-		nb = read( file->handle, file->buff, count );
+		nb = FS_ReadAt( file->handle, file->buff, count, file->offset + file->position );
 
 		if( nb > 0 )
 		{
@@ -2770,6 +3086,12 @@ int FS_Seek( file_t *file, fs_offset_t offset, int whence )
 	// Purge cached data
 	FS_Purge( file );
 
+	if( FBitSet( file->flags, FILE_DEFLATED ) && file->ztk->cache )
+	{
+		file->position = offset;
+		return 0;
+	}
+
 	if( FBitSet( file->flags, FILE_DEFLATED ))
 	{
 		// Seeking in compressed files is more a hack than anything else,
@@ -2880,9 +3202,29 @@ static byte *FS_LoadFileFromArchive( searchpath_t *sp, const char *path, int pac
 	fs_offset_t	filesize;
 	file_t *file;
 	byte *buf;
+	const byte *view;
+	fs_mapping_t *map;
 	void *( *pfnAlloc )( size_t ) = sys_malloc ? malloc : FS_CustomAlloc;
 	void ( *pfnFree )( void * ) = sys_malloc ? free : FS_CustomFree;
 
+	// stored file in mapped archive is copied directly
+	if( sp->pfnMapFile && ( view = sp->pfnMapFile( sp, pack_ind, &filesize, &map )) != NULL )
+	{
+		buf = (byte *)pfnAlloc( filesize + 1 );
+
+		if( unlikely( !buf ))
+		{
+			Con_Reportf( "%s: can't alloc %li bytes, no free memory\n", __func__, (long)filesize + 1 );
+			return NULL;
+		}
+
+		memcpy( buf, view, filesize );
+		buf[filesize] = '\0';
+		if( filesizeptr ) *filesizeptr = filesize;
+
+		return buf;
+	}
+
 	// custom load file function for compressed files
 	if( sp->pfnLoadFile )
 		return sp->pfnLoadFile( sp, path, pack_ind, filesizeptr, pfnAlloc, pfnFree );
@@ -2912,18 +3254,13 @@ static byte *FS_LoadFileFromArchive( searchpath_t *sp, const char *path, int pac
 
 /*
 ============
-FS_LoadFile
+FS_FindLoadFile
 
-Filename are relative to the xash directory.
-Always appends a 0 byte.
+Look up the file for loading
 ============
 */
-static byte *FS_LoadFile_( const char *path, fs_offset_t *filesizeptr, const qboolean gamedironly, const qboolean custom_alloc )
+searchpath_t *FS_FindLoadFile( const char *path, int *pack_ind, char *netpath, size_t len, qboolean gamedironly )
 {
-	searchpath_t *search;
-	char netpath[MAX_SYSPATH];
-	int pack_ind;
-
 	// some mappers used leading '/' or '\' in path to models or sounds
 	if( path[0] == '/' || path[0] == '\\' )
 		path++;
@@ -2934,7 +3271,24 @@ static byte *FS_LoadFile_( const char *path, fs_offset_t *filesizeptr, const qbo
 	if( !fs_searchpaths || FS_CheckNastyPath( path ))
 		return NULL;
 
-	search = FS_FindFile( path, &pack_ind, netpath, sizeof( netpath ), gamedironly );
+	return FS_FindFile( path, pack_ind, netpath, len, gamedironly );
+}
+
+/*
+============
+FS_LoadFile
+
+Filename are relative to the xash directory.
+Always appends a 0 byte.
+============
+*/
+static byte *FS_LoadFile_( const char *path, fs_offset_t *filesizeptr, const qboolean gamedironly, const qboolean custom_alloc )
+{
+	searchpath_t *search;
+	char netpath[MAX_SYSPATH];
+	int pack_ind;
+
+	search = FS_FindLoadFile( path, &pack_ind, netpath, sizeof( netpath ), gamedironly );
 
 	if( !search )
 		return NULL;
@@ -2942,6 +3296,64 @@ static byte *FS_LoadFile_( const char *path, fs_offset_t *filesizeptr, const qbo
 	return FS_LoadFileFromArchive( search, netpath, pack_ind, filesizeptr, !custom_alloc );
 }
 
+/*
+============
+FS_MapFile
+
+Returns read-only view of the file, which points straight into
+the mapped archive when possible, otherwise the file is loaded
+============
+*/
+const byte *FS_MapFile( const char *path, fs_offset_t *filesizeptr, qboolean gamedironly )
+{
+	searchpath_t *search;
+	char netpath[MAX_SYSPATH];
+	fs_mapping_t *map;
+	fs_offset_t filesize;
+	const byte *view;
+	int pack_ind;
+
+	if( filesizeptr ) *filesizeptr = 0;
+
+	search = FS_FindLoadFile( path, &pack_ind, netpath, sizeof( netpath ), gamedironly );
+
+	if( !search )
+		return NULL;
+
+	if( search->pfnMapFile && ( view = search->pfnMapFile( search, pack_ind, &filesize, &map )) != NULL )
+	{
+		map->refcount++;
+		if( filesizeptr ) *filesizeptr = filesize;
+		return view;
+	}
+
+	return FS_LoadFileFromArchive( search, netpath, pack_ind, filesizeptr, false );
+}
+
+/*
+============
+FS_UnmapFile
+============
+*/
+void FS_UnmapFile( const byte *data )
+{
+	fs_mapping_t *map;
+
+	if( !data )
+		return;
+
+	for( map = fs_mappings; map; map = map->next )
+	{
+		if( data >= map->data && data < map->data + map->size )
+		{
+			FS_ReleaseMapping( map );
+			return;
+		}
+	}
+
+	Mem_Free( (void *)data );
+}
+
 byte *FS_LoadFileMalloc( const char *path, fs_offset_t *filesizeptr, qboolean gamedironly )
 {
 	return FS_LoadFile_( path, filesizeptr, gamedironly, false );
@@ -3410,6 +3822,7 @@ void FS_InitMemory( void )
 {
 	fs_mempool = Mem_AllocPool( "FileSystem Pool" );
 	fs_searchpaths = NULL;
+	memset( &fs_pathindex, 0, sizeof( fs_pathindex ));
 }
 
 fs_interface_t g_engfuncs =
@@ -3545,6 +3958,13 @@ const fs_api_t g_api =
 	FS_GetRootDirectory,
 
 	FS_MakeGameInfo,
+
+	FS_MapFile,
+	FS_UnmapFile,
+
+	FS_LoadFileAsync,
+	FS_CancelAsync,
+	FS_PollAsync,
 };
 
 int EXPORT GetFSAPI( int version, fs_api_t *api, fs_globals_t **globals, fs_interface_t *engfuncs );
@@ -150,6 +150,9 @@ typedef struct fs_globals_t
 
 typedef struct file_s file_t;
 
+// data is NULL if file can't be loaded
+typedef void (*fs_async_callback_t)( const char *path, byte *data, fs_offset_t size, void *userdata );
+
 typedef struct fs_api_t
 {
 	qboolean (*InitStdio)( qboolean unused_set_to_true, const char *rootdir, const char *basedir, const char *gamedir, const char *rodir );
@@ -239,6 +242,21 @@ typedef struct fs_api_t
 	qboolean (*GetRootDirectory)( char *path, size_t size );
 
 	void (*MakeGameInfo)( void );
+
+	// read-only view of the whole file, not null terminated, it points straight
+	// into memory mapped archive for stored files, otherwise the file is loaded
+	// must be released with UnmapFile
+	const byte *(*MapFile)( const char *path, fs_offset_t *filesizeptr, qboolean gamedironly );
+	void (*UnmapFile)( const byte *data );
+
+	// queues file loading on worker threads, higher priority jobs are started first
+	// callbacks are called only from PollAsync, data is freed like LoadFile result,
+	// it's NULL if file can't be loaded. Returns job handle or 0
+	int (*LoadFileAsync)( const char *path, qboolean gamedironly, int priority, fs_async_callback_t callback, void *userdata );
+	// returns true if callback won't be called
+	qboolean (*CancelAsync)( int handle );
+	// calls back finished jobs, returns number of jobs in progress
+	int (*PollAsync)( qboolean wait );
 } fs_api_t;
 
 typedef struct fs_interface_t
@@ -43,8 +43,22 @@ typedef struct android_assets_s android_assets_t;
 #define FILE_BUFF_SIZE (2048)
 #define FILE_DEFLATED BIT( 0 )
 
+typedef struct zipcache_s zipcache_t;
+
+// read-only memory mapping of the archive file contents
+typedef struct fs_mapping_s
+{
+	struct fs_mapping_s *next;
+	void        *base;     // page aligned
+	size_t      length;
+	const byte  *data;     // file contents, inside the mapping
+	fs_offset_t size;
+	int         refcount;  // archive and every view returned by FS_MapFile
+} fs_mapping_t;
+
 typedef struct ztoolkit_s
 {
+	zipcache_t *cache; // if not NULL, file is read from decompressed copy
 	z_stream zstream;
 	size_t   comp_length;
 	size_t   in_ind, in_len;
@@ -116,6 +130,8 @@ typedef struct searchpath_s
 	file_t *(*pfnOpenFile)( struct searchpath_s *search, const char *filename, const char *mode, int pack_ind );
 	int     (*pfnFileTime)( struct searchpath_s *search, const char *filename );
 	int     (*pfnFindFile)( struct searchpath_s *search, const char *path, char *fixedname, size_t len );
+	const char *(*pfnFileName)( struct searchpath_s *search, int index ); // only for archives with immutable file list
+	const byte *(*pfnMapFile)( struct searchpath_s *search, int pack_ind, fs_offset_t *size, fs_mapping_t **map ); // stored files of mapped archives
 	void    (*pfnSearch)( struct searchpath_s *search, stringlist_t *list, const char *pattern, int caseinsensitive );
 	byte   *(*pfnLoadFile)( struct searchpath_s *search, const char *path, int pack_ind, fs_offset_t *filesize, void *( *pfnAlloc )( size_t ), void ( *pfnFree )( void * ));
 } searchpath_t;
@@ -222,7 +238,13 @@ file_t  *FS_OpenReadFile( const char *filename, const char *mode, qboolean gamed
 int           FS_SysFileTime( const char *filename );
 file_t       *FS_OpenHandle( searchpath_t *search, int handle, fs_offset_t offset, fs_offset_t len );
 file_t       *FS_SysOpen( const char *filepath, const char *mode );
+fs_mapping_t *FS_MapHandle( file_t *file );
+void          FS_ReleaseMapping( fs_mapping_t *map );
+const byte   *FS_MappingView( fs_mapping_t *map, fs_offset_t offset, fs_offset_t size );
+const byte   *FS_MapFile( const char *path, fs_offset_t *filesizeptr, qboolean gamedironly );
+void          FS_UnmapFile( const byte *data );
 searchpath_t *FS_FindFile( const char *name, int *index, char *fixedname, size_t len, qboolean gamedironly );
+searchpath_t *FS_FindLoadFile( const char *path, int *pack_ind, char *netpath, size_t len, qboolean gamedironly );
 qboolean FS_FullPathToRelativePath( char *dst, const char *src, size_t size );
 
 //
@@ -240,6 +262,9 @@ searchpath_t *FS_AddWad_Fullpath( const char *wadfile, int flags );
 // zip.c
 //
 searchpath_t *FS_AddZip_Fullpath( const char *zipfile, int flags );
+void FS_ZipCacheRelease( zipcache_t *entry );
+const byte *FS_ZipCacheData( const zipcache_t *entry );
+void FS_ZipCachePrintInfo( void );
 
 //
 // dir.c
@@ -248,6 +273,15 @@ searchpath_t *FS_AddDir_Fullpath( const char *path, int flags );
 qboolean FS_FixFileCase( dir_t *dir, const char *path, char *dst, const size_t len, qboolean createpath );
 void FS_InitDirectorySearchpath( searchpath_t *search, const char *path, int flags );
 
+//
+// async.c
+//
+int FS_LoadFileAsync( const char *path, qboolean gamedironly, int priority, fs_async_callback_t callback, void *userdata );
+qboolean FS_CancelAsync( int handle );
+int FS_PollAsync( qboolean wait );
+void FS_ShutdownAsync( void );
+void FS_AsyncPrintInfo( void );
+
 //
 // android.c
 //
@@ -68,6 +68,7 @@ typedef struct
 struct pack_s
 {
 	file_t *handle;
+	fs_mapping_t *map;
 	int		numfiles;
 	dpackfile_t files[]; // flexible
 };
@@ -181,6 +182,7 @@ static pack_t *FS_LoadPackPAK( const char *packfile, int *error )
 	pack->handle = packhandle;
 	pack->numfiles = numpackfiles;
 	qsort( pack->files, pack->numfiles, sizeof( pack->files[0] ), FS_SortPak );
+	pack->map = FS_MapHandle( packhandle );
 
 #ifdef XASH_REDUCE_FD
 	// will reopen when needed
@@ -210,6 +212,22 @@ static file_t *FS_OpenFile_PAK( searchpath_t *search, const char *filename, cons
 	return FS_OpenHandle( search, search->pack->handle->handle, pfile->filepos, pfile->filelen );
 }
 
+/*
+===========
+FS_MapFile_PAK
+
+===========
+*/
+static const byte *FS_MapFile_PAK( searchpath_t *search, int pack_ind, fs_offset_t *size, fs_mapping_t **map )
+{
+	dpackfile_t *pfile = &search->pack->files[pack_ind];
+
+	*size = pfile->filelen;
+	*map = search->pack->map;
+
+	return FS_MappingView( search->pack->map, pfile->filepos, pfile->filelen );
+}
+
 /*
 ===========
 FS_FindFile_PAK
@@ -247,6 +265,20 @@ static int FS_FindFile_PAK( searchpath_t *search, const char *path, char *fixedn
 	return -1;
 }
 
+/*
+===========
+FS_FileName_PAK
+
+===========
+*/
+static const char *FS_FileName_PAK( searchpath_t *search, int index )
+{
+	if( index < 0 || index >= search->pack->numfiles )
+		return NULL;
+
+	return search->pack->files[index].name;
+}
+
 /*
 ===========
 FS_Search_PAK
@@ -325,6 +357,7 @@ FS_Close_PAK
 */
 static void FS_Close_PAK( searchpath_t *search )
 {
+	FS_ReleaseMapping( search->pack->map );
 	if( search->pack->handle != NULL )
 		FS_Close( search->pack->handle );
 	Mem_Free( search->pack );
@@ -371,6 +404,8 @@ searchpath_t *FS_AddPak_Fullpath( const char *pakfile, int flags )
 	search->pfnOpenFile = FS_OpenFile_PAK;
 	search->pfnFileTime = FS_FileTime_PAK;
 	search->pfnFindFile = FS_FindFile_PAK;
+	search->pfnFileName = FS_FileName_PAK;
+	search->pfnMapFile = FS_MapFile_PAK;
 	search->pfnSearch = FS_Search_PAK;
 
 	Con_Reportf( "Adding PAK: %s (%i files)\n", pakfile, pak->numfiles );
@@ -0,0 +1,328 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "filesystem.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define CreateDir( x ) mkdir( x, 0777 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define CreateDir( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR "async_test/"
+#define NUM_FILES 32
+#define FILE_SIZE ( 128 * 1024 )
+
+typedef struct
+{
+	char name[56];
+	int  filepos;
+	int  filelen;
+} testpakfile_t;
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+static byte contents[NUM_FILES][FILE_SIZE];
+static int  callbacks[NUM_FILES];
+static int  order[NUM_FILES], numorder;
+
+static void Callback( const char *path, byte *data, fs_offset_t size, void *userdata )
+{
+	int i = (int)(size_t)userdata;
+
+	callbacks[i]++;
+	order[numorder++] = i;
+
+	if( !data || size != FILE_SIZE || memcmp( data, contents[i], size ))
+	{
+		printf( "%s: wrong contents\n", path );
+		callbacks[i] = -1000;
+	}
+
+	free( data );
+}
+
+static void MissingCallback( const char *path, byte *data, fs_offset_t size, void *userdata )
+{
+	if( data )
+		printf( "%s: shouldn't exist\n", path );
+	*(int *)userdata = data ? -1 : 1;
+}
+
+static double Time( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static qboolean WriteFiles( void )
+{
+	char name[64];
+	int i, j;
+
+	srand( 1337 );
+	CreateDir( TEST_DIR );
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	for( i = 0; i < NUM_FILES; i++ )
+	{
+		for( j = 0; j < FILE_SIZE; j++ )
+			contents[i][j] = rand();
+
+		snprintf( name, sizeof( name ), "file%02d.bin", i );
+		if( !g_fs.WriteFile( name, contents[i], FILE_SIZE ))
+			return false;
+	}
+
+	return true;
+}
+
+static void RemoveFiles( void )
+{
+	char name[64];
+	int i;
+
+	for( i = 0; i < NUM_FILES; i++ )
+	{
+		snprintf( name, sizeof( name ), "file%02d.bin", i );
+		g_fs.Delete( name );
+	}
+
+	g_fs.ClearSearchPath();
+	remove( TEST_DIR );
+}
+
+// reads don't move the handle position, writes must still land after them
+static qboolean TestReadWrite( void )
+{
+	char buf[8];
+	file_t *f;
+	byte *data;
+	fs_offset_t len;
+	qboolean ok;
+
+	if( !g_fs.WriteFile( "rw.txt", "0123456789", 10 ))
+		return false;
+
+	f = g_fs.Open( "rw.txt", "r+", false );
+	if( !f )
+	{
+		printf( "can't open rw.txt\n" );
+		return false;
+	}
+
+	g_fs.Read( f, buf, 3 );
+	g_fs.Write( f, "abc", 3 );
+	g_fs.Read( f, buf, 2 );
+	g_fs.Write( f, "XY", 2 );
+	g_fs.Close( f );
+
+	data = g_fs.LoadFile( "rw.txt", &len, false );
+	ok = data && len == 10 && !memcmp( data, "012abc67XY", 10 );
+
+	if( !ok )
+		printf( "read then write: %.*s\n", data ? (int)len : 0, data ? (char *)data : "" );
+
+	free( data );
+	g_fs.Delete( "rw.txt" );
+
+	return ok;
+}
+
+static qboolean TestAsync( void )
+{
+	char name[64];
+	int handles[NUM_FILES];
+	int i, missing = 0, canceled = 0;
+
+	memset( callbacks, 0, sizeof( callbacks ));
+	numorder = 0;
+
+	for( i = 0; i < NUM_FILES; i++ )
+	{
+		snprintf( name, sizeof( name ), "file%02d.bin", i );
+		handles[i] = g_fs.LoadFileAsync( name, false, i % 4, Callback, (void *)(size_t)i );
+
+		if( !handles[i] )
+		{
+			printf( "%s: not queued\n", name );
+			return false;
+		}
+	}
+
+	if( !g_fs.LoadFileAsync( "nothing.bin", false, 0, MissingCallback, &missing ))
+		return false;
+
+	// some of them may be already loaded, but callback isn't called yet
+	for( i = 0; i < NUM_FILES; i += 3 )
+	{
+		if( g_fs.CancelAsync( handles[i] ))
+		{
+			callbacks[i] = -1; // mustn't be called
+			canceled++;
+		}
+	}
+
+	if( g_fs.CancelAsync( handles[0] ))
+	{
+		printf( "canceled twice\n" );
+		return false;
+	}
+
+	if( g_fs.PollAsync( true ) != 0 )
+	{
+		printf( "queue isn't empty\n" );
+		return false;
+	}
+
+	for( i = 0; i < NUM_FILES; i++ )
+	{
+		if( callbacks[i] != ( i % 3 ? 1 : -1 ))
+		{
+			printf( "file%02d.bin: called back %d times\n", i, callbacks[i] );
+			return false;
+		}
+	}
+
+	if( missing != 1 )
+	{
+		printf( "missing file wasn't reported\n" );
+		return false;
+	}
+
+	if( g_fs.CancelAsync( handles[1] ))
+	{
+		printf( "canceled finished job\n" );
+		return false;
+	}
+
+	printf( "%d canceled\n", canceled );
+	return true;
+}
+
+static qboolean TestPriority( void )
+{
+	const char *threads = getenv( "XASH3D_FS_THREADS" );
+	char name[64];
+	int i;
+
+	// order is only predictable without workers, XASH3D_FS_THREADS=0
+	if( !threads || strcmp( threads, "0" ))
+		return true;
+
+	numorder = 0;
+	for( i = 0; i < 8; i++ )
+	{
+		snprintf( name, sizeof( name ), "file%02d.bin", i );
+		g_fs.LoadFileAsync( name, false, i & 1 ? 10 : 0, Callback, (void *)(size_t)i );
+	}
+	g_fs.PollAsync( true );
+
+	for( i = 0; i < 8; i++ )
+	{
+		int expected = i < 4 ? i * 2 + 1 : ( i - 4 ) * 2;
+
+		if( order[i] != expected )
+		{
+			printf( "wrong order: %d instead of %d\n", order[i], expected );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void Benchmark( int rounds )
+{
+	char name[64];
+	double start, sync, async;
+	int i, j;
+
+	start = Time();
+	for( j = 0; j < rounds; j++ )
+	{
+		for( i = 0; i < NUM_FILES; i++ )
+		{
+			fs_offset_t size;
+			byte *data;
+
+			snprintf( name, sizeof( name ), "file%02d.bin", i );
+			data = g_fs.LoadFile( name, &size, false );
+			Callback( name, data, size, (void *)(size_t)i );
+			numorder = 0;
+		}
+	}
+	sync = Time() - start;
+
+	start = Time();
+	for( j = 0; j < rounds; j++ )
+	{
+		for( i = 0; i < NUM_FILES; i++ )
+		{
+			snprintf( name, sizeof( name ), "file%02d.bin", i );
+			g_fs.LoadFileAsync( name, false, 0, Callback, (void *)(size_t)i );
+		}
+
+		g_fs.PollAsync( true );
+		numorder = 0;
+	}
+	async = Time() - start;
+
+	printf( "%d files: sync %.3f sec, async %.3f sec\n", rounds * NUM_FILES, sync, async );
+}
+
+int main( int argc, char **argv )
+{
+	qboolean success;
+
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !WriteFiles( ))
+		return EXIT_FAILURE;
+
+	success = TestReadWrite() && TestAsync() && TestPriority();
+
+	// test_async bench [rounds]
+	if( success && argc > 1 && !strcmp( argv[1], "bench" ))
+		Benchmark( argc > 2 ? atoi( argv[2] ) : 10 );
+
+	RemoveFiles();
+
+	if( !success )
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
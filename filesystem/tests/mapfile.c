@@ -0,0 +1,157 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "filesystem.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define CreateDir( x ) mkdir( x, 0777 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define CreateDir( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR "mapfile_test/"
+
+typedef struct
+{
+	char name[56];
+	int  filepos;
+	int  filelen;
+} testpakfile_t;
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	// force it for 32-bit too
+	putenv( (char *)"XASH3D_ARCHIVE_MMAP=1" );
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+static qboolean WritePak( const char *path, const char **names, int numnames, const char *contents )
+{
+	testpakfile_t files[8];
+	int header[3], i, ofs = sizeof( header );
+	FILE *f = fopen( path, "wb" );
+
+	if( !f )
+		return false;
+
+	memset( files, 0, sizeof( files ));
+
+	for( i = 0; i < numnames; i++ )
+	{
+		strncpy( files[i].name, names[i], sizeof( files[i].name ) - 1 );
+		files[i].filepos = ofs;
+		files[i].filelen = strlen( contents );
+		ofs += files[i].filelen;
+	}
+
+	header[0] = ( 'K' << 24 ) + ( 'C' << 16 ) + ( 'A' << 8 ) + 'P';
+	header[1] = ofs;
+	header[2] = sizeof( testpakfile_t ) * numnames;
+
+	fwrite( header, sizeof( header ), 1, f );
+	for( i = 0; i < numnames; i++ )
+		fwrite( contents, strlen( contents ), 1, f );
+	fwrite( files, sizeof( testpakfile_t ), numnames, f );
+	fclose( f );
+
+	return true;
+}
+
+static qboolean TestMapFile( void )
+{
+	const char *pak0[] = { "maps/test.bsp", "gfx/test.lmp" };
+	const byte *view, *view2;
+	fs_offset_t len, len2;
+	byte *data;
+
+	CreateDir( TEST_DIR );
+
+	if( !WritePak( TEST_DIR "pak0.pak", pak0, 2, "stored data" ))
+		return false;
+
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	view = g_fs.MapFile( "maps/test.bsp", &len, false );
+	data = g_fs.LoadFile( "maps/test.bsp", &len2, false );
+
+	if( !view || !data || len != len2 || memcmp( view, data, len ))
+	{
+		printf( "MapFile doesn't match LoadFile\n" );
+		return false;
+	}
+
+	free( data );
+
+	// loose files are loaded
+	g_fs.WriteFile( "loose.txt", "loose", 5 );
+	view2 = g_fs.MapFile( "loose.txt", &len2, false );
+
+	if( !view2 || len2 != 5 || memcmp( view2, "loose", 5 ))
+	{
+		printf( "MapFile fallback fail\n" );
+		return false;
+	}
+
+	g_fs.UnmapFile( view2 );
+	g_fs.Delete( "loose.txt" );
+
+	if( g_fs.MapFile( "maps/none.bsp", &len2, false ))
+	{
+		printf( "MapFile on missing file\n" );
+		return false;
+	}
+
+	// view stays valid until it's released
+	g_fs.ClearSearchPath();
+
+	if( memcmp( view, "stored data", len ))
+	{
+		printf( "view is gone after unmount\n" );
+		return false;
+	}
+
+	g_fs.UnmapFile( view );
+
+	remove( TEST_DIR "pak0.pak" );
+	remove( TEST_DIR );
+
+	return true;
+}
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !TestMapFile())
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
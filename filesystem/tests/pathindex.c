@@ -0,0 +1,186 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "filesystem.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define CreateDir( x ) mkdir( x, 0777 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define CreateDir( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR "pathindex_test/"
+
+typedef struct
+{
+	char name[56];
+	int  filepos;
+	int  filelen;
+} testpakfile_t;
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+// every file contains its own name, so it's easy to tell where it came from
+static qboolean WritePak( const char *path, const char **names, int numnames, const char *contents )
+{
+	testpakfile_t files[8];
+	int header[3], i, ofs = sizeof( header );
+	FILE *f = fopen( path, "wb" );
+
+	if( !f )
+		return false;
+
+	memset( files, 0, sizeof( files ));
+
+	for( i = 0; i < numnames; i++ )
+	{
+		strncpy( files[i].name, names[i], sizeof( files[i].name ) - 1 );
+		files[i].filepos = ofs;
+		files[i].filelen = strlen( contents );
+		ofs += files[i].filelen;
+	}
+
+	header[0] = ( 'K' << 24 ) + ( 'C' << 16 ) + ( 'A' << 8 ) + 'P';
+	header[1] = ofs;
+	header[2] = sizeof( testpakfile_t ) * numnames;
+
+	fwrite( header, sizeof( header ), 1, f );
+	for( i = 0; i < numnames; i++ )
+		fwrite( contents, strlen( contents ), 1, f );
+	fwrite( files, sizeof( testpakfile_t ), numnames, f );
+	fclose( f );
+
+	return true;
+}
+
+static qboolean CheckFile( const char *path, const char *contents )
+{
+	fs_offset_t len;
+	byte *data = g_fs.LoadFile( path, &len, false );
+	qboolean ok;
+
+	if( !data )
+	{
+		printf( "%s: not found, expected %s\n", path, contents );
+		return false;
+	}
+
+	ok = len == strlen( contents ) && !memcmp( data, contents, len );
+	if( !ok )
+		printf( "%s: wrong file, expected %s\n", path, contents );
+
+	free( data );
+	return ok;
+}
+
+static qboolean TestPathIndex( void )
+{
+	const char *pak0[] = { "models/Foo.mdl", "sound/a.wav" };
+	const char *pak1[] = { "MODELS/foo.mdl" };
+	file_t *f;
+	FILE *f2;
+
+	CreateDir( TEST_DIR );
+
+	if( !WritePak( TEST_DIR "pak0.pak", pak0, 2, "pak0" ) || !WritePak( TEST_DIR "pak1.pak", pak1, 1, "pak1" ))
+		return false;
+
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	// later archive has priority, names are case insensitive
+	if( !CheckFile( "models/foo.mdl", "pak1" ))
+		return false;
+
+	if( !CheckFile( "Sound/A.wav", "pak0" ))
+		return false;
+
+	if( g_fs.FileExists( "models/bar.mdl", false ))
+	{
+		printf( "FileExists fail\n" );
+		return false;
+	}
+
+	// loose files override archives, even if they appear after the index was built
+	f = g_fs.Open( "models/foo.mdl", "wb", true );
+	g_fs.Write( f, "loose", 5 );
+	g_fs.Close( f );
+
+	if( !CheckFile( "models/foo.mdl", "loose" ))
+		return false;
+
+	f2 = fopen( TEST_DIR "sound/A.wav", "wb" );
+	if( !f2 )
+	{
+		CreateDir( TEST_DIR "sound" );
+		f2 = fopen( TEST_DIR "sound/A.wav", "wb" );
+	}
+	fwrite( "direct", 6, 1, f2 );
+	fclose( f2 );
+
+	if( !CheckFile( "sound/a.wav", "direct" ))
+		return false;
+
+	g_fs.Delete( "models/foo.mdl" );
+	g_fs.Delete( "sound/a.wav" );
+
+	if( !CheckFile( "models/foo.mdl", "pak1" ))
+		return false;
+
+	g_fs.Delete( "models" );
+	g_fs.Delete( "sound" );
+
+	// unmounting drops the archives
+	g_fs.ClearSearchPath();
+
+	if( g_fs.FileExists( "sound/a.wav", false ))
+	{
+		printf( "ClearSearchPath fail\n" );
+		return false;
+	}
+
+	remove( TEST_DIR "pak0.pak" );
+	remove( TEST_DIR "pak1.pak" );
+	remove( TEST_DIR );
+
+	return true;
+}
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !TestPathIndex())
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,223 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "filesystem.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define CreateDir( x ) mkdir( x, 0777 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define CreateDir( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR   "zipcache_test/"
+#define TEST_LINES 400
+#define LINE_LEN   25
+
+// sound/test.txt deflated, each line is "line %04d of cached file\n"
+static const unsigned char test_pk3[] =
+{
+	0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0xd8, 0x36, 0x53, 0x5d, 0x32, 0x19,
+	0xd7, 0x0c, 0x82, 0x03, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00, 0x73, 0x6f,
+	0x75, 0x6e, 0x64, 0x2f, 0x74, 0x65, 0x73, 0x74, 0x2e, 0x74, 0x78, 0x74, 0x75, 0xd6, 0x3b, 0x8e,
+	0x58, 0x05, 0x00, 0x43, 0xd1, 0x9e, 0x55, 0xcc, 0x12, 0xb0, 0xfd, 0xbe, 0xcb, 0x41, 0x61, 0xa2,
+	0x44, 0x1a, 0x25, 0xfb, 0xef, 0xa0, 0xa0, 0x43, 0xc7, 0xad, 0xab, 0xdb, 0x9d, 0xaf, 0x9f, 0xbf,
+	0x3e, 0x3f, 0xfe, 0xfc, 0x77, 0x1f, 0xbf, 0xbf, 0x7f, 0x7c, 0xfb, 0xeb, 0xdb, 0x8f, 0xcf, 0xbf,
+	0x3f, 0xbe, 0xff, 0xfc, 0xfa, 0xfc, 0xe3, 0xeb, 0xbf, 0x23, 0x3a, 0xaa, 0x63, 0x3a, 0x0e, 0x1d,
+	0xa7, 0x8e, 0x4b, 0xc7, 0xad, 0xe3, 0xd1, 0xf1, 0xe2, 0x88, 0xca, 0xa3, 0xf2, 0xa8, 0x3c, 0x2a,
+	0x8f, 0xca, 0xa3, 0xf2, 0xa8, 0x3c, 0x2a, 0x8f, 0xca, 0xa3, 0xf2, 0xaa, 0xbc, 0x2a, 0xaf, 0xca,
+	0xab, 0xf2, 0xaa, 0xbc, 0x2a, 0xaf, 0xca, 0xab, 0xf2, 0xaa, 0xbc, 0x2a, 0x9f, 0xca, 0xa7, 0xf2,
+	0xa9, 0x7c, 0x2a, 0x9f, 0xca, 0xa7, 0xf2, 0xa9, 0x7c, 0x2a, 0x9f, 0xca, 0xa7, 0xf2, 0x43, 0xe5,
+	0x87, 0xca, 0x0f, 0x95, 0x1f, 0x2a, 0x3f, 0x54, 0x7e, 0xa8, 0xfc, 0x50, 0xf9, 0xa1, 0xf2, 0x43,
+	0xe5, 0x87, 0xca, 0x4f, 0x95, 0x9f, 0x2a, 0x3f, 0x55, 0x7e, 0xaa, 0xfc, 0x54, 0xf9, 0xa9, 0xf2,
+	0x53, 0xe5, 0xa7, 0xca, 0x4f, 0x95, 0x9f, 0x2a, 0xbf, 0x54, 0x7e, 0xa9, 0xfc, 0x52, 0xf9, 0xa5,
+	0xf2, 0x4b, 0xe5, 0x97, 0xca, 0x2f, 0x95, 0x5f, 0x2a, 0xbf, 0x54, 0x7e, 0xa9, 0xfc, 0x56, 0xf9,
+	0xad, 0xf2, 0x5b, 0xe5, 0xb7, 0xca, 0x6f, 0x95, 0xdf, 0x2a, 0xbf, 0x55, 0x7e, 0xab, 0xfc, 0x56,
+	0xf9, 0xad, 0xf2, 0x47, 0xe5, 0x8f, 0xca, 0x1f, 0x95, 0x3f, 0x2a, 0x7f, 0x54, 0xfe, 0xa8, 0xfc,
+	0x51, 0xf9, 0xa3, 0xf2, 0x47, 0xe5, 0x8f, 0xca, 0x5f, 0x95, 0xbf, 0x2a, 0x7f, 0x55, 0xfe, 0xaa,
+	0xfc, 0x55, 0xf9, 0xab, 0xf2, 0x57, 0xe5, 0xaf, 0xca, 0x5f, 0x95, 0xbf, 0x28, 0x8f, 0x0c, 0x17,
+	0x19, 0x2e, 0x32, 0x5c, 0x64, 0xb8, 0xc8, 0x70, 0x91, 0xe1, 0x22, 0xc3, 0x45, 0x86, 0x8b, 0x0c,
+	0x17, 0x19, 0x2e, 0x32, 0x5c, 0x64, 0xb8, 0xc8, 0x70, 0x91, 0xe1, 0x22, 0xc3, 0x45, 0x86, 0x8b,
+	0x0c, 0x17, 0x19, 0x2e, 0x32, 0x5c, 0x64, 0xb8, 0xc8, 0x70, 0x91, 0xe1, 0x22, 0xc3, 0x45, 0x86,
+	0x8b, 0x0c, 0x17, 0x19, 0x2e, 0x32, 0x5c, 0x64, 0xb8, 0xc8, 0x70, 0x91, 0xe1, 0x22, 0xc3, 0x45,
+	0x86, 0x8b, 0x0c, 0x17, 0x19, 0x2e, 0x32, 0x5c, 0x64, 0xb8, 0xc8, 0x70, 0x91, 0xe1, 0x22, 0xc3,
+	0x45, 0x86, 0x8b, 0x0c, 0x17, 0x19, 0x2e, 0x32, 0x5c, 0x64, 0xb8, 0xc8, 0x70, 0x91, 0xe1, 0x22,
+	0xc3, 0x45, 0x86, 0x8b, 0x0c, 0x17, 0x19, 0x2e, 0x32, 0x5c, 0x64, 0xb8, 0xc8, 0x70, 0x91, 0xe1,
+	0x22, 0xc3, 0x45, 0x86, 0x8b, 0x0c, 0x17, 0x19, 0x2e, 0x32, 0x5c, 0x64, 0xb8, 0xc8, 0x70, 0x91,
+	0xe1, 0x22, 0xc3, 0x45, 0x86, 0x8b, 0x0c, 0x17, 0x19, 0x2e, 0x32, 0x5c, 0x64, 0xb8, 0xc8, 0x70,
+	0x91, 0xe1, 0x22, 0xc3, 0x45, 0x86, 0x8b, 0x0c, 0x17, 0x19, 0x2e, 0x32, 0x5c, 0x64, 0xb8, 0xc8,
+	0x70, 0x91, 0xe1, 0x22, 0xc3, 0x45, 0x86, 0x8b, 0x0c, 0x17, 0x19, 0x2e, 0x32, 0x5c, 0x64, 0xb8,
+	0xc8, 0x70, 0x91, 0xe1, 0x22, 0xc3, 0x45, 0x86, 0x8b, 0x0c, 0x17, 0x19, 0x2e, 0x32, 0x5c, 0x64,
+	0xb8, 0xc8, 0x70, 0x91, 0xe1, 0x22, 0xc3, 0x45, 0x86, 0x8b, 0x0c, 0x17, 0x19, 0x2e, 0x32, 0x5c,
+	0x64, 0xb8, 0xca, 0x70, 0x95, 0xe1, 0x2a, 0xc3, 0x55, 0x86, 0xab, 0x0c, 0x57, 0x19, 0xae, 0x32,
+	0x5c, 0x65, 0xb8, 0xca, 0x70, 0x95, 0xe1, 0x2a, 0xc3, 0x55, 0x86, 0xab, 0x0c, 0x57, 0x19, 0xae,
+	0x32, 0x5c, 0x65, 0xb8, 0xca, 0x70, 0x95, 0xe1, 0x2a, 0xc3, 0x55, 0x86, 0xab, 0x0c, 0x57, 0x19,
+	0xae, 0x32, 0x5c, 0x65, 0xb8, 0xca, 0x70, 0x95, 0xe1, 0x2a, 0xc3, 0x55, 0x86, 0xab, 0x0c, 0x57,
+	0x19, 0xae, 0x32, 0x5c, 0x65, 0xb8, 0xca, 0x70, 0x95, 0xe1, 0x2a, 0xc3, 0x55, 0x86, 0xab, 0x0c,
+	0x57, 0x19, 0xae, 0x32, 0x5c, 0x65, 0xb8, 0xca, 0x70, 0x95, 0xe1, 0x2a, 0xc3, 0x55, 0x86, 0xab,
+	0x0c, 0x57, 0x19, 0xae, 0x32, 0x5c, 0x65, 0xb8, 0xca, 0x70, 0x95, 0xe1, 0x2a, 0xc3, 0x55, 0x86,
+	0xab, 0x0c, 0x57, 0x19, 0xae, 0x32, 0x5c, 0x65, 0xb8, 0xca, 0x70, 0x95, 0xe1, 0x2a, 0xc3, 0x55,
+	0x86, 0xab, 0x0c, 0x57, 0x19, 0xae, 0x32, 0x5c, 0x65, 0xb8, 0xca, 0x70, 0x95, 0xe1, 0x2a, 0xc3,
+	0x55, 0x86, 0xab, 0x0c, 0x57, 0x19, 0xae, 0x32, 0x5c, 0x65, 0xb8, 0xca, 0x70, 0x95, 0xe1, 0x2a,
+	0xc3, 0x55, 0x86, 0xab, 0x0c, 0x57, 0x19, 0xae, 0x32, 0x5c, 0x65, 0xb8, 0xca, 0x70, 0x95, 0xe1,
+	0x2a, 0xc3, 0x55, 0x86, 0xab, 0x0c, 0x57, 0x19, 0xae, 0x32, 0x5c, 0x65, 0xb8, 0xca, 0x70, 0x95,
+	0xe1, 0x2a, 0xc3, 0x55, 0x86, 0xab, 0x0c, 0x57, 0x19, 0xae, 0x32, 0x5c, 0x65, 0xb8, 0xca, 0x70,
+	0x95, 0xe1, 0x2a, 0xc3, 0x55, 0x86, 0x9b, 0x0c, 0x37, 0x19, 0x6e, 0x32, 0xdc, 0x64, 0xb8, 0xc9,
+	0x70, 0x93, 0xe1, 0x26, 0xc3, 0x4d, 0x86, 0x9b, 0x0c, 0x37, 0x19, 0x6e, 0x32, 0xdc, 0x64, 0xb8,
+	0xc9, 0x70, 0x93, 0xe1, 0x26, 0xc3, 0x4d, 0x86, 0x9b, 0x0c, 0x37, 0x19, 0x6e, 0x32, 0xdc, 0x64,
+	0xb8, 0xc9, 0x70, 0x93, 0xe1, 0x26, 0xc3, 0x4d, 0x86, 0x9b, 0x0c, 0x37, 0x19, 0x6e, 0x32, 0xdc,
+	0x64, 0xb8, 0xc9, 0x70, 0x93, 0xe1, 0x26, 0xc3, 0x4d, 0x86, 0x9b, 0x0c, 0x37, 0x19, 0x6e, 0x32,
+	0xdc, 0x64, 0xb8, 0xc9, 0x70, 0x93, 0xe1, 0x26, 0xc3, 0x4d, 0x86, 0x9b, 0x0c, 0x37, 0x19, 0x6e,
+	0x32, 0xdc, 0x64, 0xb8, 0xc9, 0x70, 0x93, 0xe1, 0x26, 0xc3, 0x4d, 0x86, 0x9b, 0x0c, 0x37, 0x19,
+	0x6e, 0x32, 0xdc, 0x64, 0xb8, 0xc9, 0x70, 0x93, 0xe1, 0x26, 0xc3, 0x4d, 0x86, 0x9b, 0x0c, 0x37,
+	0x19, 0x6e, 0x32, 0xdc, 0x64, 0xb8, 0xc9, 0x70, 0x93, 0xe1, 0x26, 0xc3, 0x4d, 0x86, 0x9b, 0x0c,
+	0x37, 0x19, 0x6e, 0x32, 0xdc, 0x64, 0xb8, 0xc9, 0x70, 0x93, 0xe1, 0x26, 0xc3, 0x4d, 0x86, 0x9b,
+	0x0c, 0x37, 0x19, 0x6e, 0x32, 0xdc, 0x64, 0xb8, 0xc9, 0x70, 0x93, 0xe1, 0x26, 0xc3, 0x4d, 0x86,
+	0x9b, 0x0c, 0x37, 0x19, 0x6e, 0x32, 0xdc, 0x64, 0xb8, 0xc9, 0x70, 0x93, 0xe1, 0x26, 0xc3, 0x4d,
+	0x86, 0x9b, 0x0c, 0x37, 0x19, 0x6e, 0x32, 0xdc, 0x64, 0xb8, 0xc9, 0x70, 0x93, 0xe1, 0x26, 0xc3,
+	0x4d, 0x86, 0x9b, 0x0c, 0x37, 0x19, 0x6e, 0x32, 0xdc, 0xfe, 0x6f, 0xb8, 0x7f, 0x00, 0x50, 0x4b,
+	0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0xd8, 0x36, 0x53, 0x5d, 0x32, 0x19,
+	0xd7, 0x0c, 0x82, 0x03, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x73, 0x6f, 0x75, 0x6e,
+	0x64, 0x2f, 0x74, 0x65, 0x73, 0x74, 0x2e, 0x74, 0x78, 0x74, 0x50, 0x4b, 0x05, 0x06, 0x00, 0x00,
+	0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x3c, 0x00, 0x00, 0x00, 0xae, 0x03, 0x00, 0x00, 0x00, 0x00
+};
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+static qboolean CheckLine( const char *data, int line )
+{
+	char expected[32];
+
+	snprintf( expected, sizeof( expected ), "line %04d of cached file\n", line );
+	return !memcmp( data, expected, LINE_LEN );
+}
+
+static qboolean CheckLoadFile( void )
+{
+	fs_offset_t len;
+	byte *data = g_fs.LoadFile( "sound/test.txt", &len, false );
+	int i;
+
+	if( !data || len != TEST_LINES * LINE_LEN )
+	{
+		printf( "LoadFile fail\n" );
+		free( data );
+		return false;
+	}
+
+	for( i = 0; i < TEST_LINES; i++ )
+	{
+		if( !CheckLine( (char *)data + i * LINE_LEN, i ))
+		{
+			printf( "LoadFile contents fail at line %d\n", i );
+			free( data );
+			return false;
+		}
+	}
+
+	free( data );
+	return true;
+}
+
+static qboolean CheckStream( void )
+{
+	file_t *f = g_fs.Open( "sound/test.txt", "rb", false );
+	char buf[LINE_LEN * 8];
+	int i;
+
+	if( !f )
+	{
+		printf( "Open fail\n" );
+		return false;
+	}
+
+	// small reads while seeking back
+	for( i = TEST_LINES - 1; i >= 0; i -= 37 )
+	{
+		if( g_fs.Seek( f, i * LINE_LEN, SEEK_SET ) || g_fs.Read( f, buf, LINE_LEN ) != LINE_LEN || !CheckLine( buf, i ))
+		{
+			printf( "stream fail at line %d\n", i );
+			g_fs.Close( f );
+			return false;
+		}
+	}
+
+	// read past the end
+	g_fs.Seek( f, -LINE_LEN * 2, SEEK_END );
+	if( g_fs.Read( f, buf, sizeof( buf )) != LINE_LEN * 2 || !CheckLine( buf + LINE_LEN, TEST_LINES - 1 ) || !g_fs.Eof( f ))
+	{
+		printf( "stream end fail\n" );
+		g_fs.Close( f );
+		return false;
+	}
+
+	g_fs.Close( f );
+	return true;
+}
+
+static qboolean TestZipCache( void )
+{
+	FILE *f;
+	qboolean ok;
+
+	CreateDir( TEST_DIR );
+
+	f = fopen( TEST_DIR "test.pk3", "wb" );
+	if( !f )
+		return false;
+	fwrite( test_pk3, sizeof( test_pk3 ), 1, f );
+	fclose( f );
+
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	// first stream inflates, first load fills the cache
+	// and everything after that is served from it
+	ok = CheckStream() && CheckLoadFile() && CheckLoadFile() && CheckStream();
+	g_fs.Path_f(); // prints cache statistics
+
+	g_fs.ClearSearchPath();
+	remove( TEST_DIR "test.pk3" );
+	remove( TEST_DIR );
+
+	return ok;
+}
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !TestZipCache())
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
@@ -57,6 +57,7 @@ struct wfile_s
 	int		numlumps;
 	poolhandle_t mempool;			// W_ReadLump temp buffers
 	file_t		*handle;
+	fs_mapping_t	*map;
 	dlumpinfo_t	*lumps;
 	time_t		filetime;
 };
@@ -235,6 +236,7 @@ finalize wad or just close
 static void FS_CloseWAD( wfile_t *wad )
 {
 	Mem_FreePool( &wad->mempool );
+	FS_ReleaseMapping( wad->map );
 	if( wad->handle != NULL )
 		FS_Close( wad->handle );
 	Mem_Free( wad ); // free himself
@@ -390,6 +392,7 @@ static wfile_t *W_Open( const char *filename, int *error, uint flags )
 
 	// release source lumps
 	Mem_Free( srclumps );
+	wad->map = FS_MapHandle( wad->handle );
 
 	// and leave the file open
 	return wad;
@@ -614,6 +617,22 @@ static byte *W_ReadLump( searchpath_t *search, const char *path, int pack_ind, f
 	return buf;
 }
 
+/*
+===========
+W_MapLump
+
+===========
+*/
+static const byte *W_MapLump( searchpath_t *search, int pack_ind, fs_offset_t *size, fs_mapping_t **map )
+{
+	const dlumpinfo_t *lump = &search->wad->lumps[pack_ind];
+
+	*size = lump->disksize;
+	*map = search->wad->map;
+
+	return FS_MappingView( search->wad->map, lump->filepos, lump->disksize );
+}
+
 /*
 ====================
 FS_AddWad_Fullpath
@@ -647,6 +666,7 @@ searchpath_t *FS_AddWad_Fullpath( const char *wadfile, int flags )
 	search->pfnFindFile = FS_FindFile_WAD;
 	search->pfnSearch = FS_Search_WAD;
 	search->pfnLoadFile = W_ReadLump;
+	search->pfnMapFile = W_MapLump;
 
 	Con_Reportf( "Adding WAD: %s (%i files)\n", wadfile, wad->numlumps );
 	return search;
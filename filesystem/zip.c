@@ -123,12 +123,190 @@ typedef struct zipfile_s
 struct zip_s
 {
 	file_t *handle;
+	fs_mapping_t *map;
 	int		numfiles;
 	zipfile_t files[]; // flexible
 };
 
 // #define ENABLE_CRC_CHECK // known to be buggy because of possible libpublic crc32 bug, disabled
 
+#define ZIP_CACHE_SIZE	32 // default budget in megabytes, XASH3D_ZIP_CACHE_SIZE overrides it
+#define ZIP_CACHE_HASH	256 // must be power of 2
+
+// decompressed deflated entry
+struct zipcache_s
+{
+	struct zipcache_s *prev, *next; // LRU order, most recently used first
+	struct zipcache_s *hashnext;
+	const zip_t *zip;
+	int         index;
+	int         refcount; // one for the cache itself and one for each open file
+	qboolean    linked;
+	fs_offset_t size;
+	byte        data[]; // flexible
+};
+
+static struct
+{
+	zipcache_t *head, *tail;
+	zipcache_t *hash[ZIP_CACHE_HASH];
+	size_t     budget;
+	size_t     bytes;
+	int        count;
+	size_t     hits, misses, evictions;
+	qboolean   initialized;
+} zip_cache;
+
+static uint FS_ZipCacheHash( const zip_t *zip, int index )
+{
+	return ((uint)((uintptr_t)zip >> 4 ) ^ (uint)index * 2654435761U ) & ( ZIP_CACHE_HASH - 1 );
+}
+
+static size_t FS_ZipCacheBudget( void )
+{
+	if( !zip_cache.initialized )
+	{
+		const char *str = getenv( "XASH3D_ZIP_CACHE_SIZE" );
+		int megabytes = COM_CheckString( str ) ? Q_atoi( str ) : ZIP_CACHE_SIZE;
+
+		zip_cache.budget = megabytes > 0 ? (size_t)megabytes * 1024 * 1024 : 0;
+		zip_cache.initialized = true;
+	}
+
+	return zip_cache.budget;
+}
+
+/*
+============
+FS_ZipCacheRelease
+
+entry is freed when it's evicted and isn't used by open files
+============
+*/
+void FS_ZipCacheRelease( zipcache_t *entry )
+{
+	if( --entry->refcount <= 0 )
+		Mem_Free( entry );
+}
+
+const byte *FS_ZipCacheData( const zipcache_t *entry )
+{
+	return entry->data;
+}
+
+static void FS_ZipCacheUnlink( zipcache_t *entry )
+{
+	zipcache_t **prev;
+
+	for( prev = &zip_cache.hash[FS_ZipCacheHash( entry->zip, entry->index )]; *prev; prev = &( *prev )->hashnext )
+	{
+		if( *prev == entry )
+		{
+			*prev = entry->hashnext;
+			break;
+		}
+	}
+
+	if( entry->prev ) entry->prev->next = entry->next;
+	else zip_cache.head = entry->next;
+
+	if( entry->next ) entry->next->prev = entry->prev;
+	else zip_cache.tail = entry->prev;
+
+	zip_cache.bytes -= entry->size;
+	zip_cache.count--;
+	entry->linked = false;
+
+	FS_ZipCacheRelease( entry );
+}
+
+static zipcache_t *FS_ZipCacheFind( const zip_t *zip, int index )
+{
+	zipcache_t *entry;
+
+	for( entry = zip_cache.hash[FS_ZipCacheHash( zip, index )]; entry; entry = entry->hashnext )
+	{
+		if( entry->zip != zip || entry->index != index )
+			continue;
+
+		// move to the front
+		if( entry->prev )
+		{
+			entry->prev->next = entry->next;
+			if( entry->next ) entry->next->prev = entry->prev;
+			else zip_cache.tail = entry->prev;
+
+			entry->prev = NULL;
+			entry->next = zip_cache.head;
+			zip_cache.head->prev = entry;
+			zip_cache.head = entry;
+		}
+
+		zip_cache.hits++;
+		return entry;
+	}
+
+	zip_cache.misses++;
+	return NULL;
+}
+
+static void FS_ZipCacheInsert( const zip_t *zip, int index, const byte *data, fs_offset_t size )
+{
+	const size_t budget = FS_ZipCacheBudget();
+	zipcache_t *entry;
+	uint hash;
+
+	// don't let single large file flush everything
+	if( (size_t)size > budget / 4 )
+		return;
+
+	while( zip_cache.tail && zip_cache.bytes + size > budget )
+	{
+		FS_ZipCacheUnlink( zip_cache.tail );
+		zip_cache.evictions++;
+	}
+
+	entry = (zipcache_t *)Mem_Malloc( fs_mempool, sizeof( *entry ) + size );
+	entry->zip = zip;
+	entry->index = index;
+	entry->refcount = 1;
+	entry->linked = true;
+	entry->size = size;
+	memcpy( entry->data, data, size );
+
+	hash = FS_ZipCacheHash( zip, index );
+	entry->hashnext = zip_cache.hash[hash];
+	zip_cache.hash[hash] = entry;
+
+	entry->prev = NULL;
+	entry->next = zip_cache.head;
+	if( zip_cache.head ) zip_cache.head->prev = entry;
+	else zip_cache.tail = entry;
+	zip_cache.head = entry;
+
+	zip_cache.bytes += size;
+	zip_cache.count++;
+}
+
+/*
+============
+FS_ZipCachePrintInfo
+============
+*/
+void FS_ZipCachePrintInfo( void )
+{
+	const size_t lookups = zip_cache.hits + zip_cache.misses;
+	string used;
+
+	if( !lookups )
+		return;
+
+	Q_strncpy( used, Q_memprint( zip_cache.bytes ), sizeof( used ));
+	Con_Printf( "ZIP cache: %s of %s in %i entries, %zu hits (%.1f%%), %zu misses, %zu evictions\n",
+		used, Q_memprint( FS_ZipCacheBudget( )), zip_cache.count, zip_cache.hits,
+		zip_cache.hits * 100.0 / lookups, zip_cache.misses, zip_cache.evictions );
+}
+
 /*
 ============
 FS_CloseZIP
@@ -136,6 +314,18 @@ FS_CloseZIP
 */
 static void FS_CloseZIP( zip_t *zip )
 {
+	zipcache_t *entry, *next;
+
+	for( entry = zip_cache.head; entry; entry = next )
+	{
+		next = entry->next;
+
+		if( entry->zip == zip )
+			FS_ZipCacheUnlink( entry );
+	}
+
+	FS_ReleaseMapping( zip->map );
+
 	if( zip->handle != NULL )
 		FS_Close( zip->handle );
 
@@ -408,6 +598,7 @@ static zip_t *FS_LoadZip( const char *zipfile, int *error )
 
 	zip->numfiles = numpackfiles;
 	qsort( zip->files, zip->numfiles, sizeof( *zip->files ), FS_SortZip );
+	zip->map = FS_MapHandle( zip->handle );
 
 	if( error )
 		*error = ZIP_LOAD_OK;
@@ -433,9 +624,20 @@ static file_t *FS_OpenFile_ZIP( searchpath_t *search, const char *filename, cons
 	if( pfile->flags == ZIP_COMPRESSION_DEFLATED )
 	{
 		ztoolkit_t *ztk;
+		zipcache_t *entry;
 
 		SetBits( f->flags, FILE_DEFLATED );
 
+		// read straight from decompressed copy
+		if( FS_ZipCacheBudget() && ( entry = FS_ZipCacheFind( search->zip, pack_ind )) != NULL )
+		{
+			ztk = Mem_Calloc( fs_mempool, sizeof( *ztk ));
+			ztk->cache = entry;
+			entry->refcount++;
+			f->ztk = ztk;
+			return f;
+		}
+
 		ztk = Mem_Calloc( fs_mempool, sizeof( *ztk ));
 		ztk->comp_length = pfile->compressed_size;
 		ztk->zstream.next_in = ztk->input;
@@ -464,6 +666,26 @@ static file_t *FS_OpenFile_ZIP( searchpath_t *search, const char *filename, cons
 	return f;
 }
 
+/*
+===========
+FS_MapFile_ZIP
+
+only stored files can be viewed in place
+===========
+*/
+static const byte *FS_MapFile_ZIP( searchpath_t *search, int pack_ind, fs_offset_t *size, fs_mapping_t **map )
+{
+	zipfile_t *pfile = &search->zip->files[pack_ind];
+
+	if( pfile->flags != ZIP_COMPRESSION_NO_COMPRESSION )
+		return NULL;
+
+	*size = pfile->size;
+	*map = search->zip->map;
+
+	return FS_MappingView( search->zip->map, pfile->offset, pfile->size );
+}
+
 /*
 ===========
 FS_LoadZIPFile
@@ -534,6 +756,16 @@ static byte *FS_LoadZIPFile( searchpath_t *search, const char *path, int pack_in
 	}
 	else if( file->flags == ZIP_COMPRESSION_DEFLATED )
 	{
+		const qboolean usecache = FS_ZipCacheBudget() != 0;
+		zipcache_t *entry;
+
+		if( usecache && ( entry = FS_ZipCacheFind( search->zip, pack_ind )) != NULL )
+		{
+			memcpy( decompressed_buffer, entry->data, file->size );
+			if( sizeptr ) *sizeptr = file->size;
+			return decompressed_buffer;
+		}
+
 		compressed_buffer = (byte *)Mem_Malloc( fs_mempool, file->compressed_size + 1 );
 
 		c = FS_Read( search->zip->handle, compressed_buffer, file->compressed_size );
@@ -581,6 +813,9 @@ static byte *FS_LoadZIPFile( searchpath_t *search, const char *path, int pack_in
 				return NULL;
 			}
 #endif
+			if( usecache )
+				FS_ZipCacheInsert( search->zip, pack_ind, decompressed_buffer, file->size );
+
 			if( sizeptr ) *sizeptr = file->size;
 
 			return decompressed_buffer;
@@ -665,6 +900,20 @@ static int FS_FindFile_ZIP( searchpath_t *search, const char *path, char *fixedn
 	return -1;
 }
 
+/*
+===========
+FS_FileName_ZIP
+
+===========
+*/
+static const char *FS_FileName_ZIP( searchpath_t *search, int index )
+{
+	if( index < 0 || index >= search->zip->numfiles )
+		return NULL;
+
+	return search->zip->files[index].name;
+}
+
 /*
 ===========
 FS_Search_ZIP
@@ -743,6 +992,8 @@ searchpath_t *FS_AddZip_Fullpath( const char *zipfile, int flags )
 	search->pfnOpenFile = FS_OpenFile_ZIP;
 	search->pfnFileTime = FS_FileTime_ZIP;
 	search->pfnFindFile = FS_FindFile_ZIP;
+	search->pfnFileName = FS_FileName_ZIP;
+	search->pfnMapFile = FS_MapFile_ZIP;
 	search->pfnSearch = FS_Search_ZIP;
 	search->pfnLoadFile = FS_LoadZIPFile;
 
@@ -0,0 +1,245 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "port.h"
+#include "crtlib.h"
+#include "xash3d_types.h"
+#include "const.h"
+#include "com_model.h"
+#include "xash3d_mathlib.h"
+#include "studio.h"
+
+#define NUM_POSES	64
+#define TOLERANCE	0.00001f
+
+static vec4_t q1[NUM_POSES][MAXSTUDIOBONES];
+static vec4_t q2[NUM_POSES][MAXSTUDIOBONES];
+static vec3_t pos1[NUM_POSES][MAXSTUDIOBONES];
+static vec3_t pos2[NUM_POSES][MAXSTUDIOBONES];
+
+static float RandomFloat( float min, float max )
+{
+	return min + ( max - min ) * ( rand() / (float)RAND_MAX );
+}
+
+static void InitPoses( void )
+{
+	int i, j;
+
+	srand( 1337 );
+
+	for( i = 0; i < NUM_POSES; i++ )
+	{
+		for( j = 0; j < MAXSTUDIOBONES; j++ )
+		{
+			vec3_t angles;
+
+			angles[0] = RandomFloat( -M_PI_F, M_PI_F );
+			angles[1] = RandomFloat( -M_PI_F, M_PI_F );
+			angles[2] = RandomFloat( -M_PI_F, M_PI_F );
+			AngleQuaternion( angles, q1[i][j], true );
+
+			switch( j & 3 )
+			{
+			case 0: // same pose
+				Vector4Copy( q1[i][j], q2[i][j] );
+				break;
+			case 1: // same pose, flipped sign
+				q2[i][j][0] = -q1[i][j][0];
+				q2[i][j][1] = -q1[i][j][1];
+				q2[i][j][2] = -q1[i][j][2];
+				q2[i][j][3] = -q1[i][j][3];
+				break;
+			default:
+				angles[0] = RandomFloat( -M_PI_F, M_PI_F );
+				angles[1] = RandomFloat( -M_PI_F, M_PI_F );
+				angles[2] = RandomFloat( -M_PI_F, M_PI_F );
+				AngleQuaternion( angles, q2[i][j], true );
+				break;
+			}
+
+			pos1[i][j][0] = RandomFloat( -64.0f, 64.0f );
+			pos1[i][j][1] = RandomFloat( -64.0f, 64.0f );
+			pos1[i][j][2] = RandomFloat( -64.0f, 64.0f );
+			pos2[i][j][0] = RandomFloat( -64.0f, 64.0f );
+			pos2[i][j][1] = RandomFloat( -64.0f, 64.0f );
+			pos2[i][j][2] = RandomFloat( -64.0f, 64.0f );
+		}
+	}
+}
+
+// per bone blending, how it was done before
+static void SlerpBonesReference( int numbones, vec4_t q1[], float pos1[][3], const vec4_t q2[], const float pos2[][3], float s )
+{
+	int i;
+
+	s = bound( 0.0f, s, 1.0f );
+
+	for( i = 0; i < numbones; i++ )
+	{
+		QuaternionSlerp( q1[i], q2[i], s, q1[i] );
+		VectorLerp( pos1[i], s, pos2[i], pos1[i] );
+	}
+}
+
+static int Test_SlerpBones( void )
+{
+	static const float fractions[] = { -1.0f, 0.0f, 0.25f, 0.5f, 0.73f, 1.0f, 2.0f };
+	int i, j, k, f;
+
+	for( f = 0; f < (int)( sizeof( fractions ) / sizeof( fractions[0] )); f++ )
+	{
+		for( i = 0; i < NUM_POSES; i++ )
+		{
+			vec4_t qa[MAXSTUDIOBONES], qb[MAXSTUDIOBONES];
+			vec3_t pa[MAXSTUDIOBONES], pb[MAXSTUDIOBONES];
+
+			memcpy( qa, q1[i], sizeof( qa ));
+			memcpy( qb, q1[i], sizeof( qb ));
+			memcpy( pa, pos1[i], sizeof( pa ));
+			memcpy( pb, pos1[i], sizeof( pb ));
+
+			SlerpBonesReference( MAXSTUDIOBONES, qa, pa, q2[i], pos2[i], fractions[f] );
+			R_StudioSlerpBones( MAXSTUDIOBONES, qb, pb, q2[i], pos2[i], fractions[f] );
+
+			for( j = 0; j < MAXSTUDIOBONES; j++ )
+			{
+				for( k = 0; k < 4; k++ )
+				{
+					if( fabs( qa[j][k] - qb[j][k] ) > TOLERANCE )
+					{
+						printf( "slerp mismatch: pose %d bone %d s %g: %g != %g\n", i, j, fractions[f], qa[j][k], qb[j][k] );
+						return 1;
+					}
+				}
+
+				if( !VectorCompare( pa[j], pb[j] ))
+				{
+					printf( "lerp mismatch: pose %d bone %d s %g\n", i, j, fractions[f] );
+					return 2;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int Test_OppositeQuaternions( void )
+{
+	vec4_t qa[1] = {{ 0.0f, 0.0f, 0.0f, 1.0f }}, qb[1];
+	const vec4_t qc[1] = {{ 0.0f, 0.0f, 0.0f, -1.0f }};
+	vec3_t pa[1] = {{ 0.0f }}, pb[1];
+	const vec3_t pc[1] = {{ 1.0f, 2.0f, 3.0f }};
+	int k;
+
+	// exactly opposite quaternions are aligned, but keep the other path covered too
+	Vector4Copy( qa[0], qb[0] );
+	VectorCopy( pa[0], pb[0] );
+
+	SlerpBonesReference( 1, qa, pa, qc, pc, 0.5f );
+	R_StudioSlerpBones( 1, qb, pb, qc, pc, 0.5f );
+
+	for( k = 0; k < 4; k++ )
+	{
+		if( fabs( qa[0][k] - qb[0][k] ) > TOLERANCE )
+			return 1;
+	}
+
+	return 0;
+}
+
+static int Test_BoneMatrices( void )
+{
+	static matrix3x4 out[MAXSTUDIOBONES];
+	int i, j;
+
+	for( i = 0; i < NUM_POSES; i++ )
+	{
+		R_StudioBoneMatrices( MAXSTUDIOBONES, q1[i], pos1[i], out );
+
+		for( j = 0; j < MAXSTUDIOBONES; j++ )
+		{
+			matrix3x4 ref;
+
+			Matrix3x4_FromOriginQuat( ref, q1[i][j], pos1[i][j] );
+
+			if( memcmp( ref, out[j], sizeof( ref )))
+			{
+				printf( "matrix mismatch: pose %d bone %d\n", i, j );
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static double Bench_Time( void )
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void Bench_SlerpBones( int rounds )
+{
+	static vec4_t qa[MAXSTUDIOBONES];
+	static vec3_t pa[MAXSTUDIOBONES];
+	static matrix3x4 out[MAXSTUDIOBONES];
+	double start, ref, kernel;
+	int i, j;
+
+	start = Bench_Time();
+	for( i = 0; i < rounds; i++ )
+	{
+		memcpy( qa, q1[i % NUM_POSES], sizeof( qa ));
+		memcpy( pa, pos1[i % NUM_POSES], sizeof( pa ));
+		SlerpBonesReference( MAXSTUDIOBONES, qa, pa, q2[i % NUM_POSES], pos2[i % NUM_POSES], 0.3f );
+	}
+	ref = Bench_Time() - start;
+
+	start = Bench_Time();
+	for( i = 0; i < rounds; i++ )
+	{
+		memcpy( qa, q1[i % NUM_POSES], sizeof( qa ));
+		memcpy( pa, pos1[i % NUM_POSES], sizeof( pa ));
+		R_StudioSlerpBones( MAXSTUDIOBONES, qa, pa, q2[i % NUM_POSES], pos2[i % NUM_POSES], 0.3f );
+	}
+	kernel = Bench_Time() - start;
+
+	printf( "slerp: per bone %.3f sec, batched %.3f sec\n", ref, kernel );
+
+	start = Bench_Time();
+	for( i = 0; i < rounds; i++ )
+	{
+		for( j = 0; j < MAXSTUDIOBONES; j++ )
+			Matrix3x4_FromOriginQuat( out[j], q1[i % NUM_POSES][j], pos1[i % NUM_POSES][j] );
+	}
+	ref = Bench_Time() - start;
+
+	start = Bench_Time();
+	for( i = 0; i < rounds; i++ )
+		R_StudioBoneMatrices( MAXSTUDIOBONES, q1[i % NUM_POSES], pos1[i % NUM_POSES], out );
+	kernel = Bench_Time() - start;
+
+	printf( "matrices: per bone %.3f sec, batched %.3f sec\n", ref, kernel );
+}
+
+int main( int argc, char **argv )
+{
+	InitPoses();
+
+	if( Test_SlerpBones( ))
+		return 1;
+
+	if( Test_OppositeQuaternions( ))
+		return 2;
+
+	if( Test_BoneMatrices( ))
+		return 3;
+
+	// test_bones bench [rounds]
+	if( argc > 1 && !Q_strcmp( argv[1], "bench" ))
+		Bench_SlerpBones( argc > 2 ? Q_atoi( argv[2] ) : 100000 );
+
+	return EXIT_SUCCESS;
+}
@@ -533,3 +533,125 @@ void R_StudioCalcBones( int frame, float s, const mstudiobone_t *pbone, const ms
 		}
 	}
 }
+
+/*
+====================
+R_StudioSlerpBones
+
+blend whole bone arrays, same results as QuaternionSlerp
+and VectorLerp for each bone but split into passes over
+the arrays, so only acos and sin stay per bone
+====================
+*/
+void R_StudioSlerpBones( int numbones, vec4_t q1[], float pos1[][3], const vec4_t q2[], const float pos2[][3], float s )
+{
+	vec4_t	qa[MAXSTUDIOBONES];
+	float	cosom[MAXSTUDIOBONES];
+	float	sclp[MAXSTUDIOBONES];
+	float	sclq[MAXSTUDIOBONES];
+	int	i, j;
+
+	s = bound( 0.0f, s, 1.0f );
+	numbones = Q_min( numbones, MAXSTUDIOBONES );
+
+	// decide if one of the quaternions is backwards
+	for( i = 0; i < numbones; i++ )
+	{
+		float a = 0.0f, b = 0.0f, sign;
+
+		for( j = 0; j < 4; j++ )
+		{
+			a += (q1[i][j] - q2[i][j]) * (q1[i][j] - q2[i][j]);
+			b += (q1[i][j] + q2[i][j]) * (q1[i][j] + q2[i][j]);
+		}
+
+		sign = a > b ? -1.0f : 1.0f;
+
+		for( j = 0; j < 4; j++ )
+			qa[i][j] = q2[i][j] * sign;
+
+		cosom[i] = q1[i][0] * qa[i][0] + q1[i][1] * qa[i][1] + q1[i][2] * qa[i][2] + q1[i][3] * qa[i][3];
+	}
+
+	for( i = 0; i < numbones; i++ )
+	{
+		if(( 1.0f + cosom[i] ) > 0.000001f )
+		{
+			if(( 1.0f - cosom[i] ) > 0.000001f )
+			{
+				float omega = acos( cosom[i] );
+				float sinom = sin( omega );
+
+				sclp[i] = sin( (1.0f - s) * omega) / sinom;
+				sclq[i] = sin( s * omega ) / sinom;
+			}
+			else
+			{
+				sclp[i] = 1.0f - s;
+				sclq[i] = s;
+			}
+		}
+		else
+		{
+			vec4_t	qt;
+			float	p, q;
+
+			// opposite quaternions, rare enough to be done in place
+			qt[0] = -qa[i][1];
+			qt[1] = qa[i][0];
+			qt[2] = -qa[i][3];
+			qt[3] = qa[i][2];
+			p = sin(( 1.0f - s ) * ( 0.5f * M_PI_F ));
+			q = sin( s * ( 0.5f * M_PI_F ));
+
+			for( j = 0; j < 3; j++ )
+				qa[i][j] = p * q1[i][j] + q * qt[j];
+			qa[i][3] = qt[3];
+
+			// pick blended quaternion as is
+			sclp[i] = 0.0f;
+			sclq[i] = 1.0f;
+		}
+	}
+
+	for( i = 0; i < numbones; i++ )
+	{
+		for( j = 0; j < 4; j++ )
+			q1[i][j] = sclp[i] * q1[i][j] + sclq[i] * qa[i][j];
+
+		VectorLerp( pos1[i], s, pos2[i], pos1[i] );
+	}
+}
+
+/*
+====================
+R_StudioBoneMatrices
+
+convert bone arrays into local bone transforms,
+same as Matrix3x4_FromOriginQuat for each bone
+====================
+*/
+void R_StudioBoneMatrices( int numbones, const vec4_t q[], const float pos[][3], matrix3x4 out[] )
+{
+	int	i;
+
+	for( i = 0; i < numbones; i++ )
+	{
+		out[i][0][0] = 1.0f - 2.0f * q[i][1] * q[i][1] - 2.0f * q[i][2] * q[i][2];
+		out[i][1][0] = 2.0f * q[i][0] * q[i][1] + 2.0f * q[i][3] * q[i][2];
+		out[i][2][0] = 2.0f * q[i][0] * q[i][2] - 2.0f * q[i][3] * q[i][1];
+
+		out[i][0][1] = 2.0f * q[i][0] * q[i][1] - 2.0f * q[i][3] * q[i][2];
+		out[i][1][1] = 1.0f - 2.0f * q[i][0] * q[i][0] - 2.0f * q[i][2] * q[i][2];
+		out[i][2][1] = 2.0f * q[i][1] * q[i][2] + 2.0f * q[i][3] * q[i][0];
+
+		out[i][0][2] = 2.0f * q[i][0] * q[i][2] + 2.0f * q[i][3] * q[i][1];
+		out[i][1][2] = 2.0f * q[i][1] * q[i][2] - 2.0f * q[i][3] * q[i][0];
+		out[i][2][2] = 1.0f - 2.0f * q[i][0] * q[i][0] - 2.0f * q[i][1] * q[i][1];
+
+		out[i][0][3] = pos[i][0];
+		out[i][1][3] = pos[i][1];
+		out[i][2][3] = pos[i][2];
+	}
+}
+
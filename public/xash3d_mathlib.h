@@ -172,6 +172,8 @@ qboolean SphereIntersect( const vec3_t vSphereCenter, float fSphereRadiusSquared
 void QuaternionSlerp( const vec4_t p, const vec4_t q, float t, vec4_t qt );
 
 void R_StudioCalcBones( int frame, float s, const mstudiobone_t *pbone, const mstudioanim_t *panim, const float *adj, vec3_t pos, vec4_t q );
+void R_StudioSlerpBones( int numbones, vec4_t q1[], float pos1[][3], const vec4_t q2[], const float pos2[][3], float s );
+void R_StudioBoneMatrices( int numbones, const vec4_t q[], const float pos[][3], matrix3x4 out[] );
 int BoxOnPlaneSide( const vec3_t emins, const vec3_t emaxs, const mplane_t *p );
 #define BOX_ON_PLANE_SIDE( emins, emaxs, p )           \
 	((( p )->type < 3 ) ?                              \
@@ -482,16 +484,4 @@ static inline void QuaternionAngle( const vec4_t q, vec3_t angles )
 	Matrix3x4_AnglesFromMatrix( mat, angles );
 }
 
-static inline void R_StudioSlerpBones( int numbones, vec4_t q1[], float pos1[][3], const vec4_t q2[], const float pos2[][3], float s )
-{
-	int	i;
-	s = bound( 0.0f, s, 1.0f );
-
-	for( i = 0; i < numbones; i++ )
-	{
-		QuaternionSlerp( q1[i], q2[i], s, q1[i] );
-		VectorLerp( pos1[i], s, pos2[i], pos1[i] );
-	}
-}
-
 #endif // XASH3D_MATHLIB_H
@@ -917,7 +917,7 @@ static void R_StudioSetupBones( cl_entity_t *e )
 	mstudiobone_t    *pbones;
 	mstudioseqdesc_t *pseqdesc;
 	mstudioanim_t    *panim;
-	matrix3x4        bonematrix;
+	static matrix3x4 bonematrix[MAXSTUDIOBONES];
 	static vec3_t    pos[MAXSTUDIOBONES];
 	static vec4_t    q[MAXSTUDIOBONES];
 	static vec3_t    pos2[MAXSTUDIOBONES];
@@ -1043,13 +1043,13 @@ static void R_StudioSetupBones( cl_entity_t *e )
 		}
 	}
 
+	R_StudioBoneMatrices( m_pStudioHeader->numbones, q, pos, bonematrix );
+
 	for( i = 0; i < m_pStudioHeader->numbones; i++ )
 	{
-		Matrix3x4_FromOriginQuat( bonematrix, q[i], pos[i] );
-
 		if( pbones[i].parent == -1 )
 		{
-			Matrix3x4_ConcatTransforms( g_studio.bonestransform[i], g_studio.rotationmatrix, bonematrix );
+			Matrix3x4_ConcatTransforms( g_studio.bonestransform[i], g_studio.rotationmatrix, bonematrix[i] );
 			Matrix3x4_Copy( g_studio.lighttransform[i], g_studio.bonestransform[i] );
 
 			// apply client-side effects to the transformation matrix
@@ -1057,8 +1057,8 @@ static void R_StudioSetupBones( cl_entity_t *e )
 		}
 		else
 		{
-			Matrix3x4_ConcatTransforms( g_studio.bonestransform[i], g_studio.bonestransform[pbones[i].parent], bonematrix );
-			Matrix3x4_ConcatTransforms( g_studio.lighttransform[i], g_studio.lighttransform[pbones[i].parent], bonematrix );
+			Matrix3x4_ConcatTransforms( g_studio.bonestransform[i], g_studio.bonestransform[pbones[i].parent], bonematrix[i] );
+			Matrix3x4_ConcatTransforms( g_studio.lighttransform[i], g_studio.lighttransform[pbones[i].parent], bonematrix[i] );
 		}
 	}
 }